@@ -0,0 +1,605 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include "../include/engine.h"
+#include "../include/bvh.h"
+#include "../include/camera.h"
+#include "../include/scene.h"
+#include "../include/texture.h"
+#include "../include/threadpool.h"
+#include "../include/transform.h"
+#include "../graphics/clipper.h"
+#include "../graphics/rasterizer.h"
+#include "../graphics/renderer.h"
+
+using namespace Engine3D;
+using namespace std;
+
+// Headless benchmark of the pipeline stages, each timed in isolation, plus whole
+// frames through the renderer in every shading mode, textured, and far away with and
+// without levels of detail, wireframes, and a city scene with and without occlusion
+// culling.
+// Results are written as JSON for tracking over time.
+//
+// Usage: engine_bench [--triangles N] [--obj file.obj]... [--iterations N]
+//                     [--threads N] [--output results.json]
+//
+// Without --obj a synthetic sphere of --triangles triangles (default 1M) is used,
+// and it is also written out as an OBJ to time loading.
+
+namespace {
+    const int WIDTH = 1280;
+    const int HEIGHT = 720;
+
+    struct Options {
+        size_t triangles = 1000000;
+        vector<string> objFiles;
+        int iterations = 20;
+        unsigned threads = 0;
+        string output;
+    };
+
+    struct Result {
+        string stage;
+        string mesh;
+        size_t triangles = 0;     // work items per iteration
+        double pixels = 0.0;      // covered pixels per iteration, when meaningful
+        double bytes = 0.0;       // input bytes per iteration, when meaningful
+        vector<double> seconds;   // one entry per iteration, sorted
+    };
+
+    template <typename F>
+    vector<double> timeIterations(int iterations, F run) {
+        // One untimed run to warm caches and allocations
+        run();
+
+        vector<double> seconds;
+        for (int i = 0; i < iterations; i++) {
+            auto start = chrono::steady_clock::now();
+            run();
+            seconds.push_back(chrono::duration<double>(chrono::steady_clock::now() - start).count());
+        }
+        sort(seconds.begin(), seconds.end());
+        return seconds;
+    }
+
+    double percentile(const vector<double>& sorted, double q) {
+        size_t index = (size_t)(q * (double)(sorted.size() - 1) + 0.5);
+        return sorted[min(index, sorted.size() - 1)];
+    }
+
+    // UV sphere of radius 1 around the origin with about the requested triangle count
+    void buildSphere(mesh& m, size_t triangles) {
+        int rings = max(2, (int)sqrt((double)triangles / 4.0));
+        for (int i = 0; i <= rings; i++) {
+            for (int j = 0; j <= 2 * rings; j++) {
+                float theta = (float)M_PI * i / rings;
+                float phi = (float)M_PI * j / rings;
+                m.vertices.push_back(vec3d(sinf(theta) * cosf(phi), sinf(theta) * sinf(phi), cosf(theta)));
+            }
+        }
+        auto vertex = [&](int i, int j) { return (uint32_t)(i * (2 * rings + 1) + j); };
+        for (int i = 0; i < rings; i++) {
+            for (int j = 0; j < 2 * rings; j++) {
+                m.addTriangle(vertex(i, j), vertex(i + 1, j), vertex(i + 1, j + 1));
+                m.addTriangle(vertex(i, j), vertex(i + 1, j + 1), vertex(i, j + 1));
+            }
+        }
+    }
+
+    void writeObject(const mesh& m, const string& filename) {
+        FILE* out = fopen(filename.c_str(), "w");
+        for (size_t i = 0; i < m.vertices.size(); i++) {
+            vec3d v = m.vertices.get(i);
+            fprintf(out, "v %.6f %.6f %.6f\n", v.x, v.y, v.z);
+        }
+        for (size_t t = 0; t < m.triangleCount(); t++) {
+            fprintf(out, "f %u %u %u\n", m.indices[t * 3] + 1, m.indices[t * 3 + 1] + 1, m.indices[t * 3 + 2] + 1);
+        }
+        fclose(out);
+    }
+
+    // Scale the mesh's bounds to the given radius and center them at (x, y, z)
+    matrix4x4 fitModel(const mesh& m, float radius, float x, float y, float z) {
+        AABB bounds = computeBounds(m);
+        vec3d center = bounds.center();
+        vec3d extent = bounds.max - bounds.min;
+        float scale = 2.0f * radius / max({ extent.x, extent.y, extent.z, 1e-6f });
+
+        matrix4x4 model;
+        model.m[0][0] = scale;
+        model.m[1][1] = scale;
+        model.m[2][2] = scale;
+        model.m[3][0] = x - center.x * scale;
+        model.m[3][1] = y - center.y * scale;
+        model.m[3][2] = z - center.z * scale;
+        model.m[3][3] = 1.0f;
+        return model;
+    }
+
+    // Texture coordinates from the direction of each vertex seen from the center
+    void projectTexCoords(mesh& m) {
+        vec3d center = computeBounds(m).center();
+        m.texCoords.clear();
+        for (size_t i = 0; i < m.vertices.size(); i++) {
+            vec3d d = m.vertices.get(i) - center;
+            float length = max(sqrtf(d.x * d.x + d.y * d.y + d.z * d.z), 1e-6f);
+            m.texCoords.push_back(0.5f + atan2f(d.z, d.x) / (2.0f * (float)M_PI),
+                                  acosf(max(-1.0f, min(1.0f, d.y / length))) / (float)M_PI);
+        }
+    }
+
+    struct ClipSpace {
+        vector<float> x, y, z, w;
+    };
+
+    void toClipSpace(const mesh& m, const matrix4x4& mvp, ClipSpace& clip) {
+        size_t count = m.vertices.size();
+        clip.x.resize(count);
+        clip.y.resize(count);
+        clip.z.resize(count);
+        clip.w.resize(count);
+        transformPoints(mvp, m.vertices.x.data(), m.vertices.y.data(), m.vertices.z.data(),
+                        clip.x.data(), clip.y.data(), clip.z.data(), clip.w.data(), count);
+    }
+
+    Result benchTransform(const mesh& m, const string& name, const matrix4x4& mvp, int iterations) {
+        ClipSpace clip;
+        Result result;
+        result.stage = "transform";
+        result.mesh = name;
+        result.triangles = m.triangleCount();
+        result.seconds = timeIterations(iterations, [&] { toClipSpace(m, mvp, clip); });
+        return result;
+    }
+
+    Result benchCull(const mesh& m, const string& name, const matrix4x4& mvp, int iterations) {
+        Frustum frustum = Frustum::fromMatrix(mvp);
+        vector<BVH::Range> visible;
+
+        Result result;
+        result.stage = "cull";
+        result.mesh = name;
+        result.triangles = m.triangleCount();
+        result.seconds = timeIterations(iterations, [&] {
+            visible.clear();
+            m.bvh->cullFrustum(frustum, visible);
+        });
+        return result;
+    }
+
+    Result benchClip(const mesh& m, const string& name, const matrix4x4& mvp, int iterations) {
+        ClipSpace clip;
+        toClipSpace(m, mvp, clip);
+
+        // Only triangles that straddle a plane reach the clipper
+        vector<uint32_t> crossing;
+        for (size_t t = 0; t < m.triangleCount(); t++) {
+            uint8_t all = 0xFF, any = 0;
+            for (int k = 0; k < 3; k++) {
+                uint32_t v = m.indices[t * 3 + k];
+                uint8_t code = computeOutcode(clip.x[v], clip.y[v], clip.z[v], clip.w[v]);
+                all &= code;
+                any |= code;
+            }
+            if (any && !all) {
+                crossing.push_back((uint32_t)t);
+            }
+        }
+
+        size_t emitted = 0;
+        Result result;
+        result.stage = "clip";
+        result.mesh = name;
+        result.triangles = crossing.size();
+        result.seconds = timeIterations(iterations, [&] {
+            emitted = 0;
+            for (uint32_t t : crossing) {
+                ClipVertex in[3], out[MAX_CLIP_VERTICES];
+                for (int k = 0; k < 3; k++) {
+                    uint32_t v = m.indices[t * 3 + k];
+                    in[k] = ClipVertex{ clip.x[v], clip.y[v], clip.z[v], clip.w[v] };
+                }
+                int count = clipPolygonDepth(in, 3, out);
+
+                vec3d polygon[MAX_CLIP_VERTICES], clipped[MAX_CLIP_VERTICES];
+                for (int k = 0; k < count; k++) {
+                    polygon[k] = vec3d((out[k].x / out[k].w + 1.0f) * WIDTH / 2.0f,
+                                       (out[k].y / out[k].w + 1.0f) * HEIGHT / 2.0f,
+                                       out[k].z / out[k].w);
+                }
+                count = clipPolygonScreen(polygon, count, clipped, (float)WIDTH, (float)HEIGHT);
+                emitted += count >= 3 ? count - 2 : 0;
+            }
+        });
+        return result;
+    }
+
+    // Rasterization alone with one pipeline state, through the specialized kernels or
+    // the one testing the state per pixel
+    Result benchRasterize(const mesh& m, const string& name, const matrix4x4& mvp, ShadingMode shading, BlendMode blend,
+                          RasterDispatch dispatch, int iterations) {
+        ClipSpace clip;
+        toClipSpace(m, mvp, clip);
+
+        // Front-facing triangles entirely on screen, projected like the renderer does
+        vector<RasterTriangle> triangles;
+        double pixels = 0.0;
+        for (size_t t = 0; t < m.triangleCount(); t++) {
+            RasterTriangle tri;
+            tri.color = blend == BlendMode::Alpha ? 0x80FFFFFFu : 0xFFFFFFFFu;
+            tri.shading = shading;
+            tri.blend = blend;
+            tri.texture = nullptr;
+            bool inside = true;
+            for (int k = 0; k < 3 && inside; k++) {
+                uint32_t v = m.indices[t * 3 + k];
+                inside = computeOutcode(clip.x[v], clip.y[v], clip.z[v], clip.w[v]) == 0;
+                tri.points[k] = vec3d((clip.x[v] / clip.w[v] + 1.0f) * WIDTH / 2.0f,
+                                      (clip.y[v] / clip.w[v] + 1.0f) * HEIGHT / 2.0f,
+                                      clip.z[v] / clip.w[v]);
+                tri.attributes[k] = vec3d((float)(v % 7) / 6.0f, 0.0f, 0.0f);
+            }
+            vec3d e1 = tri.points[1] - tri.points[0];
+            vec3d e2 = tri.points[2] - tri.points[0];
+            float area = e1.x * e2.y - e1.y * e2.x;
+            if (inside && area < 0.0f) {
+                triangles.push_back(tri);
+                pixels += -area * 0.5;
+            }
+        }
+
+        FrameBuffer frameBuffer(WIDTH, HEIGHT);
+        Rect screen{ 0, 0, WIDTH, HEIGHT };
+
+        Result result;
+        result.stage = "rasterize";
+        if (shading == ShadingMode::Gouraud) {
+            result.stage += "_gouraud";
+        }
+        if (blend == BlendMode::Alpha) {
+            result.stage += "_blended";
+        }
+        if (dispatch == RasterDispatch::Runtime) {
+            result.stage += "_runtime";
+        }
+        result.mesh = name;
+        result.triangles = triangles.size();
+        result.pixels = pixels;
+        setRasterDispatch(dispatch);
+        result.seconds = timeIterations(iterations, [&] {
+            frameBuffer.clear(0xFF000000u);
+            for (const RasterTriangle& tri : triangles) {
+                rasterizeTriangle(frameBuffer, tri, screen);
+            }
+        });
+        setRasterDispatch(RasterDispatch::Specialized);
+        return result;
+    }
+
+    Result benchFrame(const mesh& m, const string& name, const matrix4x4& model, ShadingMode shading,
+                      unsigned threads, int iterations) {
+        Renderer renderer(WIDTH, HEIGHT, true);
+        renderer.init();
+        renderer.setThreadCount(threads);
+        renderer.setShadingMode(shading);
+        Camera camera((float)WIDTH, (float)HEIGHT);
+
+        Result result;
+        result.stage = shading == ShadingMode::Gouraud ? "frame_gouraud" : shading == ShadingMode::Phong ? "frame_phong" : "frame";
+        if (m.texture) {
+            result.stage += "_textured";
+        }
+        result.mesh = name;
+        result.triangles = m.triangleCount();
+        result.seconds = timeIterations(iterations, [&] {
+            renderer.clear();
+            renderer.drawMesh(m, model, camera);
+            renderer.present();
+        });
+        return result;
+    }
+
+    // Frames of the mesh far from the camera, with or without its levels of detail
+    Result benchDistantFrame(const mesh& m, const string& name, const matrix4x4& model, float lodThreshold,
+                             unsigned threads, int iterations) {
+        Renderer renderer(WIDTH, HEIGHT, true);
+        renderer.init();
+        renderer.setThreadCount(threads);
+        renderer.setLODThreshold(lodThreshold);
+        Camera camera((float)WIDTH, (float)HEIGHT);
+
+        Result result;
+        result.stage = lodThreshold > 0.0f ? "frame_distant_lod" : "frame_distant";
+        result.mesh = name;
+        result.triangles = m.triangleCount();
+        result.seconds = timeIterations(iterations, [&] {
+            renderer.clear();
+            renderer.drawMesh(m, model, camera);
+            renderer.present();
+        });
+        cerr << "  " << result.stage << ": " << renderer.getFrameStats() << endl;
+        return result;
+    }
+
+    // Wireframes over a cleared frame: every triangle side, or the mesh's unique
+    // edges once computeEdges has run, with plain or anti-aliased lines
+    Result benchWireframe(const mesh& m, const string& name, const matrix4x4& model, bool antialiased,
+                          unsigned threads, int iterations) {
+        Renderer renderer(WIDTH, HEIGHT, true);
+        renderer.init();
+        renderer.setThreadCount(threads);
+        renderer.setLineAntialiasing(antialiased);
+        Camera camera((float)WIDTH, (float)HEIGHT);
+
+        Result result;
+        result.stage = m.edges.empty() ? "wireframe_sides" : antialiased ? "wireframe_smooth" : "wireframe";
+        result.mesh = name;
+        result.triangles = m.edges.empty() ? m.triangleCount() * 3 : m.edges.size() / 2;
+        result.seconds = timeIterations(iterations, [&] {
+            renderer.clear();
+            renderer.drawWireframe(m, model, camera, RGB::WHITE);
+            renderer.present();
+        });
+        return result;
+    }
+
+    // Simplification is too slow to repeat, so the chain is built and timed once
+    Result benchSimplify(mesh& m, const string& name) {
+        Result result;
+        result.stage = "simplify";
+        result.mesh = name;
+        result.triangles = m.triangleCount();
+        auto start = chrono::steady_clock::now();
+        m.buildLODs();
+        result.seconds.push_back(chrono::duration<double>(chrono::steady_clock::now() - start).count());
+        return result;
+    }
+
+    // City blocks of boxes on a ground plane with a detailed sphere on every roof,
+    // seen from street level: most of it is behind the nearest buildings
+    void buildCity(Scene& scene, Camera& camera) {
+        shared_ptr<mesh> box = make_shared<mesh>();
+        populateCube(*box);
+        box->computeFaceNormals();
+        shared_ptr<mesh> sphere = make_shared<mesh>();
+        buildSphere(*sphere, 20000);
+        sphere->buildBVH();
+        sphere->computeFaceNormals();
+        uint32_t boxIndex = scene.addMesh(box);
+        uint32_t sphereIndex = scene.addMesh(sphere);
+
+        auto place = [](float sx, float sy, float sz, float x, float y, float z) {
+            matrix4x4 m;
+            m.m[0][0] = sx; m.m[1][1] = sy; m.m[2][2] = sz;
+            m.m[3][0] = x; m.m[3][1] = y; m.m[3][2] = z; m.m[3][3] = 1.0f;
+            return m;
+        };
+        scene.addNode(boxIndex, place(400.0f, 1.0f, 400.0f, -200.0f, 0.0f, -200.0f));
+        for (int i = 0; i < 16; i++) {
+            for (int j = 0; j < 16; j++) {
+                float height = 4.0f + (float)((i * 7 + j * 13) % 10);
+                float x = (float)(i * 8 - 64), z = (float)(j * 8);
+                scene.addNode(boxIndex, place(5.0f, height, 5.0f, x, -height, z));
+                scene.addNode(sphereIndex, place(0.75f, 0.75f, 0.75f, x + 2.5f, -height - 0.75f, z + 2.5f));
+            }
+        }
+        scene.updateTransforms();
+
+        camera.position = vec3d(-1.5f, -1.7f, -10.0f);
+        camera.yaw = 0.3f;
+    }
+
+    // Pipelined, each frame's geometry overlaps the rasterization of the one before
+    Result benchCity(bool occlusion, bool pipelined, unsigned threads, int iterations) {
+        Scene scene;
+        Camera camera((float)WIDTH, (float)HEIGHT);
+        buildCity(scene, camera);
+
+        Renderer renderer(WIDTH, HEIGHT, true);
+        renderer.init();
+        renderer.setThreadCount(threads);
+        renderer.setOcclusionCulling(occlusion);
+        renderer.setPipelinedFrames(pipelined);
+
+        Result result;
+        result.stage = pipelined ? "frame_city_pipelined" : occlusion ? "frame_city_occlusion" : "frame_city";
+        result.mesh = "city";
+        for (const Scene::Node& node : scene.getNodes()) {
+            result.triangles += scene.getMeshes()[node.meshIndex].source->triangleCount();
+        }
+        result.seconds = timeIterations(iterations, [&] {
+            renderer.clear();
+            renderer.drawScene(scene, camera);
+            renderer.present();
+        });
+        renderer.finish();
+        cerr << "  " << result.stage << ": " << renderer.getFrameStats() << endl;
+        return result;
+    }
+
+    Result benchLoad(const string& filename, const string& name, ThreadPool& pool, int iterations) {
+        ifstream sizeProbe(filename, ios::binary | ios::ate);
+        double bytes = (double)sizeProbe.tellg();
+
+        size_t triangles = 0;
+        Result result;
+        result.stage = "objload";
+        result.mesh = name;
+        result.bytes = bytes;
+        result.seconds = timeIterations(iterations, [&] {
+            mesh loaded;
+            loaded.loadFromObjectFile(filename, false, &pool);
+            triangles = loaded.triangleCount();
+        });
+        result.triangles = triangles;
+        return result;
+    }
+
+    // Every stage for one mesh: the main view has it whole and in front of the
+    // camera, the cull view half off screen, and the clip view around the camera
+    void benchMesh(mesh& m, const string& name, const Options& options, vector<Result>& results) {
+        m.buildBVH();
+        m.computeFaceNormals();
+        if (m.normals.size() != m.vertices.size()) {
+            m.computeVertexNormals();
+        }
+
+        Camera camera((float)WIDTH, (float)HEIGHT);
+        matrix4x4 viewProjection = camera.getViewProjectionMatrix();
+        matrix4x4 mainModel = fitModel(m, 1.0f, 0.0f, 0.0f, 2.5f);
+        matrix4x4 cullModel = fitModel(m, 1.0f, 5.0f, 0.0f, 3.0f);
+        matrix4x4 clipModel = fitModel(m, 4.0f, 0.0f, 0.0f, 2.0f);
+
+        cerr << "benchmarking " << name << ", " << m.triangleCount() << " triangles" << endl;
+        results.push_back(benchTransform(m, name, mainModel * viewProjection, options.iterations));
+        results.push_back(benchCull(m, name, cullModel * viewProjection, options.iterations));
+        results.push_back(benchClip(m, name, clipModel * viewProjection, options.iterations));
+        for (RasterDispatch dispatch : { RasterDispatch::Specialized, RasterDispatch::Runtime }) {
+            matrix4x4 mvp = mainModel * viewProjection;
+            results.push_back(benchRasterize(m, name, mvp, ShadingMode::Flat, BlendMode::Opaque, dispatch, options.iterations));
+            results.push_back(benchRasterize(m, name, mvp, ShadingMode::Gouraud, BlendMode::Opaque, dispatch, options.iterations));
+            results.push_back(benchRasterize(m, name, mvp, ShadingMode::Flat, BlendMode::Alpha, dispatch, options.iterations));
+        }
+        for (ShadingMode shading : { ShadingMode::Flat, ShadingMode::Gouraud, ShadingMode::Phong }) {
+            results.push_back(benchFrame(m, name, mainModel, shading, options.threads, options.iterations));
+        }
+
+        // Flat frames again with a checker texture, projected onto meshes without
+        // texture coordinates of their own
+        if (m.texCoords.size() != m.vertices.size()) {
+            projectTexCoords(m);
+        }
+        shared_ptr<Texture> texture = make_shared<Texture>();
+        createCheckerTexture(*texture, 256, 8, 0xFFE04040u, 0xFFF0F0F0u);
+        m.texture = texture;
+        results.push_back(benchFrame(m, name, mainModel, ShadingMode::Flat, options.threads, options.iterations));
+        m.texture.reset();
+
+        results.push_back(benchWireframe(m, name, mainModel, false, options.threads, options.iterations));
+        m.computeEdges();
+        results.push_back(benchWireframe(m, name, mainModel, false, options.threads, options.iterations));
+        results.push_back(benchWireframe(m, name, mainModel, true, options.threads, options.iterations));
+
+        // The same mesh small in the distance, whole and then through its levels of detail
+        matrix4x4 distantModel = fitModel(m, 1.0f, 0.0f, 0.0f, 40.0f);
+        results.push_back(benchDistantFrame(m, name, distantModel, 0.0f, options.threads, options.iterations));
+        results.push_back(benchSimplify(m, name));
+        results.push_back(benchDistantFrame(m, name, distantModel, 1.0f, options.threads, options.iterations));
+        m.lods.clear();
+    }
+
+    string jsonString(const string& s) {
+        string out = "\"";
+        for (char c : s) {
+            if (c == '"' || c == '\\') out += '\\';
+            out += c;
+        }
+        return out + "\"";
+    }
+
+    void writeJson(ostream& out, const Options& options, unsigned threads, const vector<Result>& results) {
+        out << "{\n";
+        out << "  \"benchmark\": \"engine_bench\",\n";
+        out << "  \"width\": " << WIDTH << ",\n";
+        out << "  \"height\": " << HEIGHT << ",\n";
+        out << "  \"threads\": " << threads << ",\n";
+        out << "  \"simd\": " << jsonString(simdLevelName(getSimdLevel())) << ",\n";
+        out << "  \"iterations\": " << options.iterations << ",\n";
+        out << "  \"results\": [\n";
+        for (size_t i = 0; i < results.size(); i++) {
+            const Result& r = results[i];
+            double median = percentile(r.seconds, 0.5);
+            double mean = 0.0;
+            for (double s : r.seconds) mean += s;
+            mean /= (double)r.seconds.size();
+
+            out << "    {\"stage\": " << jsonString(r.stage) << ", \"mesh\": " << jsonString(r.mesh)
+                << ", \"triangles\": " << r.triangles;
+            out << ", \"seconds\": {\"min\": " << r.seconds.front() << ", \"mean\": " << mean
+                << ", \"p50\": " << median << ", \"p90\": " << percentile(r.seconds, 0.9)
+                << ", \"p99\": " << percentile(r.seconds, 0.99) << ", \"max\": " << r.seconds.back() << "}";
+            out << ", \"triangles_per_second\": " << (median > 0.0 ? r.triangles / median : 0.0);
+            if (r.pixels > 0.0) {
+                out << ", \"pixels\": " << r.pixels << ", \"pixels_per_second\": " << r.pixels / median;
+            }
+            if (r.bytes > 0.0) {
+                out << ", \"bytes\": " << r.bytes << ", \"bytes_per_second\": " << r.bytes / median;
+            }
+            out << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+        }
+        out << "  ]\n";
+        out << "}\n";
+    }
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--triangles" && hasValue) {
+            options.triangles = strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--obj" && hasValue) {
+            options.objFiles.push_back(argv[++i]);
+        } else if (arg == "--iterations" && hasValue) {
+            options.iterations = max(1, atoi(argv[++i]));
+        } else if (arg == "--threads" && hasValue) {
+            options.threads = (unsigned)atoi(argv[++i]);
+        } else if (arg == "--output" && hasValue) {
+            options.output = argv[++i];
+        } else {
+            cerr << "usage: engine_bench [--triangles N] [--obj file.obj]... [--iterations N]"
+                    " [--threads N] [--output results.json]" << endl;
+            return 1;
+        }
+    }
+
+    // OBJ files are parsed on a pool of the benchmark's thread count
+    ThreadPool loadPool(options.threads);
+    vector<Result> results;
+    if (options.objFiles.empty()) {
+        mesh sphere;
+        buildSphere(sphere, options.triangles);
+        string name = "sphere-" + to_string(sphere.triangleCount());
+        benchMesh(sphere, name, options, results);
+
+        string filename = "engine_bench.obj";
+        writeObject(sphere, filename);
+        results.push_back(benchLoad(filename, name, loadPool, options.iterations));
+        remove(filename.c_str());
+    }
+    for (const string& filename : options.objFiles) {
+        mesh loaded;
+        if (!loaded.loadFromObjectFile(filename, false, &loadPool)) {
+            cerr << "could not load " << filename << endl;
+            return 1;
+        }
+        benchMesh(loaded, filename, options, results);
+        results.push_back(benchLoad(filename, filename, loadPool, options.iterations));
+    }
+
+    cerr << "benchmarking city scene" << endl;
+    results.push_back(benchCity(false, false, options.threads, options.iterations));
+    results.push_back(benchCity(true, false, options.threads, options.iterations));
+    results.push_back(benchCity(true, true, options.threads, options.iterations));
+
+    // Thread count the frames actually ran with
+    Renderer probe(1, 1, true);
+    probe.setThreadCount(options.threads);
+    unsigned threads = probe.getThreadCount();
+
+    if (options.output.empty()) {
+        writeJson(cout, options, threads, results);
+    } else {
+        ofstream out(options.output);
+        writeJson(out, options, threads, results);
+    }
+    return 0;
+}
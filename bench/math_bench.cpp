@@ -0,0 +1,148 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include "../include/engine.h"
+#include "../include/vecmath.h"
+
+using namespace Engine3D;
+using namespace std;
+
+// Compares the aligned vec4/mat4 operators with the vec3d and matrix4x4 code they
+// stand in for, and per-triangle face normals recomputed from the positions with
+// precomputed ones rotated in a batch.
+//
+// Usage: math_bench [element count] [iterations]
+
+namespace {
+    template <typename F>
+    double bestSeconds(int iterations, F run) {
+        double best = 1e30;
+        for (int i = 0; i < iterations; i++) {
+            auto start = chrono::steady_clock::now();
+            run();
+            double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            best = min(best, seconds);
+        }
+        return best;
+    }
+
+    void report(const char* name, size_t count, double baseline, double seconds, const string& check) {
+        cout << "  " << left << setw(14) << name
+             << setw(10) << (count / baseline) / 1e6 << " -> " << setw(10) << (count / seconds) / 1e6 << " Mops/s, "
+             << baseline / seconds << "x, " << check << endl;
+    }
+
+    string maxError(float error) {
+        ostringstream out;
+        out << "max error " << error;
+        return out.str();
+    }
+
+    vec3d rotateDirection(const matrix4x4& m, const vec3d& v) {
+        return vec3d(v.x * m.m[0][0] + v.y * m.m[1][0] + v.z * m.m[2][0],
+                     v.x * m.m[0][1] + v.y * m.m[1][1] + v.z * m.m[2][1],
+                     v.x * m.m[0][2] + v.y * m.m[1][2] + v.z * m.m[2][2]);
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t count = argc > 1 ? strtoull(argv[1], nullptr, 10) : 1000000;
+    int iterations = argc > 2 ? atoi(argv[2]) : 20;
+
+    mt19937 rng(1234);
+    uniform_real_distribution<float> dist(-1.0f, 1.0f);
+
+    cout << "elements: " << count << ", best of " << iterations << " runs" << endl;
+
+    // Points through a projection, divided by w
+    vector<vec3d> points(count), projected(count);
+    vector<vec4> alignedPoints(count), alignedProjected(count);
+    for (size_t i = 0; i < count; i++) {
+        points[i] = vec3d(dist(rng), dist(rng), dist(rng) + 3.0f);
+        alignedPoints[i] = vec4(points[i], 1.0f);
+    }
+    matrix4x4 projection;
+    populateMatrix(projection, 800, 600, 1000);
+    mat4 alignedProjection(projection);
+    double baseline = bestSeconds(iterations, [&] {
+        for (size_t i = 0; i < count; i++) {
+            projected[i] = projection.multiplyVector(points[i]);
+        }
+    });
+    double seconds = bestSeconds(iterations, [&] {
+        for (size_t i = 0; i < count; i++) {
+            vec4 p = alignedPoints[i] * alignedProjection;
+            alignedProjected[i] = p.w != 0.0f ? p * (1.0f / p.w) : p;
+        }
+    });
+    float error = 0.0f;
+    for (size_t i = 0; i < count; i++) {
+        vec3d d = alignedProjected[i].xyz() - projected[i];
+        error = max(error, d.length() / max(projected[i].length(), 1e-30f));
+    }
+    report("vec * mat", count, baseline, seconds, maxError(error) + " (reciprocal of w)");
+
+    // Normalization
+    vector<vec3d> results(count);
+    vector<vec4> alignedResults(count);
+    for (size_t i = 0; i < count; i++) {
+        alignedPoints[i].w = 0.0f;
+    }
+    baseline = bestSeconds(iterations, [&] {
+        for (size_t i = 0; i < count; i++) {
+            results[i] = points[i].normalize();
+        }
+    });
+    seconds = bestSeconds(iterations, [&] {
+        for (size_t i = 0; i < count; i++) {
+            alignedResults[i] = normalize3(alignedPoints[i]);
+        }
+    });
+    error = 0.0f;
+    for (size_t i = 0; i < count; i++) {
+        error = max(error, (alignedResults[i].xyz() - results[i]).length());
+    }
+    report("normalize", count, baseline, seconds, maxError(error));
+
+    // Face normals of a triangle soup: recomputed from the positions and rotated one
+    // by one, or precomputed and rotated in a batch
+    mesh soup;
+    size_t triangleCount = count / 3;
+    for (size_t i = 0; i < triangleCount * 3; i++) {
+        soup.vertices.push_back(vec3d(dist(rng), dist(rng), dist(rng)));
+    }
+    for (size_t t = 0; t < triangleCount; t++) {
+        soup.addTriangle((uint32_t)(t * 3), (uint32_t)(t * 3 + 1), (uint32_t)(t * 3 + 2));
+    }
+    soup.computeFaceNormals();
+    matrix4x4 rotation;
+    createRotationMatrixY(rotation, 0.7f);
+    mat4 alignedRotation(rotation);
+    vector<vec3d> faceNormals(triangleCount);
+    vector<vec4> alignedFaceNormals(triangleCount);
+    baseline = bestSeconds(iterations, [&] {
+        for (size_t t = 0; t < triangleCount; t++) {
+            triangle tri = soup.getTriangle(t);
+            tri.calculateNormal();
+            faceNormals[t] = rotateDirection(rotation, tri.normal).normalize();
+        }
+    });
+    seconds = bestSeconds(iterations, [&] {
+        for (size_t t = 0; t < triangleCount; t++) {
+            alignedFaceNormals[t] = vec4(soup.faceNormals.get(t), 0.0f);
+        }
+        transformNormals(alignedRotation, alignedFaceNormals.data(), triangleCount);
+    });
+    error = 0.0f;
+    for (size_t t = 0; t < triangleCount; t++) {
+        error = max(error, (alignedFaceNormals[t].xyz() - faceNormals[t]).length());
+    }
+    report("face normals", triangleCount, baseline, seconds, maxError(error));
+
+    return 0;
+}
@@ -0,0 +1,130 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include "../include/engine.h"
+#include "../include/threadpool.h"
+
+using namespace Engine3D;
+using namespace std;
+
+// Compares mesh::loadFromObjectFile, on a thread pool and on the calling thread,
+// with the previous istringstream-per-line loader, and times a load served from
+// the binary sidecar cache.
+//
+// Usage: objload_bench [file.obj]
+//        objload_bench --generate <faces> [file.obj]   writes a synthetic grid first
+
+namespace {
+    // The loader as it was before the streaming parser, kept as the baseline
+    bool loadLegacy(mesh& m, const string& filename) {
+        ifstream file(filename);
+        if (!file.is_open()) {
+            return false;
+        }
+
+        m.vertices.clear();
+        m.indices.clear();
+
+        string line;
+        while (getline(file, line)) {
+            if (line.empty()) continue;
+
+            istringstream ss(line);
+            string prefix;
+            ss >> prefix;
+
+            if (prefix == "v") {
+                vec3d vertex;
+                ss >> vertex.x >> vertex.y >> vertex.z;
+                m.vertices.push_back(vertex);
+            }
+            else if (prefix == "f") {
+                long f[3];
+                ss >> f[0] >> f[1] >> f[2];
+
+                long count = (long)m.vertices.size();
+                if (f[0] > 0 && f[1] > 0 && f[2] > 0 &&
+                    f[0] <= count && f[1] <= count && f[2] <= count) {
+                    m.addTriangle((uint32_t)(f[0] - 1), (uint32_t)(f[1] - 1), (uint32_t)(f[2] - 1));
+                }
+            }
+        }
+        return !m.indices.empty();
+    }
+
+    // Heightfield grid with roughly the requested number of triangles
+    void writeGrid(const string& filename, size_t faces) {
+        size_t side = 2;
+        while ((side - 1) * (side - 1) * 2 < faces) side++;
+
+        mt19937 rng(42);
+        uniform_real_distribution<float> height(-0.05f, 0.05f);
+
+        FILE* out = fopen(filename.c_str(), "w");
+        fprintf(out, "# synthetic %zux%zu grid\n", side, side);
+        for (size_t y = 0; y < side; y++) {
+            for (size_t x = 0; x < side; x++) {
+                fprintf(out, "v %.6f %.6f %.6f\n", (float)x / side, (float)y / side, height(rng));
+            }
+        }
+        for (size_t y = 0; y + 1 < side; y++) {
+            for (size_t x = 0; x + 1 < side; x++) {
+                size_t i = y * side + x + 1;
+                fprintf(out, "f %zu %zu %zu\n", i, i + side, i + side + 1);
+                fprintf(out, "f %zu %zu %zu\n", i, i + side + 1, i + 1);
+            }
+        }
+        fclose(out);
+    }
+
+    template <typename F>
+    double timeSeconds(F run) {
+        auto start = chrono::steady_clock::now();
+        run();
+        return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    }
+}
+
+int main(int argc, char** argv) {
+    string filename = "objload_bench.obj";
+    if (argc > 2 && string(argv[1]) == "--generate") {
+        if (argc > 3) filename = argv[3];
+        writeGrid(filename, strtoull(argv[2], nullptr, 10));
+    } else if (argc > 1) {
+        filename = argv[1];
+    } else {
+        writeGrid(filename, 2000000);
+    }
+
+    ifstream sizeProbe(filename, ios::binary | ios::ate);
+    double megabytes = (double)sizeProbe.tellg() / (1024.0 * 1024.0);
+
+    // Streamed on every core, and on the calling thread alone like batch_render's
+    // per-core workers
+    ThreadPool pool;
+    mesh legacy, streamed, serial;
+    double legacySeconds = timeSeconds([&] { loadLegacy(legacy, filename); });
+    double streamedSeconds = timeSeconds([&] { streamed.loadFromObjectFile(filename, false, &pool); });
+    double serialSeconds = timeSeconds([&] { serial.loadFromObjectFile(filename, false); });
+
+    cout << filename << ": " << megabytes << " MB" << endl;
+    cout << "  legacy    " << megabytes / legacySeconds << " MB/s, "
+         << legacy.vertices.size() << " vertices, " << legacy.triangleCount() << " triangles" << endl;
+    cout << "  streaming " << megabytes / streamedSeconds << " MB/s, "
+         << streamed.vertices.size() << " vertices, " << streamed.triangleCount() << " triangles" << endl;
+    cout << "  serial    " << megabytes / serialSeconds << " MB/s" << endl;
+    cout << "  speedup   " << legacySeconds / streamedSeconds << "x" << endl;
+
+    // The first cached load parses and writes the sidecar, the second maps it
+    mesh warm, cached;
+    warm.loadFromObjectFile(filename, true, &pool);
+    double cachedSeconds = timeSeconds([&] { cached.loadFromObjectFile(filename, true, &pool); });
+    cout << "  cached    " << cachedSeconds * 1000.0 << " ms, "
+         << cached.vertices.size() << " vertices, " << cached.triangleCount() << " triangles" << endl;
+
+    return 0;
+}
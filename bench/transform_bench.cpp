@@ -0,0 +1,84 @@
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include "../include/engine.h"
+#include "../include/transform.h"
+
+using namespace Engine3D;
+using namespace std;
+
+// Compares the per-vertex matrix4x4::multiplyVector path with the batched SoA
+// transform at every SIMD level the CPU supports.
+//
+// Usage: transform_bench [vertex count] [iterations]
+
+namespace {
+    template <typename F>
+    double bestSeconds(int iterations, F run) {
+        double best = 1e30;
+        for (int i = 0; i < iterations; i++) {
+            auto start = chrono::steady_clock::now();
+            run();
+            double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            best = min(best, seconds);
+        }
+        return best;
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t count = argc > 1 ? strtoull(argv[1], nullptr, 10) : 1000000;
+    int iterations = argc > 2 ? atoi(argv[2]) : 20;
+
+    // Random points in front of the camera
+    mt19937 rng(1234);
+    uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    vector<vec3d> points(count);
+    VertexStream stream;
+    stream.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        points[i] = vec3d(dist(rng), dist(rng), dist(rng) + 3.0f);
+        stream.push_back(points[i]);
+    }
+
+    matrix4x4 projection;
+    populateMatrix(projection, 800, 600, 1000);
+
+    // Baseline: one multiplyVector per vertex
+    vector<vec3d> reference(count);
+    double baseline = bestSeconds(iterations, [&] {
+        for (size_t i = 0; i < count; i++) {
+            reference[i] = projection.multiplyVector(points[i]);
+        }
+    });
+
+    cout << "vertices: " << count << ", best of " << iterations << " runs" << endl;
+    cout << "  per-vertex    " << (count / baseline) / 1e6 << " Mverts/s" << endl;
+
+    SimdLevel detected = detectSimdLevel();
+    VertexStream out;
+    bool allMatch = true;
+    for (int level = (int)SimdLevel::Scalar; level <= (int)detected; level++) {
+        setSimdLevel((SimdLevel)level);
+
+        double seconds = bestSeconds(iterations, [&] {
+            transformPointsProjected(projection, stream, out);
+        });
+
+        bool match = true;
+        for (size_t i = 0; i < count && match; i++) {
+            vec3d p = out.get(i);
+            match = memcmp(&p, &reference[i], sizeof(vec3d)) == 0;
+        }
+        allMatch = allMatch && match;
+
+        cout << "  batch " << left << setw(7) << simdLevelName((SimdLevel)level)
+             << (count / seconds) / 1e6 << " Mverts/s, "
+             << baseline / seconds << "x" << (match ? "" : " (MISMATCH)") << endl;
+    }
+
+    return allMatch ? 0 : 1;
+}
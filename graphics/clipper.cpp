@@ -0,0 +1,93 @@
+#include "clipper.h"
+
+namespace Engine3D {
+
+    namespace {
+        ClipVertex lerp(const ClipVertex& a, const ClipVertex& b, float t) {
+            return ClipVertex{ a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t,
+                               a.z + (b.z - a.z) * t, a.w + (b.w - a.w) * t };
+        }
+
+        vec3d lerp(const vec3d& a, const vec3d& b, float t) {
+            return vec3d(a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t, a.z + (b.z - a.z) * t);
+        }
+
+        ShadedClipVertex lerp(const ShadedClipVertex& a, const ShadedClipVertex& b, float t) {
+            return ShadedClipVertex{ lerp(a.position, b.position, t), lerp(a.attribute, b.attribute, t),
+                                     lerp(a.texCoord, b.texCoord, t) };
+        }
+
+        ShadedScreenVertex lerp(const ShadedScreenVertex& a, const ShadedScreenVertex& b, float t) {
+            return ShadedScreenVertex{ lerp(a.position, b.position, t), lerp(a.attribute, b.attribute, t),
+                                       lerp(a.texCoord, b.texCoord, t) };
+        }
+
+        // Planes are tested on the position only, so shaded and plain polygons get
+        // the same crossings
+        const ClipVertex& positionOf(const ClipVertex& v) { return v; }
+        const ClipVertex& positionOf(const ShadedClipVertex& v) { return v.position; }
+        const vec3d& positionOf(const vec3d& v) { return v; }
+        const vec3d& positionOf(const ShadedScreenVertex& v) { return v.position; }
+
+        // One Sutherland-Hodgman pass. distance(v) is positive on the kept side.
+        // Crossings are always interpolated from the inside vertex, so the two
+        // triangles sharing an edge get bit-identical clip points and stay watertight.
+        template <typename Vertex, typename Distance>
+        int clipAgainst(const Vertex* in, int count, Vertex* out, Distance distance) {
+            int written = 0;
+            for (int i = 0; i < count; i++) {
+                const Vertex& current = in[i];
+                const Vertex& next = in[(i + 1) % count];
+                float dc = distance(positionOf(current));
+                float dn = distance(positionOf(next));
+
+                if (dc >= 0.0f) {
+                    out[written++] = current;
+                }
+                if ((dc >= 0.0f) != (dn >= 0.0f)) {
+                    out[written++] = dc >= 0.0f ? lerp(current, next, dc / (dc - dn))
+                                                : lerp(next, current, dn / (dn - dc));
+                }
+            }
+            return written;
+        }
+
+        template <typename Vertex>
+        int clipDepth(const Vertex* in, int count, Vertex* out) {
+            Vertex temp[MAX_CLIP_VERTICES];
+            count = clipAgainst(in, count, temp, [](const ClipVertex& v) { return v.z; });
+            if (count < 3) return 0;
+            count = clipAgainst(temp, count, out, [](const ClipVertex& v) { return v.w - v.z; });
+            return count < 3 ? 0 : count;
+        }
+
+        template <typename Vertex>
+        int clipScreen(const Vertex* in, int count, Vertex* out, float width, float height) {
+            Vertex temp[MAX_CLIP_VERTICES];
+            count = clipAgainst(in, count, temp, [](const vec3d& v) { return v.x; });
+            if (count < 3) return 0;
+            count = clipAgainst(temp, count, out, [&](const vec3d& v) { return width - v.x; });
+            if (count < 3) return 0;
+            count = clipAgainst(out, count, temp, [](const vec3d& v) { return v.y; });
+            if (count < 3) return 0;
+            count = clipAgainst(temp, count, out, [&](const vec3d& v) { return height - v.y; });
+            return count < 3 ? 0 : count;
+        }
+    }
+
+    int clipPolygonDepth(const ClipVertex* in, int count, ClipVertex* out) {
+        return clipDepth(in, count, out);
+    }
+
+    int clipPolygonDepth(const ShadedClipVertex* in, int count, ShadedClipVertex* out) {
+        return clipDepth(in, count, out);
+    }
+
+    int clipPolygonScreen(const vec3d* in, int count, vec3d* out, float width, float height) {
+        return clipScreen(in, count, out, width, height);
+    }
+
+    int clipPolygonScreen(const ShadedScreenVertex* in, int count, ShadedScreenVertex* out, float width, float height) {
+        return clipScreen(in, count, out, width, height);
+    }
+}
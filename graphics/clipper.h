@@ -0,0 +1,70 @@
+#ifndef CLIPPER_H
+#define CLIPPER_H
+
+#include <cstdint>
+#include "../include/engine.h"
+
+namespace Engine3D {
+
+    // Largest polygon a triangle can become: one extra vertex per clip plane
+    const int MAX_CLIP_VERTICES = 16;
+
+    // Outcode bits, one per plane a vertex lies outside of
+    enum ClipPlane : uint8_t {
+        CLIP_NEAR = 1 << 0,
+        CLIP_FAR = 1 << 1,
+        CLIP_LEFT = 1 << 2,
+        CLIP_RIGHT = 1 << 3,
+        CLIP_BOTTOM = 1 << 4,
+        CLIP_TOP = 1 << 5,
+        CLIP_DEPTH = CLIP_NEAR | CLIP_FAR,
+        CLIP_SCREEN = CLIP_LEFT | CLIP_RIGHT | CLIP_BOTTOM | CLIP_TOP
+    };
+
+    // Homogeneous clip space position, visible where -w <= x, y <= w and 0 <= z <= w
+    struct ClipVertex {
+        float x, y, z, w;
+    };
+
+    // Positions carrying a shading attribute (see RasterTriangle::attributes) and a
+    // texture coordinate, which are interpolated at the same crossings as the
+    // position. In clip space the texture coordinate is (u, v); in screen space it
+    // is the (u / w, v / w, 1 / w) form that is affine there.
+    struct ShadedClipVertex {
+        ClipVertex position;
+        vec3d attribute;
+        vec3d texCoord;
+    };
+
+    struct ShadedScreenVertex {
+        vec3d position;
+        vec3d attribute;
+        vec3d texCoord;
+    };
+
+    inline uint8_t computeOutcode(float x, float y, float z, float w) {
+        uint8_t code = 0;
+        if (z < 0.0f) code |= CLIP_NEAR;
+        if (z > w) code |= CLIP_FAR;
+        if (x < -w) code |= CLIP_LEFT;
+        if (x > w) code |= CLIP_RIGHT;
+        if (y < -w) code |= CLIP_BOTTOM;
+        if (y > w) code |= CLIP_TOP;
+        return code;
+    }
+
+    // Clip a convex polygon against the near (z = 0) and far (z = w) planes in clip
+    // space. For a perspective projection the near plane is z = zNear in view space,
+    // so nothing behind the camera survives to the perspective divide.
+    // Returns the number of vertices written to out.
+    int clipPolygonDepth(const ClipVertex* in, int count, ClipVertex* out);
+    int clipPolygonDepth(const ShadedClipVertex* in, int count, ShadedClipVertex* out);
+
+    // Clip a convex polygon in screen space (x, y in pixels, z depth) to the screen
+    // rectangle [0, width] x [0, height]. Depth is affine in screen space so it is
+    // interpolated linearly. Returns the number of vertices written to out.
+    int clipPolygonScreen(const vec3d* in, int count, vec3d* out, float width, float height);
+    int clipPolygonScreen(const ShadedScreenVertex* in, int count, ShadedScreenVertex* out, float width, float height);
+}
+
+#endif
@@ -0,0 +1,233 @@
+#include "hizbuffer.h"
+#include <algorithm>
+#include <cmath>
+
+namespace Engine3D {
+
+    namespace {
+        // The snapping and fill rule of rasterizeTriangle, which coverage has to match
+        const int SUBPIXEL_BITS = 8;
+        const int64_t SUBPIXEL_ONE = 1 << SUBPIXEL_BITS;
+        const int64_t SUBPIXEL_HALF = SUBPIXEL_ONE / 2;
+        const float GUARD_BAND = (float)(1 << 20);
+
+        // Depth added to what occluders store, for the rounding of the rasterizer's
+        // float depth planes: a minimum for anything tested against them, plus a
+        // share of the occluder's own depth range across its extent
+        const double DEPTH_SLACK = 1e-5;
+        const double DEPTH_EPSILON = 4e-6;
+
+        const uint16_t FULL_COVERAGE = 0xFFFF;
+
+        bool isTopLeft(int64_t dx, int64_t dy) {
+            return (dy == 0 && dx > 0) || dy < 0;
+        }
+
+        bool insideGuardBand(const vec3d& p) {
+            return std::isfinite(p.x) && std::isfinite(p.y) && std::isfinite(p.z) &&
+                   std::fabs(p.x) < GUARD_BAND && std::fabs(p.y) < GUARD_BAND;
+        }
+    }
+
+    HiZBuffer::HiZBuffer(int width, int height)
+        : width(width), height(height) {
+        cellsX = (width + CELL_SIZE - 1) / CELL_SIZE;
+        cellsY = (height + CELL_SIZE - 1) / CELL_SIZE;
+
+        // Pixels past the right and bottom edges never get drawn, so they count as
+        // covered from the start
+        outsideMask.assign((size_t)cellsX * cellsY, 0);
+        for (int cy = 0; cy < cellsY; cy++) {
+            for (int cx = 0; cx < cellsX; cx++) {
+                uint16_t mask = 0;
+                for (int i = 0; i < CELL_SIZE * CELL_SIZE; i++) {
+                    int x = cx * CELL_SIZE + i % CELL_SIZE;
+                    int y = cy * CELL_SIZE + i / CELL_SIZE;
+                    if (x >= width || y >= height) {
+                        mask |= (uint16_t)(1u << i);
+                    }
+                }
+                outsideMask[(size_t)cy * cellsX + cx] = mask;
+            }
+        }
+
+        int levelWidth = cellsX, levelHeight = cellsY;
+        while (true) {
+            levels.emplace_back((size_t)levelWidth * levelHeight, 1.0f);
+            levelWidths.push_back(levelWidth);
+            levelHeights.push_back(levelHeight);
+            if (levelWidth == 1 && levelHeight == 1) {
+                break;
+            }
+            levelWidth = (levelWidth + 1) / 2;
+            levelHeight = (levelHeight + 1) / 2;
+        }
+        clear();
+    }
+
+    void HiZBuffer::clear() {
+        hasOccluders = false;
+        coverage = outsideMask;
+        coverageDepth.assign(coverage.size(), 0.0f);
+        std::fill(levels[0].begin(), levels[0].end(), 1.0f);
+    }
+
+    void HiZBuffer::coverCell(size_t cell, uint16_t mask, float depth) {
+        // Nothing to gain from occluders behind what the cell already stores
+        float& stored = levels[0][cell];
+        if (!(depth < stored)) {
+            return;
+        }
+
+        coverage[cell] |= mask;
+        coverageDepth[cell] = std::max(coverageDepth[cell], depth);
+        if (coverage[cell] == FULL_COVERAGE) {
+            stored = coverageDepth[cell];
+            coverage[cell] = outsideMask[cell];
+            coverageDepth[cell] = 0.0f;
+            hasOccluders = true;
+        }
+    }
+
+    void HiZBuffer::addOccluder(const vec3d& v0, const vec3d& v1, const vec3d& v2) {
+        if (!insideGuardBand(v0) || !insideGuardBand(v1) || !insideGuardBand(v2)) {
+            return;
+        }
+
+        int64_t x0 = llroundf(v0.x * SUBPIXEL_ONE), y0 = llroundf(v0.y * SUBPIXEL_ONE);
+        int64_t x1 = llroundf(v1.x * SUBPIXEL_ONE), y1 = llroundf(v1.y * SUBPIXEL_ONE);
+        int64_t x2 = llroundf(v2.x * SUBPIXEL_ONE), y2 = llroundf(v2.y * SUBPIXEL_ONE);
+        double z0 = v0.z, z1 = v1.z, z2 = v2.z;
+
+        int64_t area = (x1 - x0) * (y2 - y0) - (y1 - y0) * (x2 - x0);
+        if (area == 0) {
+            return;
+        }
+        if (area < 0) {
+            std::swap(x1, x2);
+            std::swap(y1, y2);
+            std::swap(z1, z2);
+            area = -area;
+        }
+
+        // Pixel centers the triangle can cover, clamped to the screen
+        int64_t minX = std::max<int64_t>(0, (std::min({ x0, x1, x2 }) - SUBPIXEL_HALF + SUBPIXEL_ONE - 1) >> SUBPIXEL_BITS);
+        int64_t maxX = std::min<int64_t>(width - 1, (std::max({ x0, x1, x2 }) - SUBPIXEL_HALF) >> SUBPIXEL_BITS);
+        int64_t minY = std::max<int64_t>(0, (std::min({ y0, y1, y2 }) - SUBPIXEL_HALF + SUBPIXEL_ONE - 1) >> SUBPIXEL_BITS);
+        int64_t maxY = std::min<int64_t>(height - 1, (std::max({ y0, y1, y2 }) - SUBPIXEL_HALF) >> SUBPIXEL_BITS);
+        if (minX > maxX || minY > maxY) {
+            return;
+        }
+
+        // Edge functions at pixel centers like rasterizeTriangle: covered where
+        // w + bias >= 0 for all three
+        int64_t ax[3] = { x1, x2, x0 }, ay[3] = { y1, y2, y0 };
+        int64_t bx[3] = { x2, x0, x1 }, by[3] = { y2, y0, y1 };
+        int64_t bias[3];
+        for (int e = 0; e < 3; e++) {
+            bias[e] = isTopLeft(bx[e] - ax[e], by[e] - ay[e]) ? 0 : -1;
+        }
+        auto edge = [&](int e, int64_t px, int64_t py) {
+            return (bx[e] - ax[e]) * (py - ay[e]) - (by[e] - ay[e]) * (px - ax[e]) + bias[e];
+        };
+
+        // Depth plane over pixel centers; a cell's farthest depth is at one of the
+        // corners of its pixel centers, and never beyond the farthest vertex
+        double dzdx = ((z1 - z0) * (double)(y2 - y0) - (z2 - z0) * (double)(y1 - y0)) / (double)area * SUBPIXEL_ONE;
+        double dzdy = ((z2 - z0) * (double)(x1 - x0) - (z1 - z0) * (double)(x2 - x0)) / (double)area * SUBPIXEL_ONE;
+        double originX = (double)x0 / SUBPIXEL_ONE, originY = (double)y0 / SUBPIXEL_ONE;
+        double farthest = std::max({ z0, z1, z2 });
+        double slack = DEPTH_SLACK + DEPTH_EPSILON * (std::fabs(dzdx) * (double)(maxX - minX + 1) +
+                                                      std::fabs(dzdy) * (double)(maxY - minY + 1));
+
+        const int last = CELL_SIZE - 1;
+        for (int64_t cy = minY / CELL_SIZE; cy <= maxY / CELL_SIZE; cy++) {
+            for (int64_t cx = minX / CELL_SIZE; cx <= maxX / CELL_SIZE; cx++) {
+                // Centers of the cell's corner pixels, in subpixels
+                int64_t px0 = cx * CELL_SIZE * SUBPIXEL_ONE + SUBPIXEL_HALF;
+                int64_t py0 = cy * CELL_SIZE * SUBPIXEL_ONE + SUBPIXEL_HALF;
+                int64_t px1 = px0 + last * SUBPIXEL_ONE, py1 = py0 + last * SUBPIXEL_ONE;
+
+                // Edge functions are affine, so the corners decide whole cells
+                bool inside = true, outside = false;
+                for (int e = 0; e < 3 && !outside; e++) {
+                    int64_t w00 = edge(e, px0, py0), w10 = edge(e, px1, py0);
+                    int64_t w01 = edge(e, px0, py1), w11 = edge(e, px1, py1);
+                    outside = w00 < 0 && w10 < 0 && w01 < 0 && w11 < 0;
+                    inside = inside && w00 >= 0 && w10 >= 0 && w01 >= 0 && w11 >= 0;
+                }
+                if (outside) {
+                    continue;
+                }
+
+                uint16_t mask = FULL_COVERAGE;
+                if (!inside) {
+                    mask = 0;
+                    for (int i = 0; i < CELL_SIZE * CELL_SIZE; i++) {
+                        int64_t px = px0 + (i % CELL_SIZE) * SUBPIXEL_ONE;
+                        int64_t py = py0 + (i / CELL_SIZE) * SUBPIXEL_ONE;
+                        if (edge(0, px, py) >= 0 && edge(1, px, py) >= 0 && edge(2, px, py) >= 0) {
+                            mask |= (uint16_t)(1u << i);
+                        }
+                    }
+                    if (mask == 0) {
+                        continue;
+                    }
+                }
+
+                double cornerX = (double)(cx * CELL_SIZE) + 0.5 - originX;
+                double cornerY = (double)(cy * CELL_SIZE) + 0.5 - originY;
+                double depth = z0 + std::max(dzdx * cornerX, dzdx * (cornerX + last)) +
+                                    std::max(dzdy * cornerY, dzdy * (cornerY + last));
+                depth = std::min(depth, farthest) + slack;
+                coverCell((size_t)cy * cellsX + (size_t)cx, mask, (float)depth);
+            }
+        }
+    }
+
+    void HiZBuffer::build() {
+        for (size_t level = 1; level < levels.size(); level++) {
+            const std::vector<float>& below = levels[level - 1];
+            int belowWidth = levelWidths[level - 1], belowHeight = levelHeights[level - 1];
+            std::vector<float>& above = levels[level];
+            for (int y = 0; y < levelHeights[level]; y++) {
+                for (int x = 0; x < levelWidths[level]; x++) {
+                    int x0 = 2 * x, y0 = 2 * y;
+                    int x1 = std::min(x0 + 1, belowWidth - 1), y1 = std::min(y0 + 1, belowHeight - 1);
+                    above[(size_t)y * levelWidths[level] + x] = std::max(
+                        std::max(below[(size_t)y0 * belowWidth + x0], below[(size_t)y0 * belowWidth + x1]),
+                        std::max(below[(size_t)y1 * belowWidth + x0], below[(size_t)y1 * belowWidth + x1]));
+                }
+            }
+        }
+    }
+
+    bool HiZBuffer::isOccluded(const OcclusionBounds& bounds) const {
+        // Also rejects NaN bounds
+        if (!hasOccluders || !(bounds.maxX >= 0.0f && bounds.minX < (float)width &&
+                               bounds.maxY >= 0.0f && bounds.minY < (float)height)) {
+            return false;
+        }
+
+        int x0 = (int)std::max(bounds.minX, 0.0f) / CELL_SIZE;
+        int y0 = (int)std::max(bounds.minY, 0.0f) / CELL_SIZE;
+        int x1 = (int)std::min(bounds.maxX, (float)(width - 1)) / CELL_SIZE;
+        int y1 = (int)std::min(bounds.maxY, (float)(height - 1)) / CELL_SIZE;
+
+        // The finest level where the rectangle spans at most 2 x 2 texels
+        size_t level = 0;
+        while ((x1 >> level) - (x0 >> level) > 1 || (y1 >> level) - (y0 >> level) > 1) {
+            level++;
+        }
+        const std::vector<float>& texels = levels[level];
+        int levelWidth = levelWidths[level];
+        for (int y = y0 >> level; y <= y1 >> level; y++) {
+            for (int x = x0 >> level; x <= x1 >> level; x++) {
+                if (!(bounds.minZ > texels[(size_t)y * levelWidth + x])) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+}
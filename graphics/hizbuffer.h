@@ -0,0 +1,64 @@
+#ifndef HIZBUFFER_H
+#define HIZBUFFER_H
+
+#include <vector>
+#include <cstdint>
+#include "../include/engine.h"
+
+namespace Engine3D {
+
+    // Screen space extent of something to test for occlusion: a pixel rectangle
+    // and the nearest depth anything inside it can have
+    struct OcclusionBounds {
+        float minX, minY, maxX, maxY;
+        float minZ;
+    };
+
+    // Hierarchical depth buffer for occlusion culling. Occluder triangles are
+    // rasterized at low resolution: one depth per CELL_SIZE x CELL_SIZE pixel cell,
+    // the farthest depth they leave in any of its pixels, stored only once the
+    // occluders together cover every pixel of the cell. Coverage follows the rules
+    // of rasterizeTriangle exactly, so a cell's depth bounds what the z-buffer will
+    // hold there as long as the occluders are drawn with depth testing. Levels of
+    // 2 x 2 maxima above the cells answer a rectangle with at most four lookups.
+    class HiZBuffer {
+        private:
+            static const int CELL_SIZE = 4;
+
+            int width, height;  // in pixels
+            int cellsX, cellsY;
+            bool hasOccluders;
+
+            // Per cell: the pixels covered by occluders since its depth was last
+            // lowered, and the farthest depth of those occluders
+            std::vector<uint16_t> coverage;
+            std::vector<uint16_t> outsideMask;  // pixels beyond the screen edge
+            std::vector<float> coverageDepth;
+
+            // levels[0] holds the cell depths, every further level the maximum of
+            // 2 x 2 texels of the one below
+            std::vector<std::vector<float>> levels;
+            std::vector<int> levelWidths, levelHeights;
+
+            void coverCell(size_t cell, uint16_t mask, float depth);
+
+        public:
+            HiZBuffer(int width, int height);
+
+            // Forget every occluder
+            void clear();
+
+            // Add an occluder in screen space (x, y in pixels, z in [0, 1]), either
+            // winding. Call build() once the last one is in.
+            void addOccluder(const vec3d& v0, const vec3d& v1, const vec3d& v2);
+            void build();
+
+            bool empty() const { return !hasOccluders; }
+
+            // True if everything within bounds is behind the occluders, so none of it
+            // could pass the depth test
+            bool isOccluded(const OcclusionBounds& bounds) const;
+    };
+}
+
+#endif
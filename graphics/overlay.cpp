@@ -0,0 +1,86 @@
+#include "overlay.h"
+#include <algorithm>
+#include <cctype>
+
+namespace Engine3D {
+
+    namespace {
+        // Rows top to bottom, bit 2 is the left column
+        struct Glyph {
+            char c;
+            uint8_t rows[5];
+        };
+
+        const Glyph FONT[] = {
+            { '0', { 7, 5, 5, 5, 7 } }, { '1', { 2, 6, 2, 2, 7 } }, { '2', { 7, 1, 7, 4, 7 } },
+            { '3', { 7, 1, 3, 1, 7 } }, { '4', { 5, 5, 7, 1, 1 } }, { '5', { 7, 4, 7, 1, 7 } },
+            { '6', { 7, 4, 7, 5, 7 } }, { '7', { 7, 1, 1, 2, 2 } }, { '8', { 7, 5, 7, 5, 7 } },
+            { '9', { 7, 5, 7, 1, 7 } }, { 'A', { 2, 5, 7, 5, 5 } }, { 'B', { 6, 5, 6, 5, 6 } },
+            { 'C', { 3, 4, 4, 4, 3 } }, { 'D', { 6, 5, 5, 5, 6 } }, { 'E', { 7, 4, 6, 4, 7 } },
+            { 'F', { 7, 4, 6, 4, 4 } }, { 'G', { 3, 4, 5, 5, 3 } }, { 'H', { 5, 5, 7, 5, 5 } },
+            { 'I', { 7, 2, 2, 2, 7 } }, { 'J', { 1, 1, 1, 5, 2 } }, { 'K', { 5, 5, 6, 5, 5 } },
+            { 'L', { 4, 4, 4, 4, 7 } }, { 'M', { 5, 7, 7, 5, 5 } }, { 'N', { 6, 5, 5, 5, 5 } },
+            { 'O', { 2, 5, 5, 5, 2 } }, { 'P', { 6, 5, 6, 4, 4 } }, { 'Q', { 2, 5, 5, 6, 3 } },
+            { 'R', { 6, 5, 6, 5, 5 } }, { 'S', { 3, 4, 2, 1, 6 } }, { 'T', { 7, 2, 2, 2, 2 } },
+            { 'U', { 5, 5, 5, 5, 7 } }, { 'V', { 5, 5, 5, 5, 2 } }, { 'W', { 5, 5, 7, 7, 5 } },
+            { 'X', { 5, 5, 2, 5, 5 } }, { 'Y', { 5, 5, 2, 2, 2 } }, { 'Z', { 7, 1, 2, 4, 7 } },
+            { '.', { 0, 0, 0, 0, 2 } }, { ':', { 0, 2, 0, 2, 0 } }, { '/', { 1, 1, 2, 4, 4 } },
+            { '-', { 0, 0, 7, 0, 0 } }, { '%', { 5, 1, 2, 4, 5 } }
+        };
+
+        const Glyph* findGlyph(char c) {
+            c = (char)std::toupper((unsigned char)c);
+            for (const Glyph& glyph : FONT) {
+                if (glyph.c == c) {
+                    return &glyph;
+                }
+            }
+            return nullptr;
+        }
+    }
+
+    void fillOverlayRect(FrameBuffer& fb, int x0, int y0, int x1, int y1, uint32_t color) {
+        x0 = std::max(x0, 0);
+        y0 = std::max(y0, 0);
+        x1 = std::min(x1, fb.width);
+        y1 = std::min(y1, fb.height);
+        for (int y = y0; y < y1 && x0 < x1; y++) {
+            uint32_t* row = fb.color.data() + (size_t)y * fb.width;
+            std::fill(row + x0, row + x1, color);
+        }
+    }
+
+    void shadeOverlayRect(FrameBuffer& fb, int x0, int y0, int x1, int y1, uint32_t color) {
+        x0 = std::max(x0, 0);
+        y0 = std::max(y0, 0);
+        x1 = std::min(x1, fb.width);
+        y1 = std::min(y1, fb.height);
+
+        // Average each channel: halve both and add, dropping the low bits
+        uint32_t half = (color >> 1) & 0x7F7F7F7Fu;
+        for (int y = y0; y < y1; y++) {
+            uint32_t* row = fb.color.data() + (size_t)y * fb.width;
+            for (int x = x0; x < x1; x++) {
+                row[x] = (((row[x] >> 1) & 0x7F7F7F7Fu) + half) | 0xFF000000u;
+            }
+        }
+    }
+
+    int drawOverlayText(FrameBuffer& fb, int x, int y, const std::string& text, uint32_t color, int scale) {
+        for (char c : text) {
+            const Glyph* glyph = findGlyph(c);
+            if (glyph) {
+                for (int row = 0; row < 5; row++) {
+                    for (int column = 0; column < 3; column++) {
+                        if (glyph->rows[row] & (4 >> column)) {
+                            int px = x + column * scale, py = y + row * scale;
+                            fillOverlayRect(fb, px, py, px + scale, py + scale, color);
+                        }
+                    }
+                }
+            }
+            x += 4 * scale;
+        }
+        return x;
+    }
+}
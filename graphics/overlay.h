@@ -0,0 +1,27 @@
+#ifndef OVERLAY_H
+#define OVERLAY_H
+
+#include <cstdint>
+#include <string>
+#include "rasterizer.h"
+
+namespace Engine3D {
+
+    // Height of a text line drawn at the given scale, in pixels
+    inline int overlayLineHeight(int scale) {
+        return 7 * scale;
+    }
+
+    // Draw text with a built-in 3x5 pixel font, each font pixel scale x scale screen
+    // pixels. Covers digits, letters (drawn upper case), space and . : / % -
+    // Returns the x coordinate after the last character.
+    int drawOverlayText(FrameBuffer& fb, int x, int y, const std::string& text, uint32_t color, int scale = 1);
+
+    // Blend a rectangle [x0, x1) x [y0, y1) halfway towards color, clipped to the buffer
+    void shadeOverlayRect(FrameBuffer& fb, int x0, int y0, int x1, int y1, uint32_t color);
+
+    // Solid rectangle [x0, x1) x [y0, y1), clipped to the buffer
+    void fillOverlayRect(FrameBuffer& fb, int x0, int y0, int x1, int y1, uint32_t color);
+}
+
+#endif
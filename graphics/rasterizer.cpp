@@ -0,0 +1,886 @@
+#include "rasterizer.h"
+#include "../include/texture.h"
+#include "../include/transform.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define ENGINE_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+namespace Engine3D {
+
+    namespace {
+        // Vertex positions are snapped to 1/256th of a pixel so edge functions can be
+        // evaluated exactly in 64-bit integers
+        const int SUBPIXEL_BITS = 8;
+        const int64_t SUBPIXEL_ONE = 1 << SUBPIXEL_BITS;
+        const int64_t SUBPIXEL_HALF = SUBPIXEL_ONE / 2;
+
+        // Coordinates further than this from the origin could overflow the edge
+        // functions, so triangles reaching that far are rejected
+        const float GUARD_BAND = (float)(1 << 20);
+
+        int64_t floorDiv(int64_t n, int64_t d) {
+            return n >= 0 ? n / d : -((-n + d - 1) / d);
+        }
+
+        int64_t ceilDiv(int64_t n, int64_t d) {
+            return -floorDiv(-n, d);
+        }
+
+        bool insideGuardBand(const vec3d& p) {
+            return std::isfinite(p.x) && std::isfinite(p.y) && std::isfinite(p.z) &&
+                   std::fabs(p.x) < GUARD_BAND && std::fabs(p.y) < GUARD_BAND;
+        }
+
+        // Top-left fill rule: pixels exactly on an edge belong to the triangle only if
+        // the edge is a top or a left edge, so shared edges are never drawn twice
+        bool isTopLeft(int64_t dx, int64_t dy) {
+            return (dy == 0 && dx > 0) || dy < 0;
+        }
+
+        // One row of covered pixels. Depth and the shading attributes are planes over
+        // the pixel centers; a row holds their values at x = originX of that row, and
+        // a pixel adds its slope times (x - originX). Rows are set up from y alone, so
+        // a pixel gets the same values whichever tile or span it is drawn in.
+        struct Span {
+            float originX;
+            float z, dzdx;
+            float a[3], dadx[3];  // Gouraud intensity in a[0], or the Phong normal
+            float light[3];
+            uint32_t color;
+            ShadingMode shading;
+            bool depthTest;
+            BlendMode blend;
+
+            // Textured only (texels is nullptr otherwise): planes of u and v in level 0
+            // texels times q = 1 / w, and of q, with the y slopes for the mip selection
+            const uint32_t* texels;
+            const int32_t* levelOffsets;
+            float tc[3], dtcdx[3], dtcdy[3];
+            uint32_t widthMask, heightMask;  // level 0 sides minus one
+            int32_t baseShift, maxLevel;     // level 0 Morton block shift, last level
+        };
+
+        // Every kernel computes a pixel with the same operations in the same order,
+        // with separate multiplies and adds, so all levels write identical pixels.
+        // SIMD kernels only process whole vectors and return where they stopped; the
+        // scalar kernel finishes the span.
+
+        inline uint32_t grayLevel(float intensity) {
+            // Comparisons written so NaN becomes 0, like the SIMD max/min
+            intensity = intensity > 0.0f ? intensity : 0.0f;
+            intensity = intensity < 1.0f ? intensity : 1.0f;
+            uint32_t level = (uint32_t)(int)(intensity * 255.0f);
+            return 0xFF000000u | (level << 16) | (level << 8) | level;
+        }
+
+        inline uint32_t floatBits(float f) {
+            uint32_t bits;
+            std::memcpy(&bits, &f, sizeof(bits));
+            return bits;
+        }
+
+        inline float bitsFloat(uint32_t bits) {
+            float f;
+            std::memcpy(&f, &bits, sizeof(f));
+            return f;
+        }
+
+        // Rounded down like cvttps2dq followed by a fix up, so NaN and out of range
+        // values give the same (masked off) integers as the SIMD kernels
+        inline int32_t floorToInt(float f) {
+            int32_t i = f > -2147483648.0f && f < 2147483648.0f ? (int32_t)f : INT32_MIN;
+            return (float)i > f ? (int32_t)((uint32_t)i - 1u) : i;
+        }
+
+        // Nearest texel at level 0 texel coordinates (u, v), from the mip level closest
+        // to log2 of the footprint, whose square is rho2
+        inline uint32_t fetchTexel(const Span& s, float u, float v, float rho2) {
+            int32_t level = ((int32_t)((floatBits(rho2) >> 23) & 0xFF) - 126) >> 1;
+            level = level > 0 ? level : 0;
+            level = level < s.maxLevel ? level : s.maxLevel;
+            float scale = bitsFloat((uint32_t)(127 - level) << 23);
+            uint32_t x = (uint32_t)floorToInt(u * scale) & (s.widthMask >> level);
+            uint32_t y = (uint32_t)floorToInt(v * scale) & (s.heightMask >> level);
+            int shift = s.baseShift > level ? s.baseShift - level : 0;
+            return s.texels[s.levelOffsets[level] + Texture::mortonIndex(x, y, shift)];
+        }
+
+        inline uint32_t sampleTexture(const Span& s, float t) {
+            float uq = s.tc[0] + s.dtcdx[0] * t;
+            float vq = s.tc[1] + s.dtcdx[1] * t;
+            float q = s.tc[2] + s.dtcdx[2] * t;
+            float invq = 1.0f / q;
+            float u = uq * invq;
+            float v = vq * invq;
+
+            // Derivatives of u = uq / q and v = vq / q give the pixel's footprint
+            float dudx = (s.dtcdx[0] - u * s.dtcdx[2]) * invq;
+            float dvdx = (s.dtcdx[1] - v * s.dtcdx[2]) * invq;
+            float dudy = (s.dtcdy[0] - u * s.dtcdy[2]) * invq;
+            float dvdy = (s.dtcdy[1] - v * s.dtcdy[2]) * invq;
+            float rx = dudx * dudx + dvdx * dvdx;
+            float ry = dudy * dudy + dvdy * dvdy;
+            return fetchTexel(s, u, v, rx > ry ? rx : ry);
+        }
+
+        // Texel times color per channel, with 255 leaving the texel as it is
+        inline uint32_t modulate(uint32_t texel, uint32_t color) {
+            uint32_t result = 0;
+            for (int c = 0; c < 32; c += 8) {
+                uint32_t product = ((texel >> c) & 0xFF) * (((color >> c) & 0xFF) + 1);
+                result |= (product >> 8) << c;
+            }
+            return result;
+        }
+
+        // Color over what the pixel holds, weighted by the color's alpha, which 255
+        // makes replace it
+        inline uint32_t blend(uint32_t color, uint32_t old) {
+            uint32_t alpha = color >> 24;
+            uint32_t weight = alpha + (alpha >> 7);
+            uint32_t result = 0;
+            for (int c = 0; c < 32; c += 8) {
+                uint32_t mixed = ((color >> c) & 0xFF) * weight + ((old >> c) & 0xFF) * (256 - weight);
+                result |= (mixed >> 8) << c;
+            }
+            return result;
+        }
+
+        // Pipeline state a span kernel is compiled for. With a FixedState the tests
+        // of the kernels fold away at compile time; RuntimeState reads the same
+        // state from the span for every pixel instead.
+        template <bool DepthTest, ShadingMode Shading, bool Textured, BlendMode Blend>
+        struct FixedState {
+            static bool depthTest(const Span&) { return DepthTest; }
+            static ShadingMode shading(const Span&) { return Shading; }
+            static bool textured(const Span&) { return Textured; }
+            static bool blended(const Span&) { return Blend == BlendMode::Alpha; }
+        };
+
+        struct RuntimeState {
+            static bool depthTest(const Span& s) { return s.depthTest; }
+            static ShadingMode shading(const Span& s) { return s.shading; }
+            static bool textured(const Span& s) { return s.texels != nullptr; }
+            static bool blended(const Span& s) { return s.blend == BlendMode::Alpha; }
+        };
+
+        template <typename State>
+        uint32_t spanScalar(const Span& s, int x, int end, uint32_t* colorRow, float* depthRow) {
+            uint32_t written = 0;
+            for (; x <= end; x++) {
+                float t = (float)x - s.originX;
+                float z = s.z + s.dzdx * t;
+                if (State::depthTest(s) && !(z < depthRow[x])) {
+                    continue;
+                }
+
+                uint32_t color = s.color;
+                if (State::shading(s) == ShadingMode::Gouraud) {
+                    color = grayLevel(s.a[0] + s.dadx[0] * t);
+                } else if (State::shading(s) == ShadingMode::Phong) {
+                    float nx = s.a[0] + s.dadx[0] * t;
+                    float ny = s.a[1] + s.dadx[1] * t;
+                    float nz = s.a[2] + s.dadx[2] * t;
+                    float d = nx * s.light[0] + ny * s.light[1] + nz * s.light[2];
+                    float length = std::sqrt(nx * nx + ny * ny + nz * nz);
+                    color = grayLevel(d / length);
+                }
+                if (State::textured(s)) {
+                    color = modulate(sampleTexture(s, t), color);
+                }
+                if (State::blended(s)) {
+                    colorRow[x] = blend(color, colorRow[x]);
+                } else {
+                    depthRow[x] = z;
+                    colorRow[x] = color;
+                }
+                written++;
+            }
+            return written;
+        }
+
+#ifdef ENGINE_X86_SIMD
+
+        __attribute__((target("sse2")))
+        inline __m128i grayLevelSSE(__m128 intensity) {
+            intensity = _mm_min_ps(_mm_max_ps(intensity, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+            __m128i level = _mm_cvttps_epi32(_mm_mul_ps(intensity, _mm_set1_ps(255.0f)));
+            __m128i gray = _mm_or_si128(_mm_or_si128(_mm_slli_epi32(level, 16), _mm_slli_epi32(level, 8)), level);
+            return _mm_or_si128(gray, _mm_set1_epi32((int)0xFF000000u));
+        }
+
+        __attribute__((target("sse2")))
+        inline __m128i modulateSSE(__m128i texel, __m128i color) {
+            const __m128i zero = _mm_setzero_si128(), one = _mm_set1_epi16(1);
+            __m128i lo = _mm_mullo_epi16(_mm_unpacklo_epi8(texel, zero), _mm_add_epi16(_mm_unpacklo_epi8(color, zero), one));
+            __m128i hi = _mm_mullo_epi16(_mm_unpackhi_epi8(texel, zero), _mm_add_epi16(_mm_unpackhi_epi8(color, zero), one));
+            return _mm_packus_epi16(_mm_srli_epi16(lo, 8), _mm_srli_epi16(hi, 8));
+        }
+
+        // blend for four pixels, each pixel's weight spread over its four channels
+        __attribute__((target("sse2")))
+        inline __m128i blendSSE(__m128i color, __m128i old) {
+            __m128i alpha = _mm_srli_epi32(color, 24);
+            __m128i weight = _mm_add_epi32(alpha, _mm_srli_epi32(alpha, 7));
+            weight = _mm_or_si128(weight, _mm_slli_epi32(weight, 16));
+            __m128i weightLo = _mm_unpacklo_epi32(weight, weight), weightHi = _mm_unpackhi_epi32(weight, weight);
+            const __m128i zero = _mm_setzero_si128(), full = _mm_set1_epi16(256);
+            __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(color, zero), weightLo),
+                                       _mm_mullo_epi16(_mm_unpacklo_epi8(old, zero), _mm_sub_epi16(full, weightLo)));
+            __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(color, zero), weightHi),
+                                       _mm_mullo_epi16(_mm_unpackhi_epi8(old, zero), _mm_sub_epi16(full, weightHi)));
+            return _mm_packus_epi16(_mm_srli_epi16(lo, 8), _mm_srli_epi16(hi, 8));
+        }
+
+        // Coordinates and footprint for four pixels; SSE2 has no gathers, so the
+        // texels are fetched one lane at a time
+        __attribute__((target("sse2")))
+        __m128i sampleTextureSSE(const Span& s, __m128 t) {
+            __m128 uq = _mm_add_ps(_mm_set1_ps(s.tc[0]), _mm_mul_ps(_mm_set1_ps(s.dtcdx[0]), t));
+            __m128 vq = _mm_add_ps(_mm_set1_ps(s.tc[1]), _mm_mul_ps(_mm_set1_ps(s.dtcdx[1]), t));
+            __m128 q = _mm_add_ps(_mm_set1_ps(s.tc[2]), _mm_mul_ps(_mm_set1_ps(s.dtcdx[2]), t));
+            __m128 invq = _mm_div_ps(_mm_set1_ps(1.0f), q);
+            __m128 u = _mm_mul_ps(uq, invq);
+            __m128 v = _mm_mul_ps(vq, invq);
+
+            __m128 dudx = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(s.dtcdx[0]), _mm_mul_ps(u, _mm_set1_ps(s.dtcdx[2]))), invq);
+            __m128 dvdx = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(s.dtcdx[1]), _mm_mul_ps(v, _mm_set1_ps(s.dtcdx[2]))), invq);
+            __m128 dudy = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(s.dtcdy[0]), _mm_mul_ps(u, _mm_set1_ps(s.dtcdy[2]))), invq);
+            __m128 dvdy = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(s.dtcdy[1]), _mm_mul_ps(v, _mm_set1_ps(s.dtcdy[2]))), invq);
+            __m128 rx = _mm_add_ps(_mm_mul_ps(dudx, dudx), _mm_mul_ps(dvdx, dvdx));
+            __m128 ry = _mm_add_ps(_mm_mul_ps(dudy, dudy), _mm_mul_ps(dvdy, dvdy));
+
+            alignas(16) float us[4], vs[4], rho2[4];
+            alignas(16) uint32_t texels[4];
+            _mm_store_ps(us, u);
+            _mm_store_ps(vs, v);
+            _mm_store_ps(rho2, _mm_max_ps(rx, ry));
+            for (int i = 0; i < 4; i++) {
+                texels[i] = fetchTexel(s, us[i], vs[i], rho2[i]);
+            }
+            return _mm_load_si128((const __m128i*)texels);
+        }
+
+        template <typename State>
+        __attribute__((target("sse2")))
+        int spanSSE(const Span& s, int x, int end, uint32_t* colorRow, float* depthRow, uint32_t& written) {
+            const __m128 lanes = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+            const __m128 originX = _mm_set1_ps(s.originX);
+            const __m128 z0 = _mm_set1_ps(s.z), dzdx = _mm_set1_ps(s.dzdx);
+            for (; x + 3 <= end; x += 4) {
+                __m128 t = _mm_sub_ps(_mm_add_ps(_mm_set1_ps((float)x), lanes), originX);
+                __m128 z = _mm_add_ps(z0, _mm_mul_ps(dzdx, t));
+                __m128 depth = _mm_loadu_ps(depthRow + x);
+                __m128 mask = State::depthTest(s) ? _mm_cmplt_ps(z, depth) : _mm_castsi128_ps(_mm_set1_epi32(-1));
+                int bits = _mm_movemask_ps(mask);
+                if (bits == 0) {
+                    continue;
+                }
+
+                __m128i color = _mm_set1_epi32((int)s.color);
+                if (State::shading(s) == ShadingMode::Gouraud) {
+                    color = grayLevelSSE(_mm_add_ps(_mm_set1_ps(s.a[0]), _mm_mul_ps(_mm_set1_ps(s.dadx[0]), t)));
+                } else if (State::shading(s) == ShadingMode::Phong) {
+                    __m128 nx = _mm_add_ps(_mm_set1_ps(s.a[0]), _mm_mul_ps(_mm_set1_ps(s.dadx[0]), t));
+                    __m128 ny = _mm_add_ps(_mm_set1_ps(s.a[1]), _mm_mul_ps(_mm_set1_ps(s.dadx[1]), t));
+                    __m128 nz = _mm_add_ps(_mm_set1_ps(s.a[2]), _mm_mul_ps(_mm_set1_ps(s.dadx[2]), t));
+                    __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, _mm_set1_ps(s.light[0])), _mm_mul_ps(ny, _mm_set1_ps(s.light[1]))),
+                                          _mm_mul_ps(nz, _mm_set1_ps(s.light[2])));
+                    __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nx), _mm_mul_ps(ny, ny)), _mm_mul_ps(nz, nz)));
+                    color = grayLevelSSE(_mm_div_ps(d, length));
+                }
+                if (State::textured(s)) {
+                    color = modulateSSE(sampleTextureSSE(s, t), color);
+                }
+
+                __m128i keep = _mm_castps_si128(mask);
+                __m128i oldColor = _mm_loadu_si128((const __m128i*)(colorRow + x));
+                if (State::blended(s)) {
+                    color = blendSSE(color, oldColor);
+                } else {
+                    _mm_storeu_ps(depthRow + x, _mm_or_ps(_mm_and_ps(mask, z), _mm_andnot_ps(mask, depth)));
+                }
+                _mm_storeu_si128((__m128i*)(colorRow + x), _mm_or_si128(_mm_and_si128(keep, color), _mm_andnot_si128(keep, oldColor)));
+                written += (uint32_t)__builtin_popcount(bits);
+            }
+            return x;
+        }
+
+        __attribute__((target("avx2")))
+        inline __m256i grayLevelAVX2(__m256 intensity) {
+            intensity = _mm256_min_ps(_mm256_max_ps(intensity, _mm256_setzero_ps()), _mm256_set1_ps(1.0f));
+            __m256i level = _mm256_cvttps_epi32(_mm256_mul_ps(intensity, _mm256_set1_ps(255.0f)));
+            __m256i gray = _mm256_or_si256(_mm256_or_si256(_mm256_slli_epi32(level, 16), _mm256_slli_epi32(level, 8)), level);
+            return _mm256_or_si256(gray, _mm256_set1_epi32((int)0xFF000000u));
+        }
+
+        __attribute__((target("avx2")))
+        inline __m256i modulateAVX2(__m256i texel, __m256i color) {
+            const __m256i zero = _mm256_setzero_si256(), one = _mm256_set1_epi16(1);
+            __m256i lo = _mm256_mullo_epi16(_mm256_unpacklo_epi8(texel, zero), _mm256_add_epi16(_mm256_unpacklo_epi8(color, zero), one));
+            __m256i hi = _mm256_mullo_epi16(_mm256_unpackhi_epi8(texel, zero), _mm256_add_epi16(_mm256_unpackhi_epi8(color, zero), one));
+            return _mm256_packus_epi16(_mm256_srli_epi16(lo, 8), _mm256_srli_epi16(hi, 8));
+        }
+
+        __attribute__((target("avx2")))
+        inline __m256i blendAVX2(__m256i color, __m256i old) {
+            __m256i alpha = _mm256_srli_epi32(color, 24);
+            __m256i weight = _mm256_add_epi32(alpha, _mm256_srli_epi32(alpha, 7));
+            weight = _mm256_or_si256(weight, _mm256_slli_epi32(weight, 16));
+            __m256i weightLo = _mm256_unpacklo_epi32(weight, weight), weightHi = _mm256_unpackhi_epi32(weight, weight);
+            const __m256i zero = _mm256_setzero_si256(), full = _mm256_set1_epi16(256);
+            __m256i lo = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(color, zero), weightLo),
+                                          _mm256_mullo_epi16(_mm256_unpacklo_epi8(old, zero), _mm256_sub_epi16(full, weightLo)));
+            __m256i hi = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(color, zero), weightHi),
+                                          _mm256_mullo_epi16(_mm256_unpackhi_epi8(old, zero), _mm256_sub_epi16(full, weightHi)));
+            return _mm256_packus_epi16(_mm256_srli_epi16(lo, 8), _mm256_srli_epi16(hi, 8));
+        }
+
+        __attribute__((target("avx2")))
+        inline __m256i spreadBitsAVX2(__m256i v) {
+            v = _mm256_and_si256(_mm256_or_si256(v, _mm256_slli_epi32(v, 8)), _mm256_set1_epi32(0x00FF00FF));
+            v = _mm256_and_si256(_mm256_or_si256(v, _mm256_slli_epi32(v, 4)), _mm256_set1_epi32(0x0F0F0F0F));
+            v = _mm256_and_si256(_mm256_or_si256(v, _mm256_slli_epi32(v, 2)), _mm256_set1_epi32(0x33333333));
+            v = _mm256_and_si256(_mm256_or_si256(v, _mm256_slli_epi32(v, 1)), _mm256_set1_epi32(0x55555555));
+            return v;
+        }
+
+        __attribute__((target("avx2")))
+        inline __m256i floorToIntAVX2(__m256 f) {
+            __m256i i = _mm256_cvttps_epi32(f);
+            __m256 above = _mm256_cmp_ps(_mm256_cvtepi32_ps(i), f, _CMP_GT_OQ);
+            return _mm256_add_epi32(i, _mm256_castps_si256(above));
+        }
+
+        // sampleTexture and fetchTexel for eight pixels, with the Morton addressing
+        // done in vector registers and the texels gathered
+        __attribute__((target("avx2")))
+        __m256i sampleTextureAVX2(const Span& s, __m256 t) {
+            __m256 uq = _mm256_add_ps(_mm256_set1_ps(s.tc[0]), _mm256_mul_ps(_mm256_set1_ps(s.dtcdx[0]), t));
+            __m256 vq = _mm256_add_ps(_mm256_set1_ps(s.tc[1]), _mm256_mul_ps(_mm256_set1_ps(s.dtcdx[1]), t));
+            __m256 q = _mm256_add_ps(_mm256_set1_ps(s.tc[2]), _mm256_mul_ps(_mm256_set1_ps(s.dtcdx[2]), t));
+            __m256 invq = _mm256_div_ps(_mm256_set1_ps(1.0f), q);
+            __m256 u = _mm256_mul_ps(uq, invq);
+            __m256 v = _mm256_mul_ps(vq, invq);
+
+            __m256 dudx = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(s.dtcdx[0]), _mm256_mul_ps(u, _mm256_set1_ps(s.dtcdx[2]))), invq);
+            __m256 dvdx = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(s.dtcdx[1]), _mm256_mul_ps(v, _mm256_set1_ps(s.dtcdx[2]))), invq);
+            __m256 dudy = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(s.dtcdy[0]), _mm256_mul_ps(u, _mm256_set1_ps(s.dtcdy[2]))), invq);
+            __m256 dvdy = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(s.dtcdy[1]), _mm256_mul_ps(v, _mm256_set1_ps(s.dtcdy[2]))), invq);
+            __m256 rx = _mm256_add_ps(_mm256_mul_ps(dudx, dudx), _mm256_mul_ps(dvdx, dvdx));
+            __m256 ry = _mm256_add_ps(_mm256_mul_ps(dudy, dudy), _mm256_mul_ps(dvdy, dvdy));
+            __m256i rho2 = _mm256_castps_si256(_mm256_max_ps(rx, ry));
+
+            const __m256i zero = _mm256_setzero_si256(), one = _mm256_set1_epi32(1);
+            __m256i level = _mm256_and_si256(_mm256_srli_epi32(rho2, 23), _mm256_set1_epi32(0xFF));
+            level = _mm256_srai_epi32(_mm256_sub_epi32(level, _mm256_set1_epi32(126)), 1);
+            level = _mm256_min_epi32(_mm256_max_epi32(level, zero), _mm256_set1_epi32(s.maxLevel));
+            __m256 scale = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_sub_epi32(_mm256_set1_epi32(127), level), 23));
+            __m256i x = _mm256_and_si256(floorToIntAVX2(_mm256_mul_ps(u, scale)), _mm256_srlv_epi32(_mm256_set1_epi32((int)s.widthMask), level));
+            __m256i y = _mm256_and_si256(floorToIntAVX2(_mm256_mul_ps(v, scale)), _mm256_srlv_epi32(_mm256_set1_epi32((int)s.heightMask), level));
+
+            __m256i shift = _mm256_max_epi32(_mm256_sub_epi32(_mm256_set1_epi32(s.baseShift), level), zero);
+            __m256i mask = _mm256_sub_epi32(_mm256_sllv_epi32(one, shift), one);
+            __m256i block = _mm256_add_epi32(_mm256_srlv_epi32(x, shift), _mm256_srlv_epi32(y, shift));
+            __m256i index = _mm256_or_si256(_mm256_sllv_epi32(block, _mm256_add_epi32(shift, shift)),
+                                            _mm256_or_si256(spreadBitsAVX2(_mm256_and_si256(x, mask)),
+                                                            _mm256_slli_epi32(spreadBitsAVX2(_mm256_and_si256(y, mask)), 1)));
+            __m256i offset = _mm256_i32gather_epi32((const int*)s.levelOffsets, level, 4);
+            return _mm256_i32gather_epi32((const int*)s.texels, _mm256_add_epi32(offset, index), 4);
+        }
+
+        // Also used at the AVX-512 level: spans are rarely long enough to fill wider
+        // vectors
+        template <typename State>
+        __attribute__((target("avx2")))
+        int spanAVX2(const Span& s, int x, int end, uint32_t* colorRow, float* depthRow, uint32_t& written) {
+            const __m256 lanes = _mm256_set_ps(7.0f, 6.0f, 5.0f, 4.0f, 3.0f, 2.0f, 1.0f, 0.0f);
+            const __m256 originX = _mm256_set1_ps(s.originX);
+            const __m256 z0 = _mm256_set1_ps(s.z), dzdx = _mm256_set1_ps(s.dzdx);
+            for (; x + 7 <= end; x += 8) {
+                __m256 t = _mm256_sub_ps(_mm256_add_ps(_mm256_set1_ps((float)x), lanes), originX);
+                __m256 z = _mm256_add_ps(z0, _mm256_mul_ps(dzdx, t));
+                __m256 depth = _mm256_loadu_ps(depthRow + x);
+                __m256 mask = State::depthTest(s) ? _mm256_cmp_ps(z, depth, _CMP_LT_OQ) : _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+                int bits = _mm256_movemask_ps(mask);
+                if (bits == 0) {
+                    continue;
+                }
+
+                __m256i color = _mm256_set1_epi32((int)s.color);
+                if (State::shading(s) == ShadingMode::Gouraud) {
+                    color = grayLevelAVX2(_mm256_add_ps(_mm256_set1_ps(s.a[0]), _mm256_mul_ps(_mm256_set1_ps(s.dadx[0]), t)));
+                } else if (State::shading(s) == ShadingMode::Phong) {
+                    __m256 nx = _mm256_add_ps(_mm256_set1_ps(s.a[0]), _mm256_mul_ps(_mm256_set1_ps(s.dadx[0]), t));
+                    __m256 ny = _mm256_add_ps(_mm256_set1_ps(s.a[1]), _mm256_mul_ps(_mm256_set1_ps(s.dadx[1]), t));
+                    __m256 nz = _mm256_add_ps(_mm256_set1_ps(s.a[2]), _mm256_mul_ps(_mm256_set1_ps(s.dadx[2]), t));
+                    __m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx, _mm256_set1_ps(s.light[0])), _mm256_mul_ps(ny, _mm256_set1_ps(s.light[1]))),
+                                             _mm256_mul_ps(nz, _mm256_set1_ps(s.light[2])));
+                    __m256 length = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx, nx), _mm256_mul_ps(ny, ny)), _mm256_mul_ps(nz, nz)));
+                    color = grayLevelAVX2(_mm256_div_ps(d, length));
+                }
+                if (State::textured(s)) {
+                    color = modulateAVX2(sampleTextureAVX2(s, t), color);
+                }
+
+                __m256i oldColor = _mm256_loadu_si256((const __m256i*)(colorRow + x));
+                if (State::blended(s)) {
+                    color = blendAVX2(color, oldColor);
+                } else {
+                    _mm256_storeu_ps(depthRow + x, _mm256_blendv_ps(depth, z, mask));
+                }
+                _mm256_storeu_si256((__m256i*)(colorRow + x), _mm256_blendv_epi8(oldColor, color, _mm256_castps_si256(mask)));
+                written += (uint32_t)__builtin_popcount(bits);
+            }
+            return x;
+        }
+
+#endif
+
+        // Whole spans at one SIMD level, the scalar kernel finishing what the vectors
+        // left over
+        using SpanKernel = uint32_t (*)(const Span& s, int x, int end, uint32_t* colorRow, float* depthRow);
+
+        template <typename State>
+        struct ScalarSpan {
+            static uint32_t draw(const Span& s, int x, int end, uint32_t* colorRow, float* depthRow) {
+                return spanScalar<State>(s, x, end, colorRow, depthRow);
+            }
+        };
+
+#ifdef ENGINE_X86_SIMD
+        template <typename State>
+        struct SSESpan {
+            static uint32_t draw(const Span& s, int x, int end, uint32_t* colorRow, float* depthRow) {
+                uint32_t written = 0;
+                x = spanSSE<State>(s, x, end, colorRow, depthRow, written);
+                return written + spanScalar<State>(s, x, end, colorRow, depthRow);
+            }
+        };
+
+        template <typename State>
+        struct AVX2Span {
+            static uint32_t draw(const Span& s, int x, int end, uint32_t* colorRow, float* depthRow) {
+                uint32_t written = 0;
+                x = spanAVX2<State>(s, x, end, colorRow, depthRow, written);
+                return written + spanScalar<State>(s, x, end, colorRow, depthRow);
+            }
+        };
+#endif
+
+        // Every combination of depth test, shading, texturing and blending, numbered
+        // by stateIndex
+        const size_t STATE_COUNT = 2 * 3 * 2 * 2;
+
+        constexpr size_t stateIndex(bool depthTest, ShadingMode shading, bool textured, BlendMode blend) {
+            return ((((size_t)depthTest * 3 + (size_t)shading) * 2 + (size_t)textured) * 2) + (size_t)blend;
+        }
+
+        template <size_t Index>
+        using StateAt = FixedState<(Index / 12) != 0, (ShadingMode)(Index / 4 % 3), (Index / 2 % 2) != 0, (BlendMode)(Index % 2)>;
+
+        template <template <typename> class Kernel, size_t... Index>
+        constexpr std::array<SpanKernel, STATE_COUNT> kernelRow(std::index_sequence<Index...>) {
+            return {{ &Kernel<StateAt<Index>>::draw... }};
+        }
+
+        // Specialized kernels by SIMD level and pipeline state, and the runtime state
+        // kernel of each level
+#ifdef ENGINE_X86_SIMD
+        const std::array<SpanKernel, STATE_COUNT> SPAN_KERNELS[] = {
+            kernelRow<ScalarSpan>(std::make_index_sequence<STATE_COUNT>()),
+            kernelRow<SSESpan>(std::make_index_sequence<STATE_COUNT>()),
+            kernelRow<AVX2Span>(std::make_index_sequence<STATE_COUNT>())
+        };
+        const SpanKernel RUNTIME_SPAN_KERNELS[] = {
+            &ScalarSpan<RuntimeState>::draw, &SSESpan<RuntimeState>::draw, &AVX2Span<RuntimeState>::draw
+        };
+#else
+        const std::array<SpanKernel, STATE_COUNT> SPAN_KERNELS[] = {
+            kernelRow<ScalarSpan>(std::make_index_sequence<STATE_COUNT>())
+        };
+        const SpanKernel RUNTIME_SPAN_KERNELS[] = { &ScalarSpan<RuntimeState>::draw };
+#endif
+
+        RasterDispatch& activeDispatch() {
+            static RasterDispatch dispatch = RasterDispatch::Specialized;
+            return dispatch;
+        }
+
+        // The kernel drawing every span of a triangle, picked once per triangle
+        SpanKernel selectSpanKernel(const Span& s) {
+            size_t level = 0;
+#ifdef ENGINE_X86_SIMD
+            SimdLevel simd = getSimdLevel();
+            level = simd >= SimdLevel::AVX2 ? 2 : simd == SimdLevel::SSE ? 1 : 0;
+#endif
+            if (activeDispatch() == RasterDispatch::Runtime) {
+                return RUNTIME_SPAN_KERNELS[level];
+            }
+            return SPAN_KERNELS[level][stateIndex(s.depthTest, s.shading, s.texels != nullptr, s.blend)];
+        }
+
+        // Slopes in x and y of the plane through three vertex values, for the snapped
+        // edge steps of rasterizeTriangle
+        void planeSlopes(float v0, float v1, float v2, int64_t stepX1, int64_t stepY1, int64_t stepX2, int64_t stepY2,
+                         int64_t area, float& dvdx, float& dvdy) {
+            double d1 = ((double)v1 - v0) / (double)area;
+            double d2 = ((double)v2 - v0) / (double)area;
+            dvdx = (float)(d1 * (double)stepX1 + d2 * (double)stepX2);
+            dvdy = (float)(d1 * (double)stepY1 + d2 * (double)stepY2);
+        }
+
+        // Liang-Barsky: cut the segment down to the rectangle [minX, maxX] x [minY, maxY].
+        // False when nothing of it is inside, or an endpoint is not finite.
+        bool clipLine(float& x0, float& y0, float& x1, float& y1, float minX, float minY, float maxX, float maxY) {
+            if (!std::isfinite(x0) || !std::isfinite(y0) || !std::isfinite(x1) || !std::isfinite(y1)) {
+                return false;
+            }
+            float dx = x1 - x0, dy = y1 - y0;
+            float p[4] = { -dx, dx, -dy, dy };
+            float q[4] = { x0 - minX, maxX - x0, y0 - minY, maxY - y0 };
+            float enter = 0.0f, leave = 1.0f;
+            for (int i = 0; i < 4; i++) {
+                if (p[i] == 0.0f) {
+                    if (q[i] < 0.0f) {
+                        return false;
+                    }
+                    continue;
+                }
+                float t = q[i] / p[i];
+                if (p[i] < 0.0f) {
+                    enter = std::max(enter, t);
+                } else {
+                    leave = std::min(leave, t);
+                }
+            }
+            if (enter > leave) {
+                return false;
+            }
+            float startX = x0, startY = y0;
+            if (leave < 1.0f) {
+                x1 = startX + dx * leave;
+                y1 = startY + dy * leave;
+            }
+            if (enter > 0.0f) {
+                x0 = startX + dx * enter;
+                y0 = startY + dy * enter;
+            }
+            return true;
+        }
+    }
+
+    FrameBuffer::FrameBuffer(int w, int h)
+        : width(w), height(h), color((size_t)w * h, 0), depth((size_t)w * h, 1.0f) {}
+
+    void FrameBuffer::clear(uint32_t clearColor, float clearDepth) {
+        std::fill(color.begin(), color.end(), clearColor);
+        std::fill(depth.begin(), depth.end(), clearDepth);
+    }
+
+    void rasterizeTriangle(FrameBuffer& fb, const triangle& tri, uint32_t color) {
+        RasterTriangle raster;
+        raster.points[0] = tri.points[0];
+        raster.points[1] = tri.points[1];
+        raster.points[2] = tri.points[2];
+        raster.color = color;
+        raster.shading = ShadingMode::Flat;
+        raster.blend = BlendMode::Opaque;
+        raster.texture = nullptr;
+        rasterizeTriangle(fb, raster, Rect{ 0, 0, fb.width, fb.height });
+    }
+
+    uint32_t rasterizeTriangle(FrameBuffer& fb, const RasterTriangle& tri, const Rect& clip, bool depthTest,
+                               const vec3d& lightDirection) {
+        const vec3d* v0 = &tri.points[0];
+        const vec3d* v1 = &tri.points[1];
+        const vec3d* v2 = &tri.points[2];
+        const vec3d* a0 = &tri.attributes[0];
+        const vec3d* a1 = &tri.attributes[1];
+        const vec3d* a2 = &tri.attributes[2];
+        const vec3d* t1 = &tri.texCoords[1];
+        const vec3d* t2 = &tri.texCoords[2];
+
+        if (!insideGuardBand(*v0) || !insideGuardBand(*v1) || !insideGuardBand(*v2)) {
+            return 0;
+        }
+
+        // Snap to the subpixel grid
+        int64_t x0 = llroundf(v0->x * SUBPIXEL_ONE), y0 = llroundf(v0->y * SUBPIXEL_ONE);
+        int64_t x1 = llroundf(v1->x * SUBPIXEL_ONE), y1 = llroundf(v1->y * SUBPIXEL_ONE);
+        int64_t x2 = llroundf(v2->x * SUBPIXEL_ONE), y2 = llroundf(v2->y * SUBPIXEL_ONE);
+
+        // Twice the signed area; rasterize both windings by flipping to a positive one
+        int64_t area = (x1 - x0) * (y2 - y0) - (y1 - y0) * (x2 - x0);
+        if (area == 0) {
+            return 0;
+        }
+        if (area < 0) {
+            std::swap(v1, v2);
+            std::swap(a1, a2);
+            std::swap(t1, t2);
+            std::swap(x1, x2);
+            std::swap(y1, y2);
+            area = -area;
+        }
+
+        // Bounding box of pixel centers covered, clamped to the clip rectangle
+        int minX = (int)std::max<int64_t>(clip.x0, ceilDiv(std::min({ x0, x1, x2 }) - SUBPIXEL_HALF, SUBPIXEL_ONE));
+        int maxX = (int)std::min<int64_t>(clip.x1 - 1, floorDiv(std::max({ x0, x1, x2 }) - SUBPIXEL_HALF, SUBPIXEL_ONE));
+        int minY = (int)std::max<int64_t>(clip.y0, ceilDiv(std::min({ y0, y1, y2 }) - SUBPIXEL_HALF, SUBPIXEL_ONE));
+        int maxY = (int)std::min<int64_t>(clip.y1 - 1, floorDiv(std::max({ y0, y1, y2 }) - SUBPIXEL_HALF, SUBPIXEL_ONE));
+        if (minX > maxX || minY > maxY) {
+            return 0;
+        }
+
+        // Edge function for a -> b: (b.x - a.x) * (p.y - a.y) - (b.y - a.y) * (p.x - a.x)
+        // w0 is opposite v0, w1 opposite v1 and w2 opposite v2
+        int64_t stepX[3] = { -(y2 - y1) * SUBPIXEL_ONE, -(y0 - y2) * SUBPIXEL_ONE, -(y1 - y0) * SUBPIXEL_ONE };
+        int64_t stepY[3] = { (x2 - x1) * SUBPIXEL_ONE, (x0 - x2) * SUBPIXEL_ONE, (x1 - x0) * SUBPIXEL_ONE };
+        int64_t bias[3] = { isTopLeft(x2 - x1, y2 - y1) ? 0 : -1,
+                            isTopLeft(x0 - x2, y0 - y2) ? 0 : -1,
+                            isTopLeft(x1 - x0, y1 - y0) ? 0 : -1 };
+
+        int64_t px = (int64_t)minX * SUBPIXEL_ONE + SUBPIXEL_HALF;
+        int64_t py = (int64_t)minY * SUBPIXEL_ONE + SUBPIXEL_HALF;
+        int64_t wRow[3] = { (x2 - x1) * (py - y1) - (y2 - y1) * (px - x1),
+                            (x0 - x2) * (py - y2) - (y0 - y2) * (px - x2),
+                            (x1 - x0) * (py - y0) - (y1 - y0) * (px - x0) };
+
+        // Depth is affine in screen space after the perspective divide, and so are the
+        // shading attributes as they are interpolated here. Planes are anchored at the
+        // snapped v0, shifted by half a pixel so integer x and y address pixel centers.
+        Span span;
+        span.originX = (float)x0 / (float)SUBPIXEL_ONE - 0.5f;
+        float originY = (float)y0 / (float)SUBPIXEL_ONE - 0.5f;
+        span.color = tri.color;
+        span.shading = tri.shading;
+        span.depthTest = depthTest;
+        span.blend = tri.blend;
+        span.light[0] = lightDirection.x;
+        span.light[1] = lightDirection.y;
+        span.light[2] = lightDirection.z;
+
+        float dzdy;
+        planeSlopes(v0->z, v1->z, v2->z, stepX[1], stepY[1], stepX[2], stepY[2], area, span.dzdx, dzdy);
+        int attributeCount = tri.shading == ShadingMode::Phong ? 3 : tri.shading == ShadingMode::Gouraud ? 1 : 0;
+        float base[3] = { a0->x, a0->y, a0->z };
+        float dady[3] = { 0.0f, 0.0f, 0.0f };
+        if (attributeCount > 0) {
+            planeSlopes(a0->x, a1->x, a2->x, stepX[1], stepY[1], stepX[2], stepY[2], area, span.dadx[0], dady[0]);
+        }
+        if (attributeCount == 3) {
+            planeSlopes(a0->y, a1->y, a2->y, stepX[1], stepY[1], stepX[2], stepY[2], area, span.dadx[1], dady[1]);
+            planeSlopes(a0->z, a1->z, a2->z, stepX[1], stepY[1], stepX[2], stepY[2], area, span.dadx[2], dady[2]);
+        }
+
+        // Texture coordinates are scaled to level 0 texels; the powers of two keep
+        // that exact
+        span.texels = nullptr;
+        float texBase[3] = { 0.0f, 0.0f, 0.0f };
+        if (tri.texture && !tri.texture->empty()) {
+            const Texture& texture = *tri.texture;
+            span.texels = texture.getTexels();
+            span.levelOffsets = texture.getLevelOffsets();
+            span.widthMask = (uint32_t)texture.getWidth() - 1;
+            span.heightMask = (uint32_t)texture.getHeight() - 1;
+            span.baseShift = texture.getLevelShifts()[0];
+            span.maxLevel = texture.getLevelCount() - 1;
+
+            const vec3d& t0 = tri.texCoords[0];
+            float scale[3] = { (float)texture.getWidth(), (float)texture.getHeight(), 1.0f };
+            float c0[3] = { t0.x, t0.y, t0.z }, c1[3] = { t1->x, t1->y, t1->z }, c2[3] = { t2->x, t2->y, t2->z };
+            for (int i = 0; i < 3; i++) {
+                texBase[i] = c0[i] * scale[i];
+                planeSlopes(texBase[i], c1[i] * scale[i], c2[i] * scale[i], stepX[1], stepY[1], stepX[2], stepY[2], area,
+                            span.dtcdx[i], span.dtcdy[i]);
+            }
+        }
+
+        SpanKernel drawSpan = selectSpanKernel(span);
+        uint32_t written = 0;
+        for (int y = minY; y <= maxY; y++) {
+            // Covered pixels of the row from each edge: w + bias >= 0 where w grows by
+            // stepX per pixel
+            int64_t first = minX, last = maxX;
+            for (int e = 0; e < 3; e++) {
+                int64_t w = wRow[e] + bias[e];
+                if (stepX[e] > 0) {
+                    first = std::max(first, minX + ceilDiv(-w, stepX[e]));
+                } else if (stepX[e] < 0) {
+                    last = std::min(last, minX + floorDiv(w, -stepX[e]));
+                } else if (w < 0) {
+                    last = first - 1;
+                }
+            }
+            wRow[0] += stepY[0]; wRow[1] += stepY[1]; wRow[2] += stepY[2];
+            if (first > last) {
+                continue;
+            }
+
+            float rowOffset = (float)y - originY;
+            span.z = v0->z + dzdy * rowOffset;
+            for (int i = 0; i < attributeCount; i++) {
+                span.a[i] = base[i] + dady[i] * rowOffset;
+            }
+            if (span.texels) {
+                for (int i = 0; i < 3; i++) {
+                    span.tc[i] = texBase[i] + span.dtcdy[i] * rowOffset;
+                }
+            }
+
+            uint32_t* colorRow = &fb.color[(size_t)y * fb.width];
+            float* depthRow = &fb.depth[(size_t)y * fb.width];
+            written += drawSpan(span, (int)first, (int)last, colorRow, depthRow);
+        }
+        return written;
+    }
+
+    void setRasterDispatch(RasterDispatch dispatch) {
+        activeDispatch() = dispatch;
+    }
+
+    RasterDispatch getRasterDispatch() {
+        return activeDispatch();
+    }
+
+    void rasterizeLine(FrameBuffer& fb, int x0, int y0, int x1, int y1, uint32_t color) {
+        bool inside = (unsigned)x0 < (unsigned)fb.width && (unsigned)x1 < (unsigned)fb.width &&
+                      (unsigned)y0 < (unsigned)fb.height && (unsigned)y1 < (unsigned)fb.height;
+        const int limit = (int)GUARD_BAND;
+        if (!inside && !(x0 > -limit && x0 < limit && y0 > -limit && y0 < limit &&
+                         x1 > -limit && x1 < limit && y1 > -limit && y1 < limit)) {
+            return;
+        }
+
+        // Bresenham along the major axis: step i moves one pixel along it and
+        // round(i * minor / major) pixels along the other one. Lines start at their
+        // lower major coordinate, so they cover the same pixels either way round.
+        bool xMajor = std::abs(x1 - x0) >= std::abs(y1 - y0);
+        if (xMajor ? x1 < x0 : y1 < y0) {
+            std::swap(x0, x1);
+            std::swap(y0, y1);
+        }
+        int64_t dx = x1 - x0, dy = y1 - y0;
+        int64_t major = xMajor ? dx : dy;
+        int64_t minor = std::abs(xMajor ? dy : dx);
+        int64_t majorStart = xMajor ? x0 : y0, minorStart = xMajor ? y0 : x0;
+        int64_t minorStep = (xMajor ? dy : dx) < 0 ? -1 : 1;
+        int64_t majorSize = xMajor ? fb.width : fb.height, minorSize = xMajor ? fb.height : fb.width;
+        auto minorOffset = [&](int64_t i) { return major == 0 ? 0 : (2 * i * minor + major) / (2 * major); };
+
+        // Lines crossing the buffer edge keep the steps inside it along the major
+        // axis, then, as the minor offset only grows, the ones whose offset stays
+        // inside it too
+        int64_t first = 0, last = major;
+        if (!inside) {
+            first = std::max<int64_t>(-majorStart, 0);
+            last = std::min(majorSize - 1 - majorStart, major);
+            int64_t lowestOffset = minorStep > 0 ? -minorStart : minorStart - (minorSize - 1);
+            int64_t highestOffset = minorStep > 0 ? minorSize - 1 - minorStart : minorStart;
+            if (first > last || minorOffset(first) > highestOffset || minorOffset(last) < lowestOffset) {
+                return;
+            }
+            int64_t low = first, high = last;
+            while (low < high) {
+                int64_t middle = low + (high - low) / 2;
+                if (minorOffset(middle) < lowestOffset) {
+                    low = middle + 1;
+                } else {
+                    high = middle;
+                }
+            }
+            first = low;
+            high = last;
+            while (low < high) {
+                int64_t middle = high - (high - low) / 2;
+                if (minorOffset(middle) > highestOffset) {
+                    high = middle - 1;
+                } else {
+                    low = middle;
+                }
+            }
+            last = high;
+        }
+
+        // Every remaining step stores one pixel, with no bounds checks
+        int64_t offset = first == 0 ? 0 : minorOffset(first);
+        int64_t majorPixel = majorStart + first, minorPixel = minorStart + minorStep * offset;
+        int64_t x = xMajor ? majorPixel : minorPixel, y = xMajor ? minorPixel : majorPixel;
+        uint32_t* pixels = fb.color.data();
+        int64_t pixel = y * fb.width + x;
+        if (minor == 0 && xMajor) {
+            std::fill(pixels + pixel, pixels + pixel + (last - first) + 1, color);
+            return;
+        }
+        int64_t majorStride = xMajor ? 1 : fb.width;
+        int64_t minorStride = xMajor ? minorStep * fb.width : minorStep;
+        int64_t error = 2 * first * minor + major - 2 * offset * major;
+        for (int64_t i = first; i <= last; i++) {
+            pixels[pixel] = color;
+
+            // Whether the minor coordinate moves is close to random, so it is not
+            // branched on
+            error += 2 * minor;
+            int64_t carry = -(int64_t)(error >= 2 * major);
+            error -= 2 * major & carry;
+            pixel += majorStride + (minorStride & carry);
+        }
+    }
+
+    void rasterizeSmoothLine(FrameBuffer& fb, float x0, float y0, float x1, float y1, uint32_t color) {
+        // Xiaolin Wu with pixel centers on integers. A pixel beyond the buffer can
+        // still take some coverage, so the line is clipped a pixel outside of it.
+        x0 -= 0.5f; y0 -= 0.5f; x1 -= 0.5f; y1 -= 0.5f;
+        if (!clipLine(x0, y0, x1, y1, -1.0f, -1.0f, (float)fb.width, (float)fb.height)) {
+            return;
+        }
+        bool steep = std::fabs(y1 - y0) > std::fabs(x1 - x0);
+        if (steep) {
+            std::swap(x0, y0);
+            std::swap(x1, y1);
+        }
+        if (x0 > x1) {
+            std::swap(x0, x1);
+            std::swap(y0, y1);
+        }
+
+        uint32_t rgb = color & 0x00FFFFFFu;
+        auto plot = [&](int major, int minor, float coverage) {
+            int x = steep ? minor : major, y = steep ? major : minor;
+            uint32_t alpha = (uint32_t)(coverage * 255.0f + 0.5f);
+            if (x >= 0 && x < fb.width && y >= 0 && y < fb.height && alpha > 0) {
+                uint32_t& pixel = fb.color[(size_t)y * fb.width + x];
+                pixel = blend((alpha << 24) | rgb, pixel) | 0xFF000000u;
+            }
+        };
+
+        // The end pixels are weighted by how much of them the line reaches into
+        float gradient = x1 > x0 ? (y1 - y0) / (x1 - x0) : 1.0f;
+        float startX = (float)floorToInt(x0 + 0.5f), endX = (float)floorToInt(x1 + 0.5f);
+        float startY = y0 + gradient * (startX - x0), endY = y1 + gradient * (endX - x1);
+        float startGap = 1.0f - (x0 + 0.5f - startX), endGap = x1 + 0.5f - endX;
+        float startFloor = (float)floorToInt(startY), endFloor = (float)floorToInt(endY);
+        plot((int)startX, (int)startFloor, (1.0f - (startY - startFloor)) * startGap);
+        plot((int)startX, (int)startFloor + 1, (startY - startFloor) * startGap);
+        plot((int)endX, (int)endFloor, (1.0f - (endY - endFloor)) * endGap);
+        plot((int)endX, (int)endFloor + 1, (endY - endFloor) * endGap);
+
+        // In between, two pixels per step share the coverage by where the line passes
+        float y = startY + gradient;
+        for (int major = (int)startX + 1; major < (int)endX; major++) {
+            float minorFloor = (float)floorToInt(y);
+            plot(major, (int)minorFloor, 1.0f - (y - minorFloor));
+            plot(major, (int)minorFloor + 1, y - minorFloor);
+            y += gradient;
+        }
+    }
+}
@@ -0,0 +1,90 @@
+#ifndef RASTERIZER_H
+#define RASTERIZER_H
+
+#include <vector>
+#include <cstdint>
+#include "../include/engine.h"
+
+namespace Engine3D {
+
+    // CPU-owned render target: packed ARGB8888 color plus a float z-buffer
+    struct FrameBuffer {
+        int width, height;
+        std::vector<uint32_t> color;
+        std::vector<float> depth;
+
+        FrameBuffer(int w, int h);
+
+        void clear(uint32_t clearColor, float clearDepth = 1.0f);
+    };
+
+    // Pixel rectangle [x0, x1) x [y0, y1) that rasterization is restricted to
+    struct Rect {
+        int x0, y0, x1, y1;
+    };
+
+    // How the pixels of a triangle get their color
+    enum class ShadingMode : uint8_t {
+        Flat,     // the triangle's color
+        Gouraud,  // light intensity per vertex in attributes[i].x, interpolated
+        Phong     // unit normal per vertex in attributes[i], interpolated and lit per pixel
+    };
+
+    // How the pixels of a triangle combine with what the framebuffer holds
+    enum class BlendMode : uint8_t {
+        Opaque,  // replaces color and depth
+        Alpha    // the color's alpha mixes it over the old color; depth is tested, not written
+    };
+
+    // Screen space triangle (x, y in pixels, z in [0, 1]) ready to be rasterized
+    struct RasterTriangle {
+        vec3d points[3];
+        uint32_t color;
+        ShadingMode shading;
+        BlendMode blend;
+        vec3d attributes[3];  // only read by the smooth modes
+
+        // Texture or nullptr. Texture coordinates are divided by the vertex's clip
+        // space w and hold (u / w, v / w, 1 / w), which are affine in screen space.
+        const Texture* texture;
+        vec3d texCoords[3];
+    };
+
+    // Fill a triangle with its shading. Smooth modes write the interpolated light
+    // intensity in [0, 1] as a gray level, the way the flat colors are shaded;
+    // lightDirection is the unit direction towards the light that Phong shading uses.
+    // Textured triangles multiply that color by the nearest texel of the mip level
+    // matching the pixel's texture footprint, with perspective correct coordinates.
+    // Pixels are depth tested against and written to the z-buffer, blended ones only
+    // tested; without depthTest every covered pixel is drawn. Coverage, depth and
+    // color of a pixel do not depend on the clip rectangle or on the SIMD level, so
+    // tiles rasterized separately match a full-screen pass exactly. Returns the
+    // number of pixels written.
+    uint32_t rasterizeTriangle(FrameBuffer& fb, const RasterTriangle& tri, const Rect& clip, bool depthTest = true,
+                               const vec3d& lightDirection = vec3d(0.0f, 0.0f, -1.0f));
+    void rasterizeTriangle(FrameBuffer& fb, const triangle& tri, uint32_t color);
+
+    // How rasterizeTriangle runs its per-pixel loop: kernels compiled for each
+    // combination of depth test, shading, texturing and blending, one of which is
+    // picked per triangle, or one kernel testing that state at every pixel. Both
+    // write the same pixels; the runtime kernels are kept for benchmarks.
+    enum class RasterDispatch {
+        Specialized,
+        Runtime
+    };
+
+    void setRasterDispatch(RasterDispatch dispatch);
+    RasterDispatch getRasterDispatch();
+
+    // Draw a line between pixels, without depth testing, used for wireframe
+    // overlays. The steps outside the buffer are cut off before the loop, so long
+    // lines crossing it cost only the pixels they write. Like triangles, lines
+    // reaching beyond the guard band of 2^20 pixels are skipped.
+    void rasterizeLine(FrameBuffer& fb, int x0, int y0, int x1, int y1, uint32_t color);
+
+    // Anti-aliased line (Xiaolin Wu) between points in pixels, blending color over
+    // the two pixels nearest to it along the way by their share of the line
+    void rasterizeSmoothLine(FrameBuffer& fb, float x0, float y0, float x1, float y1, uint32_t color);
+}
+
+#endif
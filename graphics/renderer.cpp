@@ -1,8 +1,21 @@
 #include "renderer.h"
+#include "../include/bvh.h"
+#include "../include/transform.h"
+#include "../include/vecmath.h"
+#include "clipper.h"
+#include "overlay.h"
+#include "../include/radixsort.h"
+#include "../include/texture.h"
 #include <iostream>
 #include <algorithm>
 #include <cmath>
-#include <SDL2_gfxPrimitives.h>
+#include <cstring>
+#include <sstream>
+#include <iomanip>
+
+#ifdef ENGINE_WITH_SDL
+#include <SDL.h>
+#endif
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
@@ -10,11 +23,65 @@
 
 namespace Engine3D {
 
-    Renderer::Renderer(int width, int height) {
+    // Triangles handled by one geometry task
+    static const size_t GEOMETRY_CHUNK = 4096;
+
+    // Vertices handled by one transform task
+    static const size_t VERTEX_CHUNK = 16384;
+
+    // Flat shaded triangles whose face normals are rotated together, few enough
+    // that their queued triangles are still in cache when the colors are filled in
+    static const size_t FLAT_NORMAL_BATCH = 64;
+
+    // Occluders are instances covering at least this share of the screen, taken
+    // nearest first until their triangles would exceed the budget
+    static const float OCCLUDER_MIN_SCREEN_SHARE = 1.0f / 256.0f;
+    static const size_t OCCLUDER_TRIANGLE_BUDGET = 65536;
+
+    // Tile signature of unknown content, never produced by the hash
+    static const uint64_t UNKNOWN_SIGNATURE = 0;
+
+    const RGB RGB::WHITE(255, 255, 255);
+    const RGB RGB::RED(255, 0, 0);
+    const RGB RGB::GREEN(0, 255, 0);
+    const RGB RGB::BLUE(0, 0, 255);
+    const RGB RGB::BLACK(0, 0, 0);
+
+    Renderer::Renderer(int width, int height, bool headless)
+        : frameBuffer(width, height), hiZ(width, height) {
         screenWidth = width;
         screenHeight = height;
+        this->headless = headless;
         window = nullptr;
         renderer = nullptr;
+        texture = nullptr;
+
+        pool = std::make_unique<ThreadPool>();
+        tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+        tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+        batchCount = 0;
+        painterMode = false;
+        frameBatches = 0;
+        frameTriangles = 0;
+        overlayEnabled = false;
+        incremental = false;
+        clearPending = false;
+        tileState.assign((size_t)tilesX * tilesY, 0);
+        tileSignatures.assign((size_t)tilesX * tilesY, UNKNOWN_SIGNATURE);
+        shadingMode = ShadingMode::Flat;
+        lightDirection = vec3d(0.0f, 0.0f, -1.0f);
+        lodThreshold = 1.0f;
+        lineAntialiasing = false;
+        occlusionCulling = true;
+        occlusionActive = false;
+        arena = &arenas[0];
+        pipelined = false;
+        rasterArena = nullptr;
+        rasterInFlight = false;
+        rasterQueued = false;
+        rasterStop = false;
+        rasterCount = 0;
+        rasterClear = false;
     }
 
     Renderer::~Renderer() {
@@ -22,6 +89,12 @@ namespace Engine3D {
     }
 
     bool Renderer::init() {
+        // Nothing to set up without a window, everything renders into frameBuffer
+        if (headless) {
+            return true;
+        }
+
+#ifdef ENGINE_WITH_SDL
         // Initialize SDL
         if (SDL_Init(SDL_INIT_VIDEO) < 0) {
             std::cout << "SDL could not initialize! SDL_Error: " << SDL_GetError() << std::endl;
@@ -47,10 +120,36 @@ namespace Engine3D {
             return false;
         }
 
+        // Streaming texture the framebuffer is uploaded to once per frame
+        texture = SDL_CreateTexture(renderer,
+                                    SDL_PIXELFORMAT_ARGB8888,
+                                    SDL_TEXTUREACCESS_STREAMING,
+                                    screenWidth,
+                                    screenHeight);
+        if (texture == nullptr) {
+            std::cout << "Texture could not be created! SDL_Error: " << SDL_GetError() << std::endl;
+            return false;
+        }
+
         return true;
+#else
+        std::cout << "Built without SDL, only headless rendering is available" << std::endl;
+        return false;
+#endif
     }
 
     void Renderer::cleanup() {
+        // The raster thread may still be writing the framebuffer
+        stopRasterThread();
+        if (headless) {
+            return;
+        }
+
+#ifdef ENGINE_WITH_SDL
+        if (texture) {
+            SDL_DestroyTexture(texture);
+            texture = nullptr;
+        }
         if (renderer) {
             SDL_DestroyRenderer(renderer);
             renderer = nullptr;
@@ -60,146 +159,1393 @@ namespace Engine3D {
             window = nullptr;
         }
         SDL_Quit();
+#endif
+    }
+
+    void Renderer::setThreadCount(unsigned count) {
+        flush();
+        pool = std::make_unique<ThreadPool>(count);
     }
 
     void Renderer::clear() {
-        // Clear the screen with black
-        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-        SDL_RenderClear(renderer);
-        
+        ProfileScope scope(profiler, ProfileStage::Clear);
+
+        // Anything still queued would land on the new frame
+        batchCount = 0;
+
+        // Incremental mode clears each tile once flush knows its content changed,
+        // pipelined frames clear tiles as they are rasterized since the previous
+        // frame may still be drawing into them
+        if (incremental || pipelined) {
+            clearPending = true;
+            return;
+        }
+
+        // Clear the color buffer with black and reset depth to the far plane
+        frameBuffer.clear(RGB::BLACK.toARGB());
+    }
+
+    void Renderer::setLightDirection(const vec3d& direction) {
+        // Queued Phong triangles are lit while rasterizing, with the old direction
+        flush();
+        lightDirection = direction.normalize();
+    }
+
+    void Renderer::setIncrementalRendering(bool enabled) {
+        // Resolve pending clears in the current mode
+        flush();
+        incremental = enabled;
+        std::fill(tileSignatures.begin(), tileSignatures.end(), UNKNOWN_SIGNATURE);
+    }
+
+    void Renderer::markTilesChanged(int x0, int y0, int x1, int y1) {
+        // Pixels written outside flush: redraw these tiles next frame and upload them
+        int tx0 = std::max(x0, 0) / TILE_SIZE, tx1 = std::min((std::min(x1, screenWidth) + TILE_SIZE - 1) / TILE_SIZE, tilesX);
+        int ty0 = std::max(y0, 0) / TILE_SIZE, ty1 = std::min((std::min(y1, screenHeight) + TILE_SIZE - 1) / TILE_SIZE, tilesY);
+        for (int ty = ty0; ty < ty1; ty++) {
+            for (int tx = tx0; tx < tx1; tx++) {
+                tileSignatures[(size_t)ty * tilesX + tx] = UNKNOWN_SIGNATURE;
+                tileState[(size_t)ty * tilesX + tx] |= TILE_CHANGED;
+            }
+        }
+    }
+
+    Rect Renderer::takeChangedRect() {
+        if (!incremental) {
+            std::fill(tileState.begin(), tileState.end(), 0);
+            return Rect{ 0, 0, screenWidth, screenHeight };
+        }
+
+        // Bounds of the tiles written since the last present
+        int tx0 = tilesX, ty0 = tilesY, tx1 = 0, ty1 = 0;
+        for (int ty = 0; ty < tilesY; ty++) {
+            for (int tx = 0; tx < tilesX; tx++) {
+                uint8_t& state = tileState[(size_t)ty * tilesX + tx];
+                if (state & TILE_CHANGED) {
+                    tx0 = std::min(tx0, tx);
+                    ty0 = std::min(ty0, ty);
+                    tx1 = std::max(tx1, tx + 1);
+                    ty1 = std::max(ty1, ty + 1);
+                    state &= ~TILE_CHANGED;
+                }
+            }
+        }
+        if (tx0 >= tx1) {
+            return Rect{ 0, 0, 0, 0 };
+        }
+        return Rect{ tx0 * TILE_SIZE, ty0 * TILE_SIZE,
+                     std::min(tx1 * TILE_SIZE, screenWidth), std::min(ty1 * TILE_SIZE, screenHeight) };
+    }
+
+    FrameStats Renderer::takeGeometryStats() {
+        FrameStats stats;
+        stats.batches = frameBatches;
+        stats.submitted = counters.submitted.exchange(0);
+        stats.lodReduced = counters.lodReduced.exchange(0);
+        stats.frustumCulled = counters.frustumCulled.exchange(0);
+        stats.occluded = counters.occluded.exchange(0);
+        stats.instancesOccluded = counters.instancesOccluded.exchange(0);
+        stats.backfaceCulled = counters.backfaceCulled.exchange(0);
+        stats.clipped = counters.clipped.exchange(0);
+        stats.triangles = frameTriangles;
+        frameBatches = 0;
+        frameTriangles = 0;
+        return stats;
     }
 
     void Renderer::present() {
-        // Present the rendered frame
-        SDL_RenderPresent(renderer);
+        if (!pipelined) {
+            // Rasterize everything queued this frame
+            flush();
+            completeFrame(takeGeometryStats(), *arena);
+            return;
+        }
+
+        // Show the previous frame, then hand this one to the raster thread and let
+        // geometry of the next frame continue in the other arena
+        finish();
+        frameBatches += batchCount;
+        for (size_t b = 0; b < batchCount; b++) {
+            frameTriangles += batches[b].triangles.size();
+        }
+        rasterStats = takeGeometryStats();
+        std::swap(batches, rasterBatches);
+        size_t count = batchCount;
+        bool clearFrame = clearPending;
+        batchCount = 0;
+        clearPending = false;
+        rasterArena = arena;
+        arena = arena == &arenas[0] ? &arenas[1] : &arenas[0];
+
+        if (!rasterThread.joinable()) {
+            rasterStop = false;
+            rasterThread = std::thread(&Renderer::rasterLoop, this);
+        }
+        {
+            std::lock_guard<std::mutex> lock(rasterMutex);
+            rasterCount = count;
+            rasterClear = clearFrame;
+            rasterQueued = true;
+        }
+        rasterInFlight = true;
+        rasterWake.notify_one();
+    }
+
+    void Renderer::finish() {
+        if (!rasterInFlight) {
+            return;
+        }
+        {
+            std::unique_lock<std::mutex> lock(rasterMutex);
+            rasterDone.wait(lock, [this]() { return !rasterQueued; });
+        }
+        rasterInFlight = false;
+        completeFrame(rasterStats, *rasterArena);
+    }
+
+    void Renderer::rasterLoop() {
+        std::unique_lock<std::mutex> lock(rasterMutex);
+        while (true) {
+            rasterWake.wait(lock, [this]() { return rasterQueued || rasterStop; });
+            if (!rasterQueued) {
+                return;
+            }
+            size_t count = rasterCount;
+            bool clearFrame = rasterClear;
+            lock.unlock();
+            rasterize(rasterBatches.data(), count, *rasterArena, clearFrame);
+            lock.lock();
+            rasterQueued = false;
+            rasterDone.notify_all();
+        }
+    }
+
+    void Renderer::stopRasterThread() {
+        if (!rasterThread.joinable()) {
+            return;
+        }
+        {
+            // A queued frame is rasterized before the thread sees the request
+            std::lock_guard<std::mutex> lock(rasterMutex);
+            rasterStop = true;
+        }
+        rasterWake.notify_one();
+        rasterThread.join();
+    }
+
+    void Renderer::setPipelinedFrames(bool enabled) {
+        flush();
+        pipelined = enabled;
+        if (!enabled) {
+            stopRasterThread();
+        }
+    }
+
+    void Renderer::completeFrame(const FrameStats& geometry, FrameArena& frameArena) {
+        // Nothing refers to the transient buffers any more
+        lastFrameStats = geometry;
+        lastFrameStats.pixelsWritten = counters.pixelsWritten.exchange(0);
+        lastFrameStats.pixelsCovered = profiler.isEnabled() ? countCoveredPixels() : 0;
+        lastFrameStats.tilesDrawn = counters.tilesDrawn.exchange(0);
+        lastFrameStats.tilesReused = counters.tilesReused.exchange(0);
+        lastFrameStats.arena = frameArena.getStats();
+        frameArena.reset();
+
+        if (profiler.isCapturing()) {
+            profiler.addCounterSample("triangles", (double)lastFrameStats.triangles);
+            profiler.addCounterSample("culled", (double)(lastFrameStats.frustumCulled + lastFrameStats.backfaceCulled));
+            profiler.addCounterSample("occluded", (double)lastFrameStats.occluded);
+            profiler.addCounterSample("pixels", (double)lastFrameStats.pixelsWritten);
+            profiler.addCounterSample("overdraw", lastFrameStats.overdraw());
+        }
+
+        {
+            ProfileScope scope(profiler, ProfileStage::Present);
+            if (overlayEnabled) {
+                drawOverlay();
+            }
+            lastFrameStats.changed = takeChangedRect();
+
+#ifdef ENGINE_WITH_SDL
+            // Upload the changed part of the framebuffer and present it; an unchanged
+            // frame leaves the window as it is
+            const Rect& changed = lastFrameStats.changed;
+            if (!headless && changed.x0 < changed.x1 && changed.y0 < changed.y1) {
+                SDL_Rect rect = { changed.x0, changed.y0, changed.x1 - changed.x0, changed.y1 - changed.y0 };
+                const uint32_t* pixels = frameBuffer.color.data() + (size_t)changed.y0 * screenWidth + changed.x0;
+                SDL_UpdateTexture(texture, &rect, pixels, screenWidth * (int)sizeof(uint32_t));
+                SDL_RenderCopy(renderer, texture, nullptr, nullptr);
+                SDL_RenderPresent(renderer);
+            }
+#endif
+        }
+        profiler.endFrame();
+    }
+
+    size_t Renderer::countCoveredPixels() {
+        // Pixels still at the cleared far depth were never drawn; lines do not write
+        // depth and are not counted
+        std::atomic<size_t> covered(0);
+        pool->parallelFor((size_t)tilesY, [&](size_t band) {
+            size_t begin = band * TILE_SIZE * (size_t)screenWidth;
+            size_t end = std::min(begin + TILE_SIZE * (size_t)screenWidth, frameBuffer.depth.size());
+            size_t count = 0;
+            for (size_t i = begin; i < end; i++) {
+                count += frameBuffer.depth[i] < 1.0f;
+            }
+            covered.fetch_add(count, std::memory_order_relaxed);
+        });
+        return covered.load();
+    }
+
+    void Renderer::setOverlayEnabled(bool enabled) {
+        overlayEnabled = enabled;
+        if (enabled) {
+            profiler.setEnabled(true);
+        }
+    }
+
+    void Renderer::drawOverlay() {
+        const int scale = 2;
+        const int lineHeight = overlayLineHeight(scale);
+        const uint32_t textColor = 0xFFFFFFFFu;
+
+        std::vector<std::string> lines;
+        std::ostringstream line;
+        auto endLine = [&]() {
+            lines.push_back(line.str());
+            line.str("");
+        };
+
+        const FrameStats& stats = lastFrameStats;
+        FrameTimeSummary summary = profiler.getFrameTimeSummary();
+        line << std::fixed << std::setprecision(1);
+        line << "frame " << profiler.getLastFrameTime() << " ms  p50 " << summary.p50 << "  p99 " << summary.p99;
+        endLine();
+        line << "tris " << stats.triangles << " / " << stats.submitted;
+        endLine();
+        line << "culled " << stats.frustumCulled << "  back " << stats.backfaceCulled << "  clip " << stats.clipped;
+        endLine();
+        line << "occluded " << stats.occluded << "  objects " << stats.instancesOccluded;
+        endLine();
+        line << "pixels " << stats.pixelsWritten << "  overdraw " << std::setprecision(2) << stats.overdraw();
+        endLine();
+        line << std::setprecision(2);
+        for (size_t s = 0; s < (size_t)ProfileStage::Count; s++) {
+            line << profileStageName((ProfileStage)s) << " " << profiler.getStageTime((ProfileStage)s) << " ms";
+            endLine();
+        }
+
+        // Text panel with a frame-time graph below it: one column per frame, with a
+        // mark at 16.7 ms and bars turning red above it
+        std::vector<float> times = profiler.getFrameTimes();
+        const int graphHeight = 50;
+        const float pixelsPerMillisecond = 1.5f;
+        int panelWidth = (int)Profiler::FRAME_HISTORY;
+        for (const std::string& text : lines) {
+            panelWidth = std::max(panelWidth, (int)text.size() * 4 * scale);
+        }
+        int textHeight = (int)lines.size() * lineHeight;
+        int margin = 4;
+        shadeOverlayRect(frameBuffer, 0, 0, panelWidth + 2 * margin, textHeight + graphHeight + 3 * margin, 0xFF000000u);
+        markTilesChanged(0, 0, panelWidth + 2 * margin, textHeight + graphHeight + 3 * margin);
+
+        for (size_t i = 0; i < lines.size(); i++) {
+            drawOverlayText(frameBuffer, margin, margin + (int)i * lineHeight, lines[i], textColor, scale);
+        }
+
+        int graphBottom = textHeight + 2 * margin + graphHeight;
+        for (size_t i = 0; i < times.size(); i++) {
+            int height = std::min(graphHeight, (int)(times[i] * pixelsPerMillisecond + 0.5f));
+            uint32_t color = times[i] > 1000.0f / 60.0f ? 0xFFFF4040u : 0xFF40FF40u;
+            int x = margin + (int)i;
+            fillOverlayRect(frameBuffer, x, graphBottom - height, x + 1, graphBottom, color);
+        }
+        int budget = graphBottom - (int)(1000.0f / 60.0f * pixelsPerMillisecond + 0.5f);
+        fillOverlayRect(frameBuffer, margin, budget, margin + (int)Profiler::FRAME_HISTORY, budget + 1, 0xFFFFFF00u);
     }
 
     void Renderer::drawMesh(const mesh& m, const matrix4x4& projection) {
-        
-        for (const auto& tri : m.triangles) {
-            triangle triTranslated;
-            triTranslated.points[0] = tri.points[0];
-            triTranslated.points[1] = tri.points[1];
-            triTranslated.points[2] = tri.points[2];
-
-            // move cube away from camera
-            triTranslated.points[0].z += 3.0f;
-            triTranslated.points[1].z += 3.0f;
-            triTranslated.points[2].z += 3.0f;
-            
-            triangle proj;
-            proj.points[0] = projection.multiplyVector(triTranslated.points[0]);
-            proj.points[1] = projection.multiplyVector(triTranslated.points[1]);
-            proj.points[2] = projection.multiplyVector(triTranslated.points[2]);
-
-            vec3d pos(1.0f, 1.0f, 0.0f);
-            proj = proj + pos;
-
-            vec3d scale((float)screenWidth / 2.0f, (float)screenHeight / 2.0f, 1.0f);
-            proj = proj * scale;
-
-            drawTriangle(proj, RGB(255, 255, 255));
-        }
-    }
-
-    void Renderer::drawMesh(const mesh& m, const matrix4x4& projection, const matrix4x4& rotX, const matrix4x4& rotZ, vec3d cameraPos) {
-        std::vector<TriangleDepth> trianglesToRaster;
-        
-        for (const auto& tri : m.triangles) {
-            // Apply rotation first
-            triangle triRotated = rotateTriangle(tri, rotX, rotZ);
-
-            triangle triTranslated;
-            triTranslated.points[0] = triRotated.points[0];
-            triTranslated.points[1] = triRotated.points[1];
-            triTranslated.points[2] = triRotated.points[2];
-
-            // move cube away from camera
-            triTranslated.points[0].z += 3.0f;
-            triTranslated.points[1].z += 3.0f;
-            triTranslated.points[2].z += 3.0f;
-
-            triTranslated.calculateNormal();
-
-            // Skip back-facing triangles
-            if (!triTranslated.isFacingCamera(cameraPos)) {
+        // Every vertex is placed in the world, projected and scaled into view once;
+        // nothing is clipped, lines too far off screen are skipped
+        size_t vertexCount = m.vertices.size();
+        meshVertices.resize(vertexCount, ShadingMode::Flat);
+        vec3d scale((float)screenWidth / 2.0f, (float)screenHeight / 2.0f, 1.0f);
+        for (size_t i = 0; i < vertexCount; i++) {
+            vec3d projected = projection.multiplyVector(m.vertices.get(i) + m.position);
+            meshVertices.screen.set(i, (projected + vec3d(1.0f, 1.0f, 0.0f)) * scale);
+            meshVertices.clipCodes[i] = 0;
+        }
+        drawEdges(m, meshVertices, RGB::WHITE.toARGB());
+    }
+
+    namespace {
+        // Transforms normals the way model transforms points: the inverse transpose of
+        // its 3x3 part. Its rows are the cofactors of the model rows; the 1/det scale
+        // is dropped since normals are normalized afterwards, only its sign is kept.
+        matrix4x4 createNormalMatrix(const matrix4x4& model) {
+            vec3d r0(model.m[0][0], model.m[0][1], model.m[0][2]);
+            vec3d r1(model.m[1][0], model.m[1][1], model.m[1][2]);
+            vec3d r2(model.m[2][0], model.m[2][1], model.m[2][2]);
+            vec3d c0 = r1.cross(r2);
+            vec3d c1 = r2.cross(r0);
+            vec3d c2 = r0.cross(r1);
+            float sign = r0.dot(c0) < 0.0f ? -1.0f : 1.0f;
+
+            matrix4x4 normal;
+            normal.m[0][0] = c0.x * sign; normal.m[0][1] = c0.y * sign; normal.m[0][2] = c0.z * sign;
+            normal.m[1][0] = c1.x * sign; normal.m[1][1] = c1.y * sign; normal.m[1][2] = c1.z * sign;
+            normal.m[2][0] = c2.x * sign; normal.m[2][1] = c2.y * sign; normal.m[2][2] = c2.z * sign;
+            return normal;
+        }
+
+        // Screen rectangle, widened by a pixel against rounding, and nearest depth of a
+        // box's corners. False when a corner is in front of the near plane, where the
+        // projection of the box no longer bounds what is inside it.
+        bool projectBounds(const AABB& box, const matrix4x4& m, float halfWidth, float halfHeight,
+                           OcclusionBounds& bounds) {
+            bounds = { INFINITY, INFINITY, -INFINITY, -INFINITY, INFINITY };
+            for (int i = 0; i < 8; i++) {
+                vec3d p(i & 1 ? box.max.x : box.min.x, i & 2 ? box.max.y : box.min.y, i & 4 ? box.max.z : box.min.z);
+                float x = p.x * m.m[0][0] + p.y * m.m[1][0] + p.z * m.m[2][0] + m.m[3][0];
+                float y = p.x * m.m[0][1] + p.y * m.m[1][1] + p.z * m.m[2][1] + m.m[3][1];
+                float z = p.x * m.m[0][2] + p.y * m.m[1][2] + p.z * m.m[2][2] + m.m[3][2];
+                float w = p.x * m.m[0][3] + p.y * m.m[1][3] + p.z * m.m[2][3] + m.m[3][3];
+                if (!(z >= 0.0f && w > 0.0f)) {
+                    return false;
+                }
+                float sx = (x / w + 1.0f) * halfWidth, sy = (y / w + 1.0f) * halfHeight;
+                bounds.minX = std::min(bounds.minX, sx - 1.0f);
+                bounds.maxX = std::max(bounds.maxX, sx + 1.0f);
+                bounds.minY = std::min(bounds.minY, sy - 1.0f);
+                bounds.maxY = std::max(bounds.maxY, sy + 1.0f);
+                bounds.minZ = std::min(bounds.minZ, z / w);
+            }
+            return true;
+        }
+
+        // (u, v) of a vertex with clip space w as (u / w, v / w, 1 / w), the form the
+        // rasterizer interpolates
+        vec3d perspectiveTexCoord(const vec3d& texCoord, float w) {
+            float q = 1.0f / w;
+            return vec3d(texCoord.x * q, texCoord.y * q, q);
+        }
+    }
+
+    Renderer::DrawParams::DrawParams(const matrix4x4& model, const matrix4x4& viewProjection)
+        : modelViewProjection(model * viewProjection), normalMatrix(createNormalMatrix(model)),
+          shading(ShadingMode::Flat), texture(nullptr) {}
+
+    void Renderer::VertexCache::resize(size_t count, ShadingMode shading) {
+        clip.resize(count);
+        clipW.resize(count);
+        clipCodes.resize(count);
+        screen.resize(count);
+        if (shading != ShadingMode::Flat) {
+            normals.resize(count);
+            intensity.resize(count);
+        }
+    }
+
+    ShadingMode Renderer::shadingFor(const mesh& m) const {
+        bool hasNormals = !m.vertices.empty() && m.normals.size() == m.vertices.size();
+        return hasNormals ? shadingMode : ShadingMode::Flat;
+    }
+
+    const Texture* Renderer::textureFor(const mesh& m) {
+        bool hasTexCoords = !m.vertices.empty() && m.texCoords.size() == m.vertices.size();
+        return hasTexCoords && m.texture && !m.texture->empty() ? m.texture.get() : nullptr;
+    }
+
+    void Renderer::transformVertices(const mesh& m, const matrix4x4& modelViewProjection,
+                                     VertexCache& cache, size_t begin, size_t count) {
+        float* cx = cache.clip.x.data() + begin;
+        float* cy = cache.clip.y.data() + begin;
+        float* cz = cache.clip.z.data() + begin;
+        float* cw = cache.clipW.data() + begin;
+        uint8_t* codes = cache.clipCodes.data() + begin;
+        float* sx = cache.screen.x.data() + begin;
+        float* sy = cache.screen.y.data() + begin;
+        float* sz = cache.screen.z.data() + begin;
+
+        // One concatenated transform straight into clip space, keeping w for the clipper
+        transformPoints(modelViewProjection, m.vertices.x.data() + begin, m.vertices.y.data() + begin,
+                        m.vertices.z.data() + begin, cx, cy, cz, cw, count);
+
+        // Divide by w and scale into view. Vertices outside the near or far plane
+        // get a screen position too, but triangles using them are clipped first.
+        float halfWidth = (float)screenWidth / 2.0f;
+        float halfHeight = (float)screenHeight / 2.0f;
+        for (size_t i = 0; i < count; i++) {
+            codes[i] = computeOutcode(cx[i], cy[i], cz[i], cw[i]);
+
+            float x = cx[i], y = cy[i], z = cz[i];
+            if (cw[i] != 0.0f) {
+                x /= cw[i]; y /= cw[i]; z /= cw[i];
+            }
+            sx[i] = (x + 1.0f) * halfWidth;
+            sy[i] = (y + 1.0f) * halfHeight;
+            sz[i] = z;
+        }
+    }
+
+    void Renderer::shadeVertices(const mesh& m, const DrawParams& params, VertexCache& cache, size_t begin, size_t count) {
+        float* nx = cache.normals.x.data() + begin;
+        float* ny = cache.normals.y.data() + begin;
+        float* nz = cache.normals.z.data() + begin;
+        float* intensity = cache.intensity.data() + begin;
+
+        // The normal matrix has no translation and a zero w column, so the batch
+        // transform rotates the normals; its w output lands in intensity, which is
+        // overwritten below
+        transformPoints(params.normalMatrix, m.normals.x.data() + begin, m.normals.y.data() + begin,
+                        m.normals.z.data() + begin, nx, ny, nz, intensity, count);
+
+        for (size_t i = 0; i < count; i++) {
+            vec3d normal = vec3d(nx[i], ny[i], nz[i]).normalize();
+            if (params.shading == ShadingMode::Phong) {
+                nx[i] = normal.x;
+                ny[i] = normal.y;
+                nz[i] = normal.z;
+            } else {
+                intensity[i] = std::max(0.0f, normal.dot(lightDirection));
+            }
+        }
+    }
+
+    void Renderer::shadeTriangles(const mesh& m, const VertexCache& cache, const uint32_t* triangleOrder,
+                                  size_t begin, size_t end, const DrawParams& params, TriangleBatch& batch) {
+        size_t frustumCulled = 0, backfaceCulled = 0, occluded = 0, clipped = 0;
+
+        // Flat shaded triangles are queued with the index of their face normal in
+        // place of the color. The normals are rotated into the world in batches,
+        // and the colors filled in while the batch's triangles are still in cache;
+        // clipping may have split a triangle into several with the same index.
+        bool flat = params.shading == ShadingMode::Flat;
+        bool precomputedNormals = m.faceNormals.size() == m.triangleCount();
+        mat4 normalMatrix(params.normalMatrix);
+        vec4 light(lightDirection, 0.0f);
+        vec4 faceNormals[FLAT_NORMAL_BATCH];
+        size_t normalCount = 0;
+        size_t firstPending = batch.triangles.size();
+        auto shadePending = [&]() {
+            transformNormals(normalMatrix, faceNormals, normalCount);
+            for (size_t i = firstPending; i < batch.triangles.size(); i++) {
+                RasterTriangle& raster = batch.triangles[i];
+                raster.color = calculateShadedColor(std::max(0.0f, dot3(faceNormals[raster.color], light))).toARGB();
+            }
+            normalCount = 0;
+            firstPending = batch.triangles.size();
+        };
+
+        for (size_t k = begin; k < end; k++) {
+            if (normalCount == FLAT_NORMAL_BATCH) {
+                shadePending();
+            }
+            size_t t = triangleOrder ? triangleOrder[k] : k;
+            const uint32_t* index = &m.indices[t * 3];
+
+            // Skip triangles with every vertex outside the same clip plane
+            uint8_t code0 = cache.clipCodes[index[0]];
+            uint8_t code1 = cache.clipCodes[index[1]];
+            uint8_t code2 = cache.clipCodes[index[2]];
+            if (code0 & code1 & code2) {
+                frustumCulled++;
+                continue;
+            }
+
+            // Skip back-facing triangles. The determinant of the clip space (x, y, w)
+            // rows is the view space triple product scaled by the projection, so its
+            // sign gives the winding as seen from the camera even across w = 0.
+            float x0 = cache.clip.x[index[0]], y0 = cache.clip.y[index[0]], w0 = cache.clipW[index[0]];
+            float x1 = cache.clip.x[index[1]], y1 = cache.clip.y[index[1]], w1 = cache.clipW[index[1]];
+            float x2 = cache.clip.x[index[2]], y2 = cache.clip.y[index[2]], w2 = cache.clipW[index[2]];
+            float winding = x0 * (y1 * w2 - w1 * y2) - y0 * (x1 * w2 - w1 * x2) + w0 * (x1 * y2 - y1 * x2);
+            if (!(winding < 0.0f)) {
+                backfaceCulled++;
+                continue;
+            }
+
+            // Skip triangles behind drawScene's occluders
+            if (occlusionActive && !(code0 | code1 | code2)) {
+                vec3d p0 = cache.screen.get(index[0]), p1 = cache.screen.get(index[1]), p2 = cache.screen.get(index[2]);
+                OcclusionBounds bounds = { std::min({ p0.x, p1.x, p2.x }), std::min({ p0.y, p1.y, p2.y }),
+                                           std::max({ p0.x, p1.x, p2.x }), std::max({ p0.y, p1.y, p2.y }),
+                                           std::min({ p0.z, p1.z, p2.z }) };
+                if (hiZ.isOccluded(bounds)) {
+                    occluded++;
+                    continue;
+                }
+            }
+
+            RasterTriangle raster;
+            raster.shading = params.shading;
+            raster.blend = BlendMode::Opaque;
+            if (flat) {
+                // Face normal in object space, precomputed or from the positions
+                vec4& normal = faceNormals[normalCount];
+                if (precomputedNormals) {
+                    normal = vec4(m.faceNormals.get(t), 0.0f);
+                } else {
+                    triangle triObject = m.getTriangle(t);
+                    normal = vec4((triObject.points[1] - triObject.points[0]).cross(triObject.points[2] - triObject.points[0]), 0.0f);
+                }
+                raster.color = (uint32_t)normalCount++;
+            } else {
+                // Lit per vertex by shadeVertices, or per pixel by the rasterizer
+                raster.color = RGB::WHITE.toARGB();
+                for (int i = 0; i < 3; i++) {
+                    raster.attributes[i] = params.shading == ShadingMode::Gouraud
+                        ? vec3d(cache.intensity[index[i]], 0.0f, 0.0f)
+                        : cache.normals.get(index[i]);
+                }
+            }
+
+            // Texture coordinates as they are, until the triangle's w are final
+            raster.texture = params.texture;
+            if (params.texture) {
+                for (int i = 0; i < 3; i++) {
+                    raster.texCoords[i] = vec3d(m.texCoords.u[index[i]], m.texCoords.v[index[i]], 0.0f);
+                }
+            }
+
+            // Triangles crossing a clip plane are cut down to their visible part
+            if (code0 | code1 | code2) {
+                clipped++;
+                emitClippedTriangle(batch, cache, index, code0 | code1 | code2, raster);
                 continue;
             }
 
-            // Calculate lighting
-            vec3d lightDirection(0.0f, 0.0f, -1.0f); // Light coming from front
-            float lightIntensity = calculateLighting(triTranslated.normal, lightDirection);
+            // Queue the projected triangle for the tile rasterizers
+            raster.points[0] = cache.screen.get(index[0]);
+            raster.points[1] = cache.screen.get(index[1]);
+            raster.points[2] = cache.screen.get(index[2]);
+            if (params.texture) {
+                for (int i = 0; i < 3; i++) {
+                    raster.texCoords[i] = perspectiveTexCoord(raster.texCoords[i], cache.clipW[index[i]]);
+                }
+            }
+            batch.triangles.push_back(raster);
+        }
+
+        if (flat) {
+            shadePending();
+        }
+
+        counters.frustumCulled.fetch_add(frustumCulled, std::memory_order_relaxed);
+        counters.backfaceCulled.fetch_add(backfaceCulled, std::memory_order_relaxed);
+        counters.occluded.fetch_add(occluded, std::memory_order_relaxed);
+        counters.clipped.fetch_add(clipped, std::memory_order_relaxed);
+    }
+
+    int Renderer::clipTriangle(const VertexCache& cache, const uint32_t* index, uint8_t codes,
+                               const RasterTriangle& shaded, ShadedScreenVertex* clipped) const {
+        // Shading attributes and texture coordinates are clipped along with the
+        // positions; triangles without them carry zeros
+        bool smooth = shaded.shading != ShadingMode::Flat;
+        bool textured = shaded.texture != nullptr;
+        ShadedScreenVertex polygon[MAX_CLIP_VERTICES];
+        int count = 3;
+
+        if (codes & CLIP_DEPTH) {
+            // Cut away everything in front of the near plane (and behind the camera)
+            // or beyond the far plane before dividing by w
+            ShadedClipVertex in[3], out[MAX_CLIP_VERTICES];
+            for (int i = 0; i < 3; i++) {
+                uint32_t v = index[i];
+                in[i].position = ClipVertex{ cache.clip.x[v], cache.clip.y[v], cache.clip.z[v], cache.clipW[v] };
+                in[i].attribute = smooth ? shaded.attributes[i] : vec3d();
+                in[i].texCoord = textured ? shaded.texCoords[i] : vec3d();
+            }
+            count = clipPolygonDepth(in, 3, out);
+
+            float halfWidth = (float)screenWidth / 2.0f;
+            float halfHeight = (float)screenHeight / 2.0f;
+            for (int i = 0; i < count; i++) {
+                const ClipVertex& p = out[i].position;
+                polygon[i].position = vec3d((p.x / p.w + 1.0f) * halfWidth,
+                                            (p.y / p.w + 1.0f) * halfHeight,
+                                            p.z / p.w);
+                polygon[i].attribute = out[i].attribute;
+                polygon[i].texCoord = perspectiveTexCoord(out[i].texCoord, p.w);
+            }
+        } else {
+            for (int i = 0; i < 3; i++) {
+                polygon[i].position = cache.screen.get(index[i]);
+                polygon[i].attribute = smooth ? shaded.attributes[i] : vec3d();
+                polygon[i].texCoord = textured ? perspectiveTexCoord(shaded.texCoords[i], cache.clipW[index[i]]) : vec3d();
+            }
+        }
 
-            // Project triangle from 3D to 2D
-            triangle proj;
-            proj.points[0] = projection.multiplyVector(triTranslated.points[0]);
-            proj.points[1] = projection.multiplyVector(triTranslated.points[1]);
-            proj.points[2] = projection.multiplyVector(triTranslated.points[2]);
+        // Trim to the screen so the rasterizer never sees off-screen extents
+        return clipPolygonScreen(polygon, count, clipped, (float)screenWidth, (float)screenHeight);
+    }
 
-            vec3d pos(1.0f, 1.0f, 0.0f);
-            proj = proj + pos;
+    void Renderer::emitClippedTriangle(TriangleBatch& batch, const VertexCache& cache, const uint32_t* index,
+                                       uint8_t codes, const RasterTriangle& shaded) {
+        ShadedScreenVertex clipped[MAX_CLIP_VERTICES];
+        int count = clipTriangle(cache, index, codes, shaded, clipped);
 
-            vec3d scale((float)screenWidth / 2.0f, (float)screenHeight / 2.0f, 1.0f);
-            proj = proj * scale;
+        // The clipped polygon is convex, fan it back into triangles
+        RasterTriangle raster = shaded;
+        for (int i = 1; i + 1 < count; i++) {
+            const ShadedScreenVertex* fan[3] = { &clipped[0], &clipped[i], &clipped[i + 1] };
+            for (int k = 0; k < 3; k++) {
+                raster.points[k] = fan[k]->position;
+                raster.attributes[k] = fan[k]->attribute;
+                raster.texCoords[k] = fan[k]->texCoord;
+            }
+            batch.triangles.push_back(raster);
+        }
+    }
 
-            // Calculate average depth for sorting
-            float avgDepth = (proj.points[0].z + proj.points[1].z + proj.points[2].z) / 3.0f;
-            
-            // Use lighting to determine color
-            RGB shadedColor = calculateShadedColor(lightIntensity);
-            
-            // Store triangle for sorting
-            // trianglesToRaster.push_back(TriangleDepth(proj, avgDepth, shadedColor));
+    void Renderer::drawMesh(const mesh& m, const Camera& camera) {
+        matrix4x4 model;
+        createTranslationMatrix(model, m.position.x, m.position.y, m.position.z);
+        drawMesh(m, model, camera);
+    }
 
-            // drawTriangle(proj, RGB(255, 255, 255));
-            fillTriangle(proj, shadedColor);
+    void Renderer::drawMesh(const mesh& m, const matrix4x4& model, const Camera& camera) {
+        DrawParams params(model, camera.getViewProjectionMatrix());
+        if (m.lods.empty()) {
+            drawMeshInstance(m, params);
+            return;
         }
 
-        // Sort triangles from back to front (higher Z first)
-        // sort(trianglesToRaster.begin(), trianglesToRaster.end(), 
-        //      [](const TriangleDepth& a, const TriangleDepth& b) {
-        //          return a.depth > b.depth;
-        //      });
-        
-        // Now render sorted triangles
-        // for (const auto& triDepth : trianglesToRaster) {
-        //     fillTriangle(triDepth.tri, triDepth.color);
-        // }
+        bool hasBVH = m.bvh && !m.bvh->empty() && m.bvh->triangleCount() == m.triangleCount();
+        AABB bounds = hasBVH ? m.bvh->bounds() : computeBounds(m);
+        drawMeshInstance(selectLOD(m, bounds, model, params.modelViewProjection, lodPixelScale(camera)), params);
+    }
+
+    float Renderer::lodPixelScale(const Camera& camera) const {
+        // Pixels covered by one world unit at view depth 1
+        return 0.5f * (float)screenHeight * camera.getProjectionMatrix().m[1][1];
+    }
+
+    const mesh& Renderer::selectLOD(const mesh& m, const AABB& bounds, const matrix4x4& model,
+                                    const matrix4x4& modelViewProjection, float pixelScale) {
+        if (m.lods.empty() || !(lodThreshold > 0.0f)) {
+            return m;
+        }
+
+        // The bounding sphere's nearest view depth is clip space w at its center
+        // minus its radius, scaled into the world by the model's largest axis
+        float scale = 0.0f;
+        for (int i = 0; i < 3; i++) {
+            scale = std::max(scale, vec3d(model.m[i][0], model.m[i][1], model.m[i][2]).length());
+        }
+        vec3d center = bounds.center();
+        float radius = 0.5f * (bounds.max - bounds.min).length() * scale;
+        float w = center.x * modelViewProjection.m[0][3] + center.y * modelViewProjection.m[1][3] +
+                  center.z * modelViewProjection.m[2][3] + modelViewProjection.m[3][3];
+        float depth = w - radius;
+        if (!(depth > 0.0f)) {
+            return m;
+        }
+
+        // Levels are ordered by growing error; take the last one still under the threshold
+        float pixelsPerUnit = pixelScale * scale / depth;
+        const mesh* chosen = &m;
+        for (const MeshLOD& lod : m.lods) {
+            if (!(lod.error * pixelsPerUnit < lodThreshold)) {
+                break;
+            }
+            chosen = lod.geometry.get();
+        }
+        counters.lodReduced.fetch_add(m.triangleCount() - chosen->triangleCount(), std::memory_order_relaxed);
+        return *chosen;
+    }
+
+    void Renderer::drawMeshInstance(const mesh& m, const DrawParams& params) {
+        // With an up to date BVH only triangles in leaves touching the view frustum
+        // are processed, and a mesh entirely outside it costs one box test
+        size_t triangleCount = m.triangleCount();
+        const uint32_t* triangleOrder = nullptr;
+        counters.submitted.fetch_add(triangleCount, std::memory_order_relaxed);
+        if (m.bvh && !m.bvh->empty() && m.bvh->triangleCount() == triangleCount) {
+            ProfileScope scope(profiler, ProfileStage::Cull);
+            Frustum frustum = Frustum::fromMatrix(params.modelViewProjection);
+
+            visibleRanges.clear();
+            m.bvh->cullFrustum(frustum, visibleRanges);
+
+            const uint32_t* order = m.bvh->getTriangleOrder().data();
+            size_t visibleCount = 0;
+            for (const BVH::Range& range : visibleRanges) {
+                visibleCount += range.count;
+            }
+            counters.frustumCulled.fetch_add(triangleCount - visibleCount, std::memory_order_relaxed);
+            if (visibleCount == 0) {
+                return;
+            }
+
+            uint32_t* visibleTriangles = arena->allocate<uint32_t>(visibleCount);
+            triangleCount = 0;
+            for (const BVH::Range& range : visibleRanges) {
+                std::copy(order + range.begin, order + range.begin + range.count, visibleTriangles + triangleCount);
+                triangleCount += range.count;
+            }
+            triangleOrder = visibleTriangles;
+        }
+
+        // Every unique vertex is transformed (and lit, for smooth shading) exactly
+        // once per draw; the results act as a post-transform cache that all
+        // triangles sharing a vertex read from
+        DrawParams shadedParams = params;
+        shadedParams.shading = shadingFor(m);
+        shadedParams.texture = textureFor(m);
+        size_t vertexCount = m.vertices.size();
+        meshVertices.resize(vertexCount, shadedParams.shading);
+        pool->parallelFor((vertexCount + VERTEX_CHUNK - 1) / VERTEX_CHUNK, [&](size_t chunk) {
+            ProfileScope scope(profiler, ProfileStage::Transform);
+            size_t begin = chunk * VERTEX_CHUNK;
+            size_t count = std::min(VERTEX_CHUNK, vertexCount - begin);
+            transformVertices(m, params.modelViewProjection, meshVertices, begin, count);
+            if (shadedParams.shading != ShadingMode::Flat) {
+                shadeVertices(m, shadedParams, meshVertices, begin, count);
+            }
+        });
+
+        // Triangles run in parallel over fixed-size chunks of the mesh; each chunk
+        // fills and bins its own batch, keeping submission order for the tiles
+        size_t chunkCount = (triangleCount + GEOMETRY_CHUNK - 1) / GEOMETRY_CHUNK;
+        if (batches.size() < batchCount + chunkCount) {
+            batches.resize(batchCount + chunkCount);
+        }
+
+        pool->parallelFor(chunkCount, [&](size_t chunk) {
+            TriangleBatch& batch = batches[batchCount + chunk];
+
+            size_t begin = chunk * GEOMETRY_CHUNK;
+            size_t end = std::min(begin + GEOMETRY_CHUNK, triangleCount);
+            batch.triangles.init(*arena, end - begin);
+            {
+                ProfileScope scope(profiler, ProfileStage::Shade);
+                shadeTriangles(m, meshVertices, triangleOrder, begin, end, shadedParams, batch);
+            }
+            ProfileScope scope(profiler, ProfileStage::Bin);
+            binBatch(batch, *arena);
+        });
+        batchCount += chunkCount;
+    }
+
+    void Renderer::drawScene(const Scene& scene, const Camera& camera) {
+        const std::vector<Scene::MeshEntry>& meshes = scene.getMeshes();
+        matrix4x4 viewProjection = camera.getViewProjectionMatrix();
+        float pixelScale = lodPixelScale(camera);
+        bool cullOccluded = occlusionCulling && !painterMode;
+
+        // Every instance is frustum culled and given its level of detail first, so
+        // the occluders can be picked from what is left
+        sceneDraws.clear();
+        for (const Scene::Node& node : scene.getNodes()) {
+            if (node.meshIndex == Scene::NONE) {
+                continue;
+            }
+
+            // Skip instances whose bounds are entirely outside the view frustum
+            const Scene::MeshEntry& entry = meshes[node.meshIndex];
+            matrix4x4 modelViewProjection = node.world * viewProjection;
+            bool outside;
+            {
+                ProfileScope scope(profiler, ProfileStage::Cull);
+                outside = Frustum::fromMatrix(modelViewProjection).classify(entry.bounds) == Frustum::Outside;
+            }
+            if (outside) {
+                counters.submitted.fetch_add(entry.source->triangleCount(), std::memory_order_relaxed);
+                counters.frustumCulled.fetch_add(entry.source->triangleCount(), std::memory_order_relaxed);
+                continue;
+            }
+
+            // Distant instances of meshes with a LOD chain draw a simplified level
+            SceneDraw draw;
+            draw.drawn = &selectLOD(*entry.source, entry.bounds, node.world, modelViewProjection, pixelScale);
+            draw.model = &node.world;
+            draw.hasScreenBounds = cullOccluded && projectBounds(entry.bounds, modelViewProjection,
+                                                                 (float)screenWidth / 2.0f, (float)screenHeight / 2.0f,
+                                                                 draw.screen);
+            sceneDraws.push_back(draw);
+        }
+        if (cullOccluded) {
+            buildOcclusion(viewProjection);
+        }
+
+        // Small meshes are queued and drawn one instance per task; a mesh big enough
+        // to fill several geometry chunks goes through drawMesh on its own, after the
+        // instances queued before it
+        pendingInstances.clear();
+        for (const SceneDraw& draw : sceneDraws) {
+            const mesh& drawn = *draw.drawn;
+            bool occluded;
+            {
+                ProfileScope scope(profiler, ProfileStage::Cull);
+                occluded = occlusionActive && draw.hasScreenBounds && hiZ.isOccluded(draw.screen);
+            }
+            if (occluded) {
+                counters.submitted.fetch_add(drawn.triangleCount(), std::memory_order_relaxed);
+                counters.occluded.fetch_add(drawn.triangleCount(), std::memory_order_relaxed);
+                counters.instancesOccluded.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+
+            if (drawn.triangleCount() > GEOMETRY_CHUNK) {
+                drawInstances(pendingInstances, viewProjection);
+                pendingInstances.clear();
+                drawMeshInstance(drawn, DrawParams(*draw.model, viewProjection));
+            } else {
+                pendingInstances.push_back(Instance{ &drawn, draw.model });
+            }
+        }
+        drawInstances(pendingInstances, viewProjection);
+        occlusionActive = false;
+    }
+
+    void Renderer::buildOcclusion(const matrix4x4& viewProjection) {
+        ProfileScope scope(profiler, ProfileStage::Cull);
+        hiZ.clear();
+
+        // Instances reaching past the near plane surround the camera and come first;
+        // the others need to cover enough of the screen to be worth rasterizing
+        float minArea = (float)screenWidth * (float)screenHeight * OCCLUDER_MIN_SCREEN_SHARE;
+        occluderOrder.clear();
+        for (uint32_t i = 0; i < (uint32_t)sceneDraws.size(); i++) {
+            const OcclusionBounds& screen = sceneDraws[i].screen;
+            float width = std::min(screen.maxX, (float)screenWidth) - std::max(screen.minX, 0.0f);
+            float height = std::min(screen.maxY, (float)screenHeight) - std::max(screen.minY, 0.0f);
+            if (!sceneDraws[i].hasScreenBounds || (width > 0.0f && height > 0.0f && width * height >= minArea)) {
+                occluderOrder.push_back(i);
+            }
+        }
+        auto nearest = [&](uint32_t i) { return sceneDraws[i].hasScreenBounds ? sceneDraws[i].screen.minZ : -1.0f; };
+        std::stable_sort(occluderOrder.begin(), occluderOrder.end(),
+                         [&](uint32_t a, uint32_t b) { return nearest(a) < nearest(b); });
+
+        size_t budget = OCCLUDER_TRIANGLE_BUDGET;
+        for (uint32_t i : occluderOrder) {
+            const mesh& m = *sceneDraws[i].drawn;
+            if (m.triangleCount() <= budget) {
+                budget -= m.triangleCount();
+                addOccluder(m, *sceneDraws[i].model * viewProjection);
+            }
+        }
+        hiZ.build();
+        occlusionActive = !hiZ.empty();
+    }
+
+    void Renderer::addOccluder(const mesh& m, const matrix4x4& modelViewProjection) {
+        // Transformed, culled and clipped exactly like the triangles drawn later, so
+        // the occluders cover the very pixels those will write
+        size_t vertexCount = m.vertices.size();
+        meshVertices.resize(vertexCount, ShadingMode::Flat);
+        pool->parallelFor((vertexCount + VERTEX_CHUNK - 1) / VERTEX_CHUNK, [&](size_t chunk) {
+            size_t begin = chunk * VERTEX_CHUNK;
+            transformVertices(m, modelViewProjection, meshVertices, begin, std::min(VERTEX_CHUNK, vertexCount - begin));
+        });
+
+        RasterTriangle flat;
+        flat.shading = ShadingMode::Flat;
+        flat.blend = BlendMode::Opaque;
+        flat.texture = nullptr;
+        for (size_t t = 0; t < m.triangleCount(); t++) {
+            const uint32_t* index = &m.indices[t * 3];
+            uint8_t code0 = meshVertices.clipCodes[index[0]];
+            uint8_t code1 = meshVertices.clipCodes[index[1]];
+            uint8_t code2 = meshVertices.clipCodes[index[2]];
+            if (code0 & code1 & code2) {
+                continue;
+            }
+
+            float x0 = meshVertices.clip.x[index[0]], y0 = meshVertices.clip.y[index[0]], w0 = meshVertices.clipW[index[0]];
+            float x1 = meshVertices.clip.x[index[1]], y1 = meshVertices.clip.y[index[1]], w1 = meshVertices.clipW[index[1]];
+            float x2 = meshVertices.clip.x[index[2]], y2 = meshVertices.clip.y[index[2]], w2 = meshVertices.clipW[index[2]];
+            float winding = x0 * (y1 * w2 - w1 * y2) - y0 * (x1 * w2 - w1 * x2) + w0 * (x1 * y2 - y1 * x2);
+            if (!(winding < 0.0f)) {
+                continue;
+            }
+
+            if (!(code0 | code1 | code2)) {
+                hiZ.addOccluder(meshVertices.screen.get(index[0]), meshVertices.screen.get(index[1]),
+                                meshVertices.screen.get(index[2]));
+                continue;
+            }
+            ShadedScreenVertex clipped[MAX_CLIP_VERTICES];
+            int count = clipTriangle(meshVertices, index, code0 | code1 | code2, flat, clipped);
+            for (int i = 1; i + 1 < count; i++) {
+                hiZ.addOccluder(clipped[0].position, clipped[i].position, clipped[i + 1].position);
+            }
+        }
+    }
+
+    void Renderer::drawInstances(const std::vector<Instance>& instances, const matrix4x4& viewProjection) {
+        if (instances.empty()) {
+            return;
+        }
+
+        if (batches.size() < batchCount + instances.size()) {
+            batches.resize(batchCount + instances.size());
+        }
+
+        // Each task transforms one instance into its thread's vertex cache and shades
+        // it into its own batch, so instance order is kept for the tiles
+        pool->parallelFor(instances.size(), [&](size_t i) {
+            static thread_local VertexCache cache;
+            const mesh& m = *instances[i].source;
+            DrawParams params(*instances[i].model, viewProjection);
+            params.shading = shadingFor(m);
+            params.texture = textureFor(m);
+            counters.submitted.fetch_add(m.triangleCount(), std::memory_order_relaxed);
+            {
+                ProfileScope scope(profiler, ProfileStage::Transform);
+                cache.resize(m.vertices.size(), params.shading);
+                transformVertices(m, params.modelViewProjection, cache, 0, m.vertices.size());
+                if (params.shading != ShadingMode::Flat) {
+                    shadeVertices(m, params, cache, 0, m.vertices.size());
+                }
+            }
+
+            TriangleBatch& batch = batches[batchCount + i];
+            batch.triangles.init(*arena, m.triangleCount());
+            {
+                ProfileScope scope(profiler, ProfileStage::Shade);
+                shadeTriangles(m, cache, nullptr, 0, m.triangleCount(), params, batch);
+            }
+            ProfileScope scope(profiler, ProfileStage::Bin);
+            binBatch(batch, *arena);
+        });
+        batchCount += instances.size();
+    }
+
+    void Renderer::binBatch(TriangleBatch& batch, FrameArena& frameArena) {
+        size_t tileCount = (size_t)tilesX * tilesY;
+        batch.binStart = frameArena.allocate<uint32_t>(tileCount + 1);
+        std::fill(batch.binStart, batch.binStart + tileCount + 1, 0u);
+
+        // Conservative tile range covered by each triangle's bounding box, or an
+        // empty range when it is entirely off screen
+        auto tileRange = [&](const RasterTriangle& tri, int& tx0, int& ty0, int& tx1, int& ty1) {
+            float minX = std::min({ tri.points[0].x, tri.points[1].x, tri.points[2].x });
+            float maxX = std::max({ tri.points[0].x, tri.points[1].x, tri.points[2].x });
+            float minY = std::min({ tri.points[0].y, tri.points[1].y, tri.points[2].y });
+            float maxY = std::max({ tri.points[0].y, tri.points[1].y, tri.points[2].y });
+
+            // Also rejects NaN coordinates
+            if (!(maxX >= 0.0f && minX < (float)screenWidth && maxY >= 0.0f && minY < (float)screenHeight)) {
+                tx0 = tx1 = ty0 = ty1 = 0;
+                return;
+            }
+
+            tx0 = (int)std::max(minX, 0.0f) / TILE_SIZE;
+            ty0 = (int)std::max(minY, 0.0f) / TILE_SIZE;
+            tx1 = (int)std::min(maxX, (float)(screenWidth - 1)) / TILE_SIZE + 1;
+            ty1 = (int)std::min(maxY, (float)(screenHeight - 1)) / TILE_SIZE + 1;
+        };
+
+        // Counting sort of (tile, triangle) pairs by tile
+        int tx0, ty0, tx1, ty1;
+        for (const RasterTriangle& tri : batch.triangles) {
+            tileRange(tri, tx0, ty0, tx1, ty1);
+            for (int ty = ty0; ty < ty1; ty++) {
+                for (int tx = tx0; tx < tx1; tx++) {
+                    batch.binStart[(size_t)ty * tilesX + tx + 1]++;
+                }
+            }
+        }
+        for (size_t t = 0; t < tileCount; t++) {
+            batch.binStart[t + 1] += batch.binStart[t];
+        }
+
+        batch.binItems = frameArena.allocate<uint32_t>(batch.binStart[tileCount]);
+        uint32_t* cursor = frameArena.allocate<uint32_t>(tileCount);
+        std::copy(batch.binStart, batch.binStart + tileCount, cursor);
+        for (uint32_t i = 0; i < (uint32_t)batch.triangles.size(); i++) {
+            tileRange(batch.triangles[i], tx0, ty0, tx1, ty1);
+            for (int ty = ty0; ty < ty1; ty++) {
+                for (int tx = tx0; tx < tx1; tx++) {
+                    batch.binItems[cursor[(size_t)ty * tilesX + tx]++] = i;
+                }
+            }
+        }
+    }
+
+    void Renderer::setPainterMode(bool enabled) {
+        // Queued batches are drawn in the mode they were submitted in
+        flush();
+        painterMode = enabled;
+    }
+
+    size_t Renderer::sortBatches(const TriangleBatch* source, size_t count, FrameArena& frameArena) {
+        ProfileScope scope(profiler, ProfileStage::Sort);
+
+        // Global position of every queued triangle
+        size_t* firstTriangle = frameArena.allocate<size_t>(count + 1);
+        firstTriangle[0] = 0;
+        for (size_t b = 0; b < count; b++) {
+            firstTriangle[b + 1] = firstTriangle[b] + source[b].triangles.size();
+        }
+        size_t total = firstTriangle[count];
+
+        // Keys order by descending depth sum: for non-negative floats the bit patterns
+        // sort like the values, and inverting them puts the farthest first
+        uint64_t* items = frameArena.allocate<uint64_t>(total);
+        uint64_t* scratch = frameArena.allocate<uint64_t>(total);
+        const RasterTriangle** triangles = frameArena.allocate<const RasterTriangle*>(total);
+        pool->parallelFor(count, [&](size_t b) {
+            const TriangleBatch& batch = source[b];
+            for (size_t i = 0; i < batch.triangles.size(); i++) {
+                const RasterTriangle& tri = batch.triangles[i];
+                float depth = tri.points[0].z + tri.points[1].z + tri.points[2].z;
+                uint32_t bits;
+                depth = depth > 0.0f ? depth : 0.0f;
+                std::memcpy(&bits, &depth, sizeof(bits));
+
+                size_t index = firstTriangle[b] + i;
+                items[index] = makeSortItem(~bits, (uint32_t)index);
+                triangles[index] = &tri;
+            }
+        });
+
+        // Ties keep submission order, so the result is the same for any thread count
+        const uint64_t* sorted = radixSortByKey(items, scratch, total, pool.get());
+
+        // Refill fixed-size batches in sorted order; replaying them in sequence keeps
+        // that order within every tile
+        size_t chunkCount = (total + GEOMETRY_CHUNK - 1) / GEOMETRY_CHUNK;
+        if (sortedBatches.size() < chunkCount) {
+            sortedBatches.resize(chunkCount);
+        }
+        pool->parallelFor(chunkCount, [&](size_t chunk) {
+            TriangleBatch& batch = sortedBatches[chunk];
+            size_t begin = chunk * GEOMETRY_CHUNK;
+            size_t end = std::min(begin + GEOMETRY_CHUNK, total);
+            batch.triangles.init(frameArena, end - begin);
+            for (size_t k = begin; k < end; k++) {
+                batch.triangles.push_back(*triangles[sortItemPayload(sorted[k])]);
+            }
+            binBatch(batch, frameArena);
+        });
+        return chunkCount;
+    }
+
+    void Renderer::flush() {
+        // A pipelined frame still being rasterized lands first
+        finish();
+
+        // Tiles with a pending clear have to be resolved even without triangles
+        if (batchCount == 0 && !clearPending) {
+            return;
+        }
+        rasterize(batches.data(), batchCount, *arena, clearPending);
+        clearPending = false;
+
+        frameBatches += batchCount;
+        for (size_t b = 0; b < batchCount; b++) {
+            frameTriangles += batches[b].triangles.size();
+        }
+        batchCount = 0;
+    }
+
+    void Renderer::rasterize(const TriangleBatch* replay, size_t replayCount, FrameArena& frameArena, bool clear) {
+        // Incremental mode resolves the clear per tile, other modes only defer it
+        // while pipelined, and clear every tile as it is drawn
+        if (clear && incremental) {
+            for (uint8_t& state : tileState) {
+                state |= TILE_CLEAR_PENDING;
+            }
+        }
+        bool clearTiles = clear && !incremental;
+
+        // Painter's mode replays the depth-sorted copy without depth testing
+        if (painterMode && replayCount > 0) {
+            replayCount = sortBatches(replay, replayCount, frameArena);
+            replay = sortedBatches.data();
+        }
+        bool depthTest = !painterMode;
+
+        // Every tile owns a disjoint rectangle of the color and depth buffers, so the
+        // tiles need no locking. Batches are replayed in submission order.
+        pool->parallelFor((size_t)tilesX * tilesY, [&](size_t tile) {
+            ProfileScope scope(profiler, ProfileStage::Rasterize);
+            int tx = (int)(tile % tilesX);
+            int ty = (int)(tile / tilesX);
+            Rect rect;
+            rect.x0 = tx * TILE_SIZE;
+            rect.y0 = ty * TILE_SIZE;
+            rect.x1 = std::min(rect.x0 + TILE_SIZE, screenWidth);
+            rect.y1 = std::min(rect.y0 + TILE_SIZE, screenHeight);
+            auto clearTile = [&]() {
+                for (int y = rect.y0; y < rect.y1; y++) {
+                    size_t row = (size_t)y * screenWidth;
+                    std::fill(frameBuffer.color.data() + row + rect.x0, frameBuffer.color.data() + row + rect.x1, RGB::BLACK.toARGB());
+                    std::fill(frameBuffer.depth.data() + row + rect.x0, frameBuffer.depth.data() + row + rect.x1, 1.0f);
+                }
+            };
+
+            if (clearTiles) {
+                clearTile();
+            } else if (incremental) {
+                // A freshly cleared tile that would be drawn exactly as last frame keeps
+                // its pixels. Drawing over content from an earlier flush makes it unknown.
+                uint64_t signature = UNKNOWN_SIGNATURE;
+                if (tileState[tile] & TILE_CLEAR_PENDING) {
+                    tileState[tile] &= ~TILE_CLEAR_PENDING;
+                    signature = tileSignature(replay, replayCount, tile, depthTest);
+                    if (signature == tileSignatures[tile]) {
+                        counters.tilesReused.fetch_add(1, std::memory_order_relaxed);
+                        return;
+                    }
+                    clearTile();
+                } else {
+                    bool empty = true;
+                    for (size_t b = 0; b < replayCount && empty; b++) {
+                        empty = replay[b].binStart[tile] == replay[b].binStart[tile + 1];
+                    }
+                    if (empty) {
+                        return;
+                    }
+                }
+                tileSignatures[tile] = signature;
+                tileState[tile] |= TILE_CHANGED;
+            }
+            counters.tilesDrawn.fetch_add(1, std::memory_order_relaxed);
+
+            size_t written = 0;
+            for (size_t b = 0; b < replayCount; b++) {
+                const TriangleBatch& batch = replay[b];
+                for (uint32_t i = batch.binStart[tile]; i < batch.binStart[tile + 1]; i++) {
+                    written += rasterizeTriangle(frameBuffer, batch.triangles[batch.binItems[i]], rect, depthTest, lightDirection);
+                }
+            }
+            counters.pixelsWritten.fetch_add(written, std::memory_order_relaxed);
+        });
+    }
+
+    namespace {
+        // Order dependent 64-bit hash of 32-bit words
+        inline uint64_t hashWord(uint64_t hash, uint32_t word) {
+            hash = (hash + word) * 0x9E3779B97F4A7C15ull;
+            return hash ^ (hash >> 32);
+        }
+    }
+
+    uint64_t Renderer::tileSignature(const TriangleBatch* replay, size_t replayCount, size_t tile, bool depthTest) const {
+        // Everything that decides the tile's pixels after a clear: the triangles it
+        // replays, in order, the depth test and the light that Phong shading reads.
+        // Textures are immutable once shared with a mesh, so their address stands
+        // in for their texels.
+        uint64_t hash = hashWord(0x243F6A8885A308D3ull, depthTest ? 1u : 0u);
+        uint32_t light[3];
+        std::memcpy(light, &lightDirection, sizeof(light));
+        for (uint32_t word : light) {
+            hash = hashWord(hash, word);
+        }
+        for (size_t b = 0; b < replayCount; b++) {
+            const TriangleBatch& batch = replay[b];
+            for (uint32_t i = batch.binStart[tile]; i < batch.binStart[tile + 1]; i++) {
+                const RasterTriangle& tri = batch.triangles[batch.binItems[i]];
+                uint32_t words[31];
+                size_t count = 11;
+                std::memcpy(words, tri.points, sizeof(float) * 9);
+                words[9] = tri.color;
+                words[10] = (uint32_t)tri.shading | (uint32_t)tri.blend << 8;
+                if (tri.shading != ShadingMode::Flat) {
+                    std::memcpy(words + count, tri.attributes, sizeof(float) * 9);
+                    count += 9;
+                }
+                if (tri.texture) {
+                    uint64_t address = (uint64_t)(uintptr_t)tri.texture;
+                    words[count++] = (uint32_t)address;
+                    words[count++] = (uint32_t)(address >> 32);
+                    std::memcpy(words + count, tri.texCoords, sizeof(float) * 9);
+                    count += 9;
+                }
+                for (size_t k = 0; k < count; k++) {
+                    hash = hashWord(hash, words[k]);
+                }
+            }
+        }
+        return hash == UNKNOWN_SIGNATURE ? 1 : hash;
     }
 
     void Renderer::drawTriangle(const triangle& tri, RGB color) {
-        // Set the drawing color
-        SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, 255);
-        
+        // Skip triangles whose coordinates do not fit in pixel integers
+        for (int i = 0; i < 3; i++) {
+            if (!(std::fabs(tri.points[i].x) < 32768.0f && std::fabs(tri.points[i].y) < 32768.0f)) {
+                return;
+            }
+        }
+
+        // Lines go straight to the framebuffer, so queued triangles must land first
+        flush();
+        markTilesChanged((int)std::min({ tri.points[0].x, tri.points[1].x, tri.points[2].x }),
+                         (int)std::min({ tri.points[0].y, tri.points[1].y, tri.points[2].y }),
+                         (int)std::max({ tri.points[0].x, tri.points[1].x, tri.points[2].x }) + 1,
+                         (int)std::max({ tri.points[0].y, tri.points[1].y, tri.points[2].y }) + 1);
+
         // Draw the three edges of the triangle as lines
-        SDL_RenderDrawLine(renderer, 
-                          (int)tri.points[0].x, (int)tri.points[0].y,
-                          (int)tri.points[1].x, (int)tri.points[1].y);
-        
-        SDL_RenderDrawLine(renderer, 
-                          (int)tri.points[1].x, (int)tri.points[1].y,
-                          (int)tri.points[2].x, (int)tri.points[2].y);
-        
-        SDL_RenderDrawLine(renderer, 
-                          (int)tri.points[2].x, (int)tri.points[2].y,
-                          (int)tri.points[0].x, (int)tri.points[0].y);
+        uint32_t argb = color.toARGB();
+        rasterizeLine(frameBuffer,
+                      (int)tri.points[0].x, (int)tri.points[0].y,
+                      (int)tri.points[1].x, (int)tri.points[1].y, argb);
+
+        rasterizeLine(frameBuffer,
+                      (int)tri.points[1].x, (int)tri.points[1].y,
+                      (int)tri.points[2].x, (int)tri.points[2].y, argb);
+
+        rasterizeLine(frameBuffer,
+                      (int)tri.points[2].x, (int)tri.points[2].y,
+                      (int)tri.points[0].x, (int)tri.points[0].y, argb);
+    }
+
+    namespace {
+        // Pixel coordinates that fit the line rasterizers' integers
+        const float LINE_RANGE = 32768.0f;
+
+        bool insideLineRange(const vec3d& p) {
+            return std::fabs(p.x) < LINE_RANGE && std::fabs(p.y) < LINE_RANGE;
+        }
+
+        // Pixel containing a coordinate in the line range, without a call to floor
+        int pixelOf(float v) {
+            int i = (int)v;
+            return (float)i > v ? i - 1 : i;
+        }
+
+        // Cut a clip space segment down to the view volume, Liang-Barsky style on
+        // the distance to each plane, which is affine along the segment. False when
+        // nothing of it is inside.
+        bool clipSegment(ClipVertex& a, ClipVertex& b) {
+            float distanceA[6] = { a.z, a.w - a.z, a.w + a.x, a.w - a.x, a.w + a.y, a.w - a.y };
+            float distanceB[6] = { b.z, b.w - b.z, b.w + b.x, b.w - b.x, b.w + b.y, b.w - b.y };
+            float enter = 0.0f, leave = 1.0f;
+            for (int i = 0; i < 6; i++) {
+                if (distanceA[i] < 0.0f && distanceB[i] < 0.0f) {
+                    return false;
+                }
+                float t = distanceA[i] / (distanceA[i] - distanceB[i]);
+                if (distanceA[i] < 0.0f) {
+                    enter = std::max(enter, t);
+                } else if (distanceB[i] < 0.0f) {
+                    leave = std::min(leave, t);
+                }
+            }
+            if (!(enter <= leave)) {
+                return false;
+            }
+            ClipVertex start = a;
+            auto lerp = [&](float t) {
+                return ClipVertex{ start.x + (b.x - start.x) * t, start.y + (b.y - start.y) * t,
+                                   start.z + (b.z - start.z) * t, start.w + (b.w - start.w) * t };
+            };
+            a = lerp(enter);
+            b = lerp(leave);
+            return true;
+        }
+    }
+
+    void Renderer::drawWireframe(const mesh& m, const matrix4x4& model, const Camera& camera, RGB color) {
+        matrix4x4 modelViewProjection = model * camera.getViewProjectionMatrix();
+        size_t vertexCount = m.vertices.size();
+        meshVertices.resize(vertexCount, ShadingMode::Flat);
+        pool->parallelFor((vertexCount + VERTEX_CHUNK - 1) / VERTEX_CHUNK, [&](size_t chunk) {
+            ProfileScope scope(profiler, ProfileStage::Transform);
+            size_t begin = chunk * VERTEX_CHUNK;
+            transformVertices(m, modelViewProjection, meshVertices, begin, std::min(VERTEX_CHUNK, vertexCount - begin));
+        });
+        drawEdges(m, meshVertices, color.toARGB());
+    }
+
+    void Renderer::drawEdges(const mesh& m, const VertexCache& cache, uint32_t color) {
+        // Lines go straight to the framebuffer, so queued triangles must land first
+        flush();
+        ProfileScope scope(profiler, ProfileStage::Rasterize);
+
+        float halfWidth = (float)screenWidth / 2.0f;
+        float halfHeight = (float)screenHeight / 2.0f;
+        float minX = INFINITY, minY = INFINITY, maxX = -INFINITY, maxY = -INFINITY;
+        auto drawEdge = [&](uint32_t a, uint32_t b) {
+            uint8_t codeA = cache.clipCodes[a], codeB = cache.clipCodes[b];
+            if (codeA & codeB) {
+                return;
+            }
+
+            // Edges leaving the view volume end where they cross its planes
+            vec3d p0 = cache.screen.get(a), p1 = cache.screen.get(b);
+            if (codeA | codeB) {
+                ClipVertex c0 = { cache.clip.x[a], cache.clip.y[a], cache.clip.z[a], cache.clipW[a] };
+                ClipVertex c1 = { cache.clip.x[b], cache.clip.y[b], cache.clip.z[b], cache.clipW[b] };
+                if (!clipSegment(c0, c1)) {
+                    return;
+                }
+                p0 = vec3d((c0.x / c0.w + 1.0f) * halfWidth, (c0.y / c0.w + 1.0f) * halfHeight, 0.0f);
+                p1 = vec3d((c1.x / c1.w + 1.0f) * halfWidth, (c1.y / c1.w + 1.0f) * halfHeight, 0.0f);
+            }
+            if (!insideLineRange(p0) || !insideLineRange(p1)) {
+                return;
+            }
+
+            if (lineAntialiasing) {
+                rasterizeSmoothLine(frameBuffer, p0.x, p0.y, p1.x, p1.y, color);
+            } else {
+                rasterizeLine(frameBuffer, pixelOf(p0.x), pixelOf(p0.y), pixelOf(p1.x), pixelOf(p1.y), color);
+            }
+            minX = std::min({ minX, p0.x, p1.x });
+            minY = std::min({ minY, p0.y, p1.y });
+            maxX = std::max({ maxX, p0.x, p1.x });
+            maxY = std::max({ maxY, p0.y, p1.y });
+        };
+
+        if (!m.edges.empty()) {
+            const uint32_t* edges = m.edges.data();
+            for (size_t e = 0; e + 1 < m.edges.size(); e += 2) {
+                drawEdge(edges[e], edges[e + 1]);
+            }
+        } else {
+            const uint32_t* indices = m.indices.data();
+            for (size_t t = 0; t < m.triangleCount(); t++) {
+                drawEdge(indices[t * 3], indices[t * 3 + 1]);
+                drawEdge(indices[t * 3 + 1], indices[t * 3 + 2]);
+                drawEdge(indices[t * 3 + 2], indices[t * 3]);
+            }
+        }
+
+        // Anti-aliased lines reach a pixel further
+        if (minX <= maxX) {
+            markTilesChanged((int)minX - 2, (int)minY - 2, (int)maxX + 3, (int)maxY + 3);
+        }
     }
 
     void Renderer::fillTriangle(const triangle& tri, RGB color) {
-        Sint16 vx[3] = { (Sint16)tri.points[0].x, (Sint16)tri.points[1].x, (Sint16)tri.points[2].x };
-        Sint16 vy[3] = { (Sint16)tri.points[0].y, (Sint16)tri.points[1].y, (Sint16)tri.points[2].y };
-        
-        // Set the drawing color
-        SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, 255);
-        
-        // Fill the triangle
-        filledPolygonRGBA(renderer, vx, vy, 3, color.r, color.g, color.b, 255);
+        // Edge function rasterization with per-pixel depth testing
+        flush();
+        markTilesChanged(0, 0, screenWidth, screenHeight);
+        rasterizeTriangle(frameBuffer, tri, color.toARGB());
     }
 
 
+    std::ostream& operator<<(std::ostream& out, const FrameStats& stats) {
+        out << stats.triangles << " of " << stats.submitted << " triangles in " << stats.batches << " batches ("
+            << stats.frustumCulled << " outside the frustum, " << stats.backfaceCulled << " back-facing, "
+            << stats.clipped << " clipped)";
+        if (stats.lodReduced) {
+            out << ", " << stats.lodReduced << " saved by LOD";
+        }
+        if (stats.occluded) {
+            out << ", " << stats.occluded << " occluded (" << stats.instancesOccluded << " instances)";
+        }
+        out << ", " << stats.pixelsWritten << " pixels";
+        if (stats.pixelsCovered) {
+            out << " (overdraw " << stats.overdraw() << ")";
+        }
+        out << ", " << stats.tilesDrawn << " tiles drawn, " << stats.tilesReused << " reused";
+        out << ", arena "
+            << stats.arena.allocations << " allocations, " << stats.arena.bytesUsed / 1024 << " / "
+            << stats.arena.capacity / 1024 << " KB, " << stats.arena.heapAllocations << " heap allocations";
+        return out;
+    }
+
     RGB Renderer::calculateShadedColor(float lightIntensity) {
         // Convert light intensity to grayscale color
-        Uint8 intensity = (Uint8)(lightIntensity * 255.0f);
+        uint8_t intensity = (uint8_t)(lightIntensity * 255.0f);
         return RGB(intensity, intensity, intensity);
     }
 };
\ No newline at end of file
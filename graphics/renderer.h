@@ -1,15 +1,42 @@
-#include <SDL.h>
+#ifndef RENDERER_H
+#define RENDERER_H
+
 #include <vector>
+#include <atomic>
 #include <cmath>
+#include <cstdint>
 #include <algorithm>
+#include <memory>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 #include "../include/engine.h"
+#include "../include/bvh.h"
+#include "../include/camera.h"
+#include "../include/scene.h"
+#include "../include/framearena.h"
+#include "../include/profiler.h"
+#include "../include/threadpool.h"
+#include "rasterizer.h"
+#include "clipper.h"
+#include "hizbuffer.h"
 using namespace std;
 
+// SDL handles are only touched by renderer.cpp, so SDL.h is not needed here
+struct SDL_Window;
+struct SDL_Renderer;
+struct SDL_Texture;
+
 namespace Engine3D {
 
     struct RGB {
-        Uint8 r, g, b;
-        RGB(Uint8 red, Uint8 green, Uint8 blue) : r(red), g(green), b(blue) {}
+        uint8_t r, g, b;
+        RGB(uint8_t red, uint8_t green, uint8_t blue) : r(red), g(green), b(blue) {}
+
+        // Pack as ARGB8888, the framebuffer pixel format
+        uint32_t toARGB() const {
+            return 0xFF000000u | ((uint32_t)r << 16) | ((uint32_t)g << 8) | (uint32_t)b;
+        }
         
         // Static color constants
         static const RGB WHITE;
@@ -19,14 +46,201 @@ namespace Engine3D {
         static const RGB BLACK;
     };
 
+    // Counters of the last presented frame
+    struct FrameStats {
+        size_t batches = 0;
+        size_t submitted = 0;       // triangles of every drawn mesh instance
+        size_t lodReduced = 0;      // left out by drawing simplified levels of detail
+        size_t frustumCulled = 0;   // outside the view frustum, by bounds, BVH or outcodes
+        size_t occluded = 0;        // behind drawScene's occluders, by instance bounds or singly
+        size_t instancesOccluded = 0;
+        size_t backfaceCulled = 0;
+        size_t clipped = 0;         // crossing a clip plane, cut down before binning
+        size_t triangles = 0;  // after culling and clipping, as binned for the tiles
+        size_t pixelsWritten = 0;   // every pixel passing the depth test, overdraw included
+        size_t pixelsCovered = 0;   // distinct pixels drawn, only counted while profiling
+        size_t tilesDrawn = 0;      // tiles rasterized, once per flush
+        size_t tilesReused = 0;     // tiles kept from the previous frame in incremental mode
+        Rect changed = { 0, 0, 0, 0 };  // pixels that may differ from the previous frame
+        FrameArena::Stats arena;
+
+        // Average writes per drawn pixel, 0 when not profiling
+        double overdraw() const { return pixelsCovered ? (double)pixelsWritten / (double)pixelsCovered : 0.0; }
+    };
+
+    std::ostream& operator<<(std::ostream& out, const FrameStats& stats);
+
     class Renderer {
         private:
+            // Screen tiles rasterized independently by the worker threads
+            static const int TILE_SIZE = 64;
+
+            // Triangles produced by one geometry task, binned by the tiles they touch.
+            // All of its storage comes from the frame arena.
+            struct TriangleBatch {
+                ArenaArray<RasterTriangle> triangles;
+                uint32_t* binStart;  // tileCount + 1 offsets into binItems
+                uint32_t* binItems;  // triangle indices grouped by tile
+            };
+
             SDL_Window* window;
             SDL_Renderer* renderer;
+            SDL_Texture* texture;
             int screenWidth, screenHeight;
+            bool headless;
+            FrameBuffer frameBuffer;
+
+            // Occluders of the scene being drawn; only consulted by drawScene's draws
+            HiZBuffer hiZ;
+            bool occlusionCulling;
+            bool occlusionActive;
+
+            std::unique_ptr<ThreadPool> pool;
+            int tilesX, tilesY;
+            std::vector<TriangleBatch> batches;
+            size_t batchCount;
+
+            // Painter's mode state: the queued triangles re-batched back to front
+            bool painterMode;
+            std::vector<TriangleBatch> sortedBatches;
+
+            // Transformed copies of one mesh's vertices, reused across draws and frames
+            struct VertexCache {
+                VertexStream clip;
+                std::vector<float> clipW;
+                std::vector<uint8_t> clipCodes;  // ClipPlane bits per vertex
+                VertexStream screen;
+
+                // Smooth shading only: world space unit normals for Phong, light
+                // intensities for Gouraud
+                VertexStream normals;
+                std::vector<float> intensity;
+
+                void resize(size_t count, ShadingMode shading);
+            };
+
+            // Per-draw constants of one mesh instance
+            struct DrawParams {
+                matrix4x4 modelViewProjection;
+                matrix4x4 normalMatrix;  // object to world space normals
+                ShadingMode shading;     // set by drawMeshInstance and drawInstances
+                const Texture* texture;  // likewise, nullptr when drawn untextured
+
+                DrawParams(const matrix4x4& model, const matrix4x4& viewProjection);
+            };
+
+            // A small mesh instance waiting to be drawn by drawInstances
+            struct Instance {
+                const mesh* source;
+                const matrix4x4* model;
+            };
+
+            VertexCache meshVertices;
+            std::vector<Instance> pendingInstances;
+
+            // A scene instance inside the view frustum, as drawScene will draw it
+            struct SceneDraw {
+                const mesh* drawn;       // the mesh or the level of detail chosen for it
+                const matrix4x4* model;
+                OcclusionBounds screen;
+                bool hasScreenBounds;    // false when its bounds reach past the near plane
+            };
+            std::vector<SceneDraw> sceneDraws;
+            std::vector<uint32_t> occluderOrder;
+
+            // Frustum culling results of the current draw
+            std::vector<BVH::Range> visibleRanges;
+
+            // Transient per-frame buffers: batches, bins and culled triangle lists,
+            // taken from the arena of the frame being recorded. Reset once the frame
+            // has been rasterized.
+            FrameArena arenas[2];
+            FrameArena* arena;
+            FrameStats lastFrameStats;
+            size_t frameBatches, frameTriangles;
+
+            // Pipelined mode: present() hands the frame's batches and arena to a raster
+            // thread that lives as long as the mode is on, and the next frame is
+            // recorded into the other arena meanwhile. The handoff fields are guarded by
+            // rasterMutex; rasterBatches and rasterArena belong to the raster thread
+            // while rasterQueued is set.
+            bool pipelined;
+            std::vector<TriangleBatch> rasterBatches;
+            FrameArena* rasterArena;
+            FrameStats rasterStats;  // geometry counters of the frame in flight
+            bool rasterInFlight;     // handed over and not completed by finish() yet
+            std::thread rasterThread;
+            std::mutex rasterMutex;
+            std::condition_variable rasterWake, rasterDone;
+            bool rasterQueued, rasterStop;
+            size_t rasterCount;
+            bool rasterClear;
+
+            // Counters of the frame being drawn, added to by the geometry and tile tasks.
+            // Only tile tasks add to the pixel and tile counters, and they never overlap
+            // with those of another frame.
+            struct FrameCounters {
+                std::atomic<size_t> submitted{ 0 }, lodReduced{ 0 }, frustumCulled{ 0 }, backfaceCulled{ 0 }, clipped{ 0 }, pixelsWritten{ 0 };
+                std::atomic<size_t> occluded{ 0 }, instancesOccluded{ 0 };
+                std::atomic<size_t> tilesDrawn{ 0 }, tilesReused{ 0 };
+            };
+            FrameCounters counters;
+
+            Profiler profiler;
+            bool overlayEnabled;
+
+            // Incremental mode defers clear() to flush, which keeps a tile's pixels when
+            // everything it replays hashes the same as what it holds from the last frame
+            enum TileState : uint8_t {
+                TILE_CLEAR_PENDING = 1,  // cleared by clear() but not resolved by flush yet
+                TILE_CHANGED = 2         // written since the last present
+            };
+            bool incremental;
+            bool clearPending;
+            std::vector<uint8_t> tileState;
+            std::vector<uint64_t> tileSignatures;  // what each tile holds, or 0 if unknown
+
+            ShadingMode shadingMode;
+            vec3d lightDirection;  // unit length, towards the light
+            float lodThreshold;    // pixels
+            bool lineAntialiasing;
+
+            void transformVertices(const mesh& m, const matrix4x4& modelViewProjection,
+                                   VertexCache& cache, size_t begin, size_t count);
+            void shadeVertices(const mesh& m, const DrawParams& params, VertexCache& cache, size_t begin, size_t count);
+            ShadingMode shadingFor(const mesh& m) const;
+            static const Texture* textureFor(const mesh& m);
+            float lodPixelScale(const Camera& camera) const;
+            const mesh& selectLOD(const mesh& m, const AABB& bounds, const matrix4x4& model,
+                                  const matrix4x4& modelViewProjection, float pixelScale);
+            void shadeTriangles(const mesh& m, const VertexCache& cache, const uint32_t* triangleOrder,
+                                size_t begin, size_t end, const DrawParams& params, TriangleBatch& batch);
+            int clipTriangle(const VertexCache& cache, const uint32_t* index, uint8_t codes,
+                             const RasterTriangle& shaded, ShadedScreenVertex* clipped) const;
+            void emitClippedTriangle(TriangleBatch& batch, const VertexCache& cache, const uint32_t* index,
+                                     uint8_t codes, const RasterTriangle& shaded);
+            void buildOcclusion(const matrix4x4& viewProjection);
+            void addOccluder(const mesh& m, const matrix4x4& modelViewProjection);
+            void drawInstances(const std::vector<Instance>& instances, const matrix4x4& viewProjection);
+            void drawMeshInstance(const mesh& m, const DrawParams& params);
+            void drawEdges(const mesh& m, const VertexCache& cache, uint32_t color);
+            void binBatch(TriangleBatch& batch, FrameArena& frameArena);
+            size_t sortBatches(const TriangleBatch* source, size_t count, FrameArena& frameArena);
+            void flush();
+            void rasterize(const TriangleBatch* replay, size_t replayCount, FrameArena& frameArena, bool clear);
+            FrameStats takeGeometryStats();
+            void completeFrame(const FrameStats& geometry, FrameArena& frameArena);
+            void rasterLoop();
+            void stopRasterThread();
+            size_t countCoveredPixels();
+            uint64_t tileSignature(const TriangleBatch* replay, size_t replayCount, size_t tile, bool depthTest) const;
+            void markTilesChanged(int x0, int y0, int x1, int y1);
+            Rect takeChangedRect();
+            void drawOverlay();
                 
         public:
-            Renderer(int width, int height);
+            // A headless renderer never touches SDL and only renders into its framebuffer
+            Renderer(int width, int height, bool headless = false);
             ~Renderer();
 
             bool init();
@@ -34,21 +248,103 @@ namespace Engine3D {
             void present();
             void cleanup();
 
+            // Wait for a pipelined frame still being rasterized and show it. Until
+            // then the framebuffer and frame stats are those of the frame before.
+            void finish();
+
+            // Pipelined frames: present() returns as soon as the frame's triangles are
+            // queued, rasterizes them while the caller draws the next frame, and shows
+            // the result on the next present() or finish(). Drawing outside the tile
+            // rasterizer (wireframes, drawTriangle, fillTriangle) waits for it. Two
+            // frames' transient buffers are alive at once. Off by default.
+            void setPipelinedFrames(bool enabled);
+            bool getPipelinedFrames() const { return pipelined; }
+
+            // Worker threads used for geometry and tile rasterization, 0 for all cores
+            void setThreadCount(unsigned count);
+            unsigned getThreadCount() const { return pool->getThreadCount(); }
+
+            // Triangles are binned as they are drawn and rasterized by present()
+            bool isHeadless() const { return headless; }
+            const FrameBuffer& getFrameBuffer() const { return frameBuffer; }
+            const FrameStats& getFrameStats() const { return lastFrameStats; }
+
+            // Stage timers, frame-time history and trace capture. Enabling the profiler
+            // also counts the distinct pixels drawn, for overdraw.
+            Profiler& getProfiler() { return profiler; }
+            const Profiler& getProfiler() const { return profiler; }
+
+            // Frame counters, stage times and a frame-time graph drawn over the image
+            // by present(). Turning it on enables the profiler.
+            void setOverlayEnabled(bool enabled);
+            bool isOverlayEnabled() const { return overlayEnabled; }
+
+            // Only re-rasterize tiles whose triangles changed since the previous frame,
+            // and only upload the changed part of the image. clear() is deferred, so the
+            // framebuffer is only up to date after present(). Off by default.
+            void setIncrementalRendering(bool enabled);
+            bool getIncrementalRendering() const { return incremental; }
+
+            // Painter's mode draws triangles back to front by their average depth
+            // without depth testing, the order blending needs for transparency. The
+            // z-buffer is still written. Off by default.
+            void setPainterMode(bool enabled);
+            bool getPainterMode() const { return painterMode; }
+
+            // Gouraud lights every vertex and interpolates the intensity, Phong
+            // interpolates the normals and lights every pixel. Both need vertex normals
+            // (see mesh::normals); meshes without them are drawn flat. Flat by default.
+            void setShadingMode(ShadingMode mode) { shadingMode = mode; }
+            ShadingMode getShadingMode() const { return shadingMode; }
+
+            // Direction towards the directional light in world space, normalized once
+            // here instead of for every triangle. Defaults to (0, 0, -1).
+            void setLightDirection(const vec3d& direction);
+            const vec3d& getLightDirection() const { return lightDirection; }
+
+            // Meshes with a LOD chain (see mesh::buildLODs) are drawn with the coarsest
+            // level whose error covers fewer than this many pixels at the mesh's
+            // nearest point to the camera; 0 always draws the full mesh. Defaults to 1.
+            void setLODThreshold(float pixels) { lodThreshold = pixels; }
+            float getLODThreshold() const { return lodThreshold; }
+
+            // drawScene first rasterizes its nearest large instances as occluders into
+            // a low resolution hierarchical depth buffer, then skips instances and
+            // triangles entirely behind them. Only work that would fail the depth test
+            // is skipped, so the image is unchanged. Not done in painter's mode. On by
+            // default.
+            void setOcclusionCulling(bool enabled) { occlusionCulling = enabled; }
+            bool getOcclusionCulling() const { return occlusionCulling; }
+
+            // Wireframe of a mesh at its position, projected without a camera (see
+            // drawWireframe)
             void drawMesh(const mesh& m, const matrix4x4& projection);
-            void drawMesh(const mesh& m, const matrix4x4& projection, const matrix4x4& rotX, const matrix4x4& rotZ);
-            void drawMesh(const mesh& m, const matrix4x4& projection, const matrix4x4& rotX, const matrix4x4& rotZ, vec3d cameraPos);
+
+            // Draw a mesh at its position, seen from the camera
+            void drawMesh(const mesh& m, const Camera& camera);
+
+            // Draw a mesh placed in the world by the model matrix. Model, view and
+            // projection are concatenated once, so each vertex is transformed once.
+            void drawMesh(const mesh& m, const matrix4x4& model, const Camera& camera);
+
+            // Draw every mesh instance of the scene with its world transform. Call
+            // scene.updateTransforms() first if any node was moved.
+            void drawScene(const Scene& scene, const Camera& camera);
+
+            // Draw the edges of a mesh placed in the world by the model matrix as lines
+            // straight into the framebuffer, over what was drawn before and without
+            // depth testing. Every vertex is transformed once. Meshes with an edge list
+            // (see mesh::computeEdges) draw each edge once, others every triangle side.
+            void drawWireframe(const mesh& m, const matrix4x4& model, const Camera& camera, RGB color);
+
+            // Wireframes drawn with anti-aliased lines. Off by default.
+            void setLineAntialiasing(bool enabled) { lineAntialiasing = enabled; }
+            bool getLineAntialiasing() const { return lineAntialiasing; }
+
             void drawTriangle(const triangle& tri, RGB color);
             void fillTriangle(const triangle& tri, RGB color);
             RGB calculateShadedColor(float lightIntensity);
-            
-            // Struct to hold triangle with its depth for sorting
-            struct TriangleDepth {
-                triangle tri;
-                float depth;
-                RGB color;
-                
-                TriangleDepth(const triangle& t, float d, const RGB& c) 
-                    : tri(t), depth(d), color(c) {}
-            };
     };
-};
\ No newline at end of file
+};
+
+#endif
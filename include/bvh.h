@@ -0,0 +1,107 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include "engine.h"
+
+namespace Engine3D {
+
+    // Axis-aligned bounding box
+    struct AABB {
+        vec3d min, max;
+
+        AABB() : min(INFINITY, INFINITY, INFINITY), max(-INFINITY, -INFINITY, -INFINITY) {}
+
+        void expand(const vec3d& p) {
+            min = vec3d(std::min(min.x, p.x), std::min(min.y, p.y), std::min(min.z, p.z));
+            max = vec3d(std::max(max.x, p.x), std::max(max.y, p.y), std::max(max.z, p.z));
+        }
+
+        void expand(const AABB& b) {
+            expand(b.min);
+            expand(b.max);
+        }
+
+        vec3d center() const {
+            return vec3d((min.x + max.x) * 0.5f, (min.y + max.y) * 0.5f, (min.z + max.z) * 0.5f);
+        }
+
+        float surfaceArea() const {
+            vec3d d = max - min;
+            if (d.x < 0.0f) return 0.0f;
+            return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+        }
+    };
+
+    // Plane dot(normal, p) + d = 0, with the inside where the value is positive
+    struct Plane {
+        vec3d normal;
+        float d;
+
+        float distance(const vec3d& p) const { return normal.dot(p) + d; }
+    };
+
+    // The six clip planes of a model-view-projection matrix, in the space the matrix
+    // transforms from. Visible points satisfy -w <= x, y <= w and 0 <= z <= w.
+    struct Frustum {
+        Plane planes[6];
+
+        static Frustum fromMatrix(const matrix4x4& m);
+
+        enum Result { Outside, Intersecting, Inside };
+        Result classify(const AABB& box) const;
+    };
+
+    struct Ray {
+        vec3d origin;
+        vec3d direction;
+    };
+
+    struct RayHit {
+        float t;            // distance along the ray in units of direction
+        uint32_t triangle;  // index into the mesh's triangles
+        float u, v;         // barycentric coordinates of points[1] and points[2]
+    };
+
+    // Bounding volume hierarchy over the triangles of one mesh, built with binned SAH.
+    // Each node covers a contiguous range of triangleOrder, so a subtree that is fully
+    // inside the frustum is accepted as one range without visiting its children.
+    class BVH {
+        public:
+            struct Node {
+                AABB bounds;
+                uint32_t begin, count;  // range in triangleOrder
+                uint32_t left;          // first child, the second follows it; 0 for leaves
+            };
+
+            // Triangle range [begin, begin + count) of triangleOrder
+            struct Range {
+                uint32_t begin, count;
+            };
+
+            void build(const mesh& m);
+
+            // Recompute the bounds after vertices moved, keeping the tree topology
+            void refit(const mesh& m);
+
+            size_t triangleCount() const { return triangleOrder.size(); }
+            bool empty() const { return nodes.empty(); }
+            const AABB& bounds() const { return nodes[0].bounds; }
+            const std::vector<Node>& getNodes() const { return nodes; }
+            const std::vector<uint32_t>& getTriangleOrder() const { return triangleOrder; }
+
+            // Ranges of triangleOrder whose leaves may be visible
+            void cullFrustum(const Frustum& frustum, std::vector<Range>& visible) const;
+
+            // Closest triangle hit by the ray, in the mesh's object space
+            bool intersectRay(const mesh& m, const Ray& ray, RayHit& hit) const;
+
+        private:
+            std::vector<Node> nodes;
+            std::vector<uint32_t> triangleOrder;
+    };
+}
+
+#endif
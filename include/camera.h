@@ -0,0 +1,44 @@
+#ifndef CAMERA_H
+#define CAMERA_H
+
+#include "engine.h"
+
+namespace Engine3D {
+
+    // Perspective camera placed by a position and yaw/pitch angles. World y points
+    // down the screen like the projection does, so "up" is -y; yaw turns around the
+    // vertical axis and a positive pitch looks up.
+    class Camera {
+        public:
+            vec3d position;
+            float yaw = 0.0f;    // radians, 0 looks down +z
+            float pitch = 0.0f;  // radians, clamped short of straight up or down
+            float fov = 90.0f;   // vertical field of view in degrees
+            float aspectRatio;   // height / width
+            float zNear = 0.1f;
+            float zFar = 1000.0f;
+
+            Camera(float width, float height) : aspectRatio(height / width) {}
+
+            vec3d forward() const;
+            vec3d right() const;
+            vec3d up() const;
+
+            // Turn to face a point
+            void lookAt(const vec3d& target);
+
+            // Move relative to the current orientation
+            void move(float forwardAmount, float rightAmount, float upAmount);
+
+            // Adjust yaw and pitch, keeping the pitch away from the poles
+            void rotate(float yawDelta, float pitchDelta);
+
+            matrix4x4 getViewMatrix() const;
+            matrix4x4 getProjectionMatrix() const;
+
+            // View followed by projection, ready to be prefixed by a model matrix
+            matrix4x4 getViewProjectionMatrix() const { return getViewMatrix() * getProjectionMatrix(); }
+    };
+}
+
+#endif
@@ -2,6 +2,10 @@
 #define ENGINE_H
 
 #include <vector>
+#include <cstdint>
+#include <string>
+#include <cmath>
+#include <memory>
 #include <iostream>
 using namespace std;
 
@@ -106,11 +110,178 @@ namespace Engine3D {
         }
     };
 
+    // Contiguous array that either owns its elements or borrows them from read-only
+    // memory kept alive by owner, such as a memory-mapped mesh cache. Modifying a
+    // borrowed array copies it into owned storage first.
+    template <typename T>
+    class GeometryArray {
+        public:
+            size_t size() const { return borrowed ? borrowedSize : storage.size(); }
+            bool empty() const { return size() == 0; }
+            bool isBorrowed() const { return borrowed != nullptr; }
+
+            const T* data() const { return borrowed ? borrowed : storage.data(); }
+            T* data() { makeOwned(); return storage.data(); }
+
+            const T& operator[](size_t i) const { return data()[i]; }
+            T& operator[](size_t i) { makeOwned(); return storage[i]; }
+
+            const T* begin() const { return data(); }
+            const T* end() const { return data() + size(); }
+            T* begin() { return data(); }
+            T* end() { return data() + size(); }
+
+            void push_back(const T& value) { makeOwned(); storage.push_back(value); }
+            void reserve(size_t n) { makeOwned(); storage.reserve(n); }
+            void resize(size_t n) { makeOwned(); storage.resize(n); }
+            void clear() { release(); storage.clear(); }
+
+            void borrow(const T* elements, size_t count, shared_ptr<const void> keepAlive) {
+                storage.clear();
+                borrowed = elements;
+                borrowedSize = count;
+                owner = std::move(keepAlive);
+            }
+
+        private:
+            vector<T> storage;
+            const T* borrowed = nullptr;
+            size_t borrowedSize = 0;
+            shared_ptr<const void> owner;
+
+            void makeOwned() {
+                if (borrowed) {
+                    storage.assign(borrowed, borrowed + borrowedSize);
+                    release();
+                }
+            }
+
+            void release() {
+                borrowed = nullptr;
+                borrowedSize = 0;
+                owner.reset();
+            }
+    };
+
+    // Structure-of-arrays vertex positions, the layout the batch transforms consume
+    struct VertexStream {
+        GeometryArray<float> x, y, z;
+
+        size_t size() const { return x.size(); }
+        bool empty() const { return x.empty(); }
+
+        void reserve(size_t n) { x.reserve(n); y.reserve(n); z.reserve(n); }
+        void resize(size_t n) { x.resize(n); y.resize(n); z.resize(n); }
+        void clear() { x.clear(); y.clear(); z.clear(); }
+
+        void push_back(const vec3d& v) {
+            x.push_back(v.x);
+            y.push_back(v.y);
+            z.push_back(v.z);
+        }
+
+        vec3d get(size_t i) const { return vec3d(x[i], y[i], z[i]); }
+        void set(size_t i, const vec3d& v) { x[i] = v.x; y[i] = v.y; z[i] = v.z; }
+    };
+
+    // Structure-of-arrays texture coordinates, with v = 0 at the top of the image
+    struct TexCoordStream {
+        GeometryArray<float> u, v;
+
+        size_t size() const { return u.size(); }
+        bool empty() const { return u.empty(); }
+
+        void resize(size_t n) { u.resize(n); v.resize(n); }
+        void clear() { u.clear(); v.clear(); }
+
+        void push_back(float s, float t) {
+            u.push_back(s);
+            v.push_back(t);
+        }
+    };
+
+    class BVH;
+    class Texture;
+    class ThreadPool;
+    struct mesh;
+
+    // A simplified version of a mesh and the object space error it was made with
+    struct MeshLOD {
+        shared_ptr<const mesh> geometry;
+        float error;
+    };
+
+    // Indexed triangle mesh: every vertex is stored once and referenced by index
     struct mesh{
-        vector<triangle> triangles;
-        vec3d position;
-        
-        bool loadFromObjectFile(const string& filename);
+        VertexStream vertices;
+        VertexStream normals;  // unit length, one per vertex, or empty
+        VertexStream faceNormals;  // unit length, one per triangle, or empty
+        TexCoordStream texCoords;  // one per vertex, or empty
+        GeometryArray<uint32_t> indices;   // three per triangle
+        GeometryArray<uint32_t> edges;     // two per unique edge, lower index first, or empty
+        vec3d position;  // world placement used by Renderer::drawMesh(mesh, camera)
+
+        // Drawn with texCoords when set (see texture.h), modulated by the lighting
+        shared_ptr<const Texture> texture;
+
+        // Optional acceleration structure used for culling and picking (see bvh.h).
+        // Rebuild after changing the triangles, refit after only moving vertices.
+        shared_ptr<BVH> bvh;
+        void buildBVH();
+        void refitBVH();
+
+        // Optional chain of simplified versions (see simplify.h), each with about half
+        // the triangles of the one before and a larger error. The renderer draws the
+        // coarsest one whose error projects to less than a pixel. Rebuild after editing
+        // the triangles; the chain stops early when simplification stalls.
+        vector<MeshLOD> lods;
+        void buildLODs(size_t minTriangles = 256);
+
+        size_t triangleCount() const { return indices.size() / 3; }
+
+        // Replace the normals with the average of the face normals around each
+        // vertex, weighted by face area. Call after building or editing the triangles.
+        void computeVertexNormals();
+
+        // Optional face normals, which flat shading rotates into the world instead of
+        // recomputing them from the positions every frame. Recompute after editing
+        // the triangles; the renderer ignores them once their count is off.
+        void computeFaceNormals();
+
+        // Optional list of the edges shared by triangles, stored once each, which
+        // wireframes draw instead of every triangle's three. Recompute after
+        // editing the triangles.
+        void computeEdges();
+
+        void addTriangle(uint32_t a, uint32_t b, uint32_t c) {
+            indices.push_back(a);
+            indices.push_back(b);
+            indices.push_back(c);
+        }
+
+        triangle getTriangle(size_t i) const {
+            return triangle(vertices.get(indices[i * 3]),
+                            vertices.get(indices[i * 3 + 1]),
+                            vertices.get(indices[i * 3 + 2]));
+        }
+
+        // Memory-mapped OBJ import, parsed in chunks that run in parallel on the pool
+        // when one is given and on the calling thread otherwise (for callers that
+        // already keep every core busy, such as batch_render). Supports v/vt/vn face
+        // corners, negative indices and polygons, which are triangulated as fans.
+        // Normals come from vn when every corner has one and from computeVertexNormals
+        // otherwise; texture coordinates come from vt when every corner has one.
+        // Vertices used with several normals or texture coordinates are split.
+        // With useCache a binary sidecar (see meshcache.h) is reused while it matches
+        // the OBJ's size and modification time, and written after parsing otherwise.
+        bool loadFromObjectFile(const string& filename, bool useCache = true, ThreadPool* pool = nullptr);
+
+        // Binary mesh cache. Loading maps the file and uses its arrays in place.
+        bool loadFromCacheFile(const string& filename);
+        bool saveToCacheFile(const string& filename) const;
+
+        private:
+            bool parseObjectFile(const string& filename, ThreadPool* pool);
     };
 
     struct matrix4x4{
@@ -128,14 +299,29 @@ namespace Engine3D {
             }
             return o;
         }
+
+        // Concatenation for row vectors: v * (a * b) applies a first, then b
+        matrix4x4 operator *(const matrix4x4& b) const {
+            matrix4x4 o;
+            for (int i = 0; i < 4; i++) {
+                for (int j = 0; j < 4; j++) {
+                    o.m[i][j] = m[i][0] * b.m[0][j] + m[i][1] * b.m[1][j] + m[i][2] * b.m[2][j] + m[i][3] * b.m[3][j];
+                }
+            }
+            return o;
+        }
     };
 
     // Function declarations
     void populateMatrix(matrix4x4& mat, float width, float height, float z_length);
+    void createProjectionMatrix(matrix4x4& mat, float fovDegrees, float aspectRatio, float zNear, float zFar);
     void createRotationMatrixX(matrix4x4& mat, float angle);
+    void createRotationMatrixY(matrix4x4& mat, float angle);
     void createRotationMatrixZ(matrix4x4& mat, float angle);
-    triangle rotateTriangle(const triangle& tri, const matrix4x4& rotX, const matrix4x4& rotZ);
+    void createTranslationMatrix(matrix4x4& mat, float x, float y, float z);
+    void createLookAtMatrix(matrix4x4& mat, const vec3d& eye, const vec3d& target, const vec3d& up);
     float calculateLighting(const vec3d& normal, const vec3d& lightDirection);
+    void populateCube(mesh& m);
 
 }
 
@@ -0,0 +1,105 @@
+#ifndef FRAMEARENA_H
+#define FRAMEARENA_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Engine3D {
+
+    // Bump allocator for data that lives until the end of a frame. Any thread may
+    // allocate; reset() releases everything at once and must not race allocations.
+    // When a frame outgrows the current block another one is chained on, and the
+    // next reset merges them into a single block, so a steady workload stops
+    // touching the heap after its first frames.
+    class FrameArena {
+        public:
+            struct Stats {
+                size_t allocations = 0;      // arena allocations since the last reset
+                size_t bytesUsed = 0;        // including alignment padding
+                size_t capacity = 0;         // bytes reserved from the heap
+                size_t heapAllocations = 0;  // blocks taken from the heap since the last reset
+            };
+
+            explicit FrameArena(size_t initialSize = 1 << 20);
+
+            FrameArena(const FrameArena&) = delete;
+            FrameArena& operator=(const FrameArena&) = delete;
+
+            // Memory is uninitialized and never freed individually
+            void* allocate(size_t bytes, size_t alignment = alignof(std::max_align_t));
+
+            template <typename T>
+            T* allocate(size_t count) {
+                return static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+            }
+
+            void reset();
+
+            Stats getStats() const;
+
+        private:
+            struct Block {
+                std::unique_ptr<char[]> memory;
+                size_t size;
+                std::atomic<size_t> used;
+            };
+
+            Block* addBlock(size_t size);
+
+            std::vector<std::unique_ptr<Block>> blocks;
+            std::atomic<Block*> current;
+            std::mutex growMutex;
+            std::atomic<size_t> allocations;
+            size_t heapAllocations;
+    };
+
+    // Growable array of trivially copyable elements stored in a FrameArena. Growing
+    // copies into a larger allocation and abandons the old one until the reset.
+    template <typename T>
+    class ArenaArray {
+        public:
+            ArenaArray() : elements(nullptr), count(0), capacity(0), arena(nullptr) {}
+
+            void init(FrameArena& frameArena, size_t reserved) {
+                arena = &frameArena;
+                elements = reserved ? arena->allocate<T>(reserved) : nullptr;
+                count = 0;
+                capacity = reserved;
+            }
+
+            void push_back(const T& value) {
+                if (count == capacity) {
+                    size_t grown = capacity ? capacity * 2 : 16;
+                    T* larger = arena->allocate<T>(grown);
+                    if (count) {
+                        std::memcpy(static_cast<void*>(larger), elements, count * sizeof(T));
+                    }
+                    elements = larger;
+                    capacity = grown;
+                }
+                elements[count++] = value;
+            }
+
+            size_t size() const { return count; }
+            bool empty() const { return count == 0; }
+            T* data() { return elements; }
+            const T* data() const { return elements; }
+            T& operator[](size_t i) { return elements[i]; }
+            const T& operator[](size_t i) const { return elements[i]; }
+            T* begin() { return elements; }
+            T* end() { return elements + count; }
+            const T* begin() const { return elements; }
+            const T* end() const { return elements + count; }
+
+        private:
+            T* elements;
+            size_t count, capacity;
+            FrameArena* arena;
+    };
+}
+
+#endif
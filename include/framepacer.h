@@ -0,0 +1,43 @@
+#ifndef FRAMEPACER_H
+#define FRAMEPACER_H
+
+#include <chrono>
+
+namespace Engine3D {
+
+    // Paces a render loop to a target frame rate. Frames are due on a fixed
+    // schedule, so time spent working is subtracted from the wait instead of added
+    // to it; a loop that falls more than a frame behind starts a new schedule
+    // rather than rushing to catch up. The work time of recent frames is averaged
+    // to tell whether the loop keeps up with the target.
+    class FramePacer {
+        public:
+            explicit FramePacer(double framesPerSecond = 60.0);
+
+            void setTargetRate(double framesPerSecond);
+
+            // Sleep until the next frame is due and start timing its work
+            void beginFrame();
+
+            // The frame's work is done
+            void endFrame();
+
+            // Seconds, averaged over recent frames
+            double getAverageWorkTime() const { return averageWork; }
+
+            // True once frames take longer than the target interval, until they get
+            // well below it again
+            bool isBehind() const { return behind; }
+
+        private:
+            using Clock = std::chrono::steady_clock;
+
+            Clock::duration interval;
+            Clock::time_point deadline;
+            Clock::time_point workStart;
+            double averageWork;
+            bool behind;
+    };
+}
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef IMAGEWRITER_H
+#define IMAGEWRITER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Engine3D {
+
+    // Encoders for packed ARGB8888 pixels (the framebuffer format), row by row from
+    // the top. Alpha is dropped. They return false when the file cannot be written.
+
+    // Binary PPM (P6)
+    bool writePPM(const std::string& filename, const uint32_t* pixels, int width, int height);
+
+    // 8-bit RGB PNG compressed with fixed-Huffman deflate, with no zlib dependency
+    bool writePNG(const std::string& filename, const uint32_t* pixels, int width, int height);
+    std::vector<uint8_t> encodePNG(const uint32_t* pixels, int width, int height);
+
+    // PNG or PPM, chosen by the file extension (.png, .ppm)
+    bool writeImage(const std::string& filename, const uint32_t* pixels, int width, int height);
+
+    // Decoders back into opaque ARGB8888 pixels. They return false for files they
+    // cannot read or that are malformed.
+
+    // Binary PPM (P6) with any maximum value up to 255
+    bool readPPM(const std::string& filename, std::vector<uint32_t>& pixels, int& width, int& height);
+
+    // 8-bit RGB PNG without interlacing, with stored or fixed-Huffman deflate blocks:
+    // what writePNG produces, not PNG files in general
+    bool readPNG(const std::string& filename, std::vector<uint32_t>& pixels, int& width, int& height);
+
+    // PNG or PPM, chosen by the file extension (.png, .ppm)
+    bool readImage(const std::string& filename, std::vector<uint32_t>& pixels, int& width, int& height);
+}
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace Engine3D {
+
+    // Read-only view of a whole file. Uses mmap where available, otherwise the file
+    // is read into memory, so callers only ever see a contiguous byte range.
+    class MappedFile {
+        public:
+            MappedFile();
+            ~MappedFile();
+
+            MappedFile(const MappedFile&) = delete;
+            MappedFile& operator=(const MappedFile&) = delete;
+
+            bool open(const std::string& filename);
+            void close();
+
+            bool isOpen() const { return opened; }
+            const char* data() const { return bytes; }
+            size_t size() const { return length; }
+
+        private:
+            const char* bytes;
+            size_t length;
+            bool opened;
+            bool mapped;
+            std::vector<char> fallback;
+    };
+}
+
+#endif
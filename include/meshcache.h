@@ -0,0 +1,43 @@
+#ifndef MESHCACHE_H
+#define MESHCACHE_H
+
+#include <cstdint>
+#include <string>
+
+namespace Engine3D {
+
+    // Binary mesh cache layout, version 3. The header is followed by the vertex x, y
+    // and z arrays (float), the index array (uint32_t), the normal x, y and z arrays
+    // and the texture coordinate u and v arrays (float, normalCount and texCoordCount
+    // of either 0 or vertexCount), each starting at a MESH_CACHE_ALIGNMENT-byte
+    // aligned offset so a mapped file can be used in place.
+    const char MESH_CACHE_MAGIC[4] = { 'E', '3', 'D', 'M' };
+    const uint32_t MESH_CACHE_VERSION = 3;
+    const uint32_t MESH_CACHE_ENDIAN_CHECK = 0x01020304;
+    const uint64_t MESH_CACHE_ALIGNMENT = 64;
+
+    struct MeshCacheHeader {
+        char magic[4];
+        uint32_t version;
+        uint32_t endianCheck;
+        uint32_t reserved;
+
+        // Size and modification time of the source file the cache was built from
+        uint64_t sourceSize;
+        int64_t sourceModified;
+
+        uint64_t vertexCount;
+        uint64_t indexCount;
+        uint64_t xOffset, yOffset, zOffset;
+        uint64_t indexOffset;
+        uint64_t normalCount;
+        uint64_t nxOffset, nyOffset, nzOffset;
+        uint64_t texCoordCount;
+        uint64_t uOffset, vOffset;
+    };
+
+    // Sidecar cache written next to an OBJ file
+    std::string meshCachePath(const std::string& objFilename);
+}
+
+#endif
@@ -0,0 +1,132 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Engine3D {
+
+    // Pipeline stages timed by the renderer
+    enum class ProfileStage : uint8_t {
+        Clear,
+        Cull,
+        Transform,
+        Shade,      // lighting and clipping
+        Bin,
+        Sort,       // painter's mode only
+        Rasterize,
+        Present,    // overlay and upload to the window
+        Count
+    };
+
+    const char* profileStageName(ProfileStage stage);
+
+    // Frame time statistics over the rolling window, in milliseconds
+    struct FrameTimeSummary {
+        size_t frames = 0;
+        double min = 0.0, mean = 0.0, p50 = 0.0, p95 = 0.0, p99 = 0.0, max = 0.0;
+    };
+
+    // Stage timers, a rolling frame-time window and an optional Chrome trace capture.
+    // Disabled by default, where a ProfileScope costs one load and branch. Stage times
+    // are summed over every thread, so parallel stages can exceed the frame time.
+    class Profiler {
+        public:
+            typedef std::chrono::steady_clock Clock;
+
+            // Frames kept for the frame-time summary and histogram
+            static const size_t FRAME_HISTORY = 256;
+
+            Profiler();
+
+            void setEnabled(bool enabled);
+            bool isEnabled() const { return enabled.load(std::memory_order_relaxed); }
+
+            // Called by the timed code, from any thread
+            void record(ProfileStage stage, Clock::time_point start, Clock::time_point end);
+
+            // Close the current frame: its stage times become the last frame's, and the
+            // time since the previous endFrame enters the frame-time window. Frame times
+            // are recorded even while disabled, at the cost of one clock read per frame.
+            void endFrame();
+
+            // Stage time of the last frame in milliseconds
+            double getStageTime(ProfileStage stage) const;
+            double getLastFrameTime() const;
+
+            FrameTimeSummary getFrameTimeSummary() const;
+
+            // Frame times of the window in buckets of bucketMilliseconds; the last bucket
+            // also counts everything slower
+            std::vector<uint32_t> getFrameTimeHistogram(size_t buckets, double bucketMilliseconds) const;
+
+            // Frame times of the window, oldest first, in milliseconds
+            std::vector<float> getFrameTimes() const;
+
+            // Chrome trace capture (chrome://tracing or Perfetto): every timed scope
+            // becomes a complete event and counter samples become counter tracks
+            void startCapture();
+            void stopCapture();
+            bool isCapturing() const { return capturing.load(std::memory_order_relaxed); }
+            void addCounterSample(const char* name, double value);
+            bool writeChromeTrace(const std::string& filename) const;
+
+        private:
+            struct TraceEvent {
+                const char* name;
+                uint32_t thread;
+                bool counter;
+                int64_t start;      // microseconds since the profiler was created
+                int64_t duration;   // microseconds, for timed scopes
+                double value;       // for counter samples
+            };
+
+            int64_t microseconds(Clock::time_point t) const;
+
+            std::atomic<bool> enabled;
+            std::atomic<bool> capturing;
+            Clock::time_point origin;
+            Clock::time_point frameStart;
+
+            std::atomic<int64_t> stageNanoseconds[(size_t)ProfileStage::Count];
+            double lastStageTimes[(size_t)ProfileStage::Count];
+
+            float frameTimes[FRAME_HISTORY];
+            size_t frameCount;
+
+            mutable std::mutex traceMutex;
+            std::vector<TraceEvent> trace;
+    };
+
+    // Times the enclosing scope as one stage while the profiler is enabled
+    class ProfileScope {
+        public:
+            ProfileScope(Profiler& profiler, ProfileStage stage)
+                : profiler(profiler.isEnabled() ? &profiler : nullptr), stage(stage) {
+                if (this->profiler) {
+                    start = Profiler::Clock::now();
+                }
+            }
+
+            ~ProfileScope() {
+                if (profiler) {
+                    profiler->record(stage, start, Profiler::Clock::now());
+                }
+            }
+
+            ProfileScope(const ProfileScope&) = delete;
+            ProfileScope& operator=(const ProfileScope&) = delete;
+
+        private:
+            Profiler* profiler;
+            ProfileStage stage;
+            Profiler::Clock::time_point start;
+    };
+}
+
+#endif
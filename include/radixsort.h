@@ -0,0 +1,27 @@
+#ifndef RADIXSORT_H
+#define RADIXSORT_H
+
+#include <cstddef>
+#include <cstdint>
+#include "threadpool.h"
+
+namespace Engine3D {
+
+    // Pack a sort key and a payload (such as an index) into one radix sort item
+    inline uint64_t makeSortItem(uint32_t key, uint32_t payload) {
+        return ((uint64_t)key << 32) | payload;
+    }
+
+    inline uint32_t sortItemPayload(uint64_t item) {
+        return (uint32_t)item;
+    }
+
+    // Stable LSD radix sort of items by their upper 32 bits, in three 11-bit passes.
+    // Passes where every key has the same digit are skipped. scratch must hold count
+    // items; the result ends up in either buffer and that one is returned. With a
+    // pool, large inputs are split into blocks that are counted and scattered in
+    // parallel, which keeps the order identical to the serial sort.
+    uint64_t* radixSortByKey(uint64_t* items, uint64_t* scratch, size_t count, ThreadPool* pool = nullptr);
+}
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "engine.h"
+#include "bvh.h"
+
+namespace Engine3D {
+
+    // Hierarchy of transform nodes, each optionally drawing one of the scene's meshes.
+    // Meshes are shared: any number of nodes can instance the same mesh, and an
+    // instance only costs its matrices.
+    class Scene {
+        public:
+            typedef uint32_t NodeId;
+            static const uint32_t NONE = UINT32_MAX;
+
+            struct MeshEntry {
+                std::shared_ptr<const mesh> source;
+                AABB bounds;  // object space
+            };
+
+            struct Node {
+                matrix4x4 local;  // relative to the parent
+                matrix4x4 world;  // local concatenated with every ancestor
+                NodeId parent;
+                uint32_t meshIndex;  // NONE for pure transform nodes
+            };
+
+            // Register a mesh for instancing and return its index
+            uint32_t addMesh(std::shared_ptr<const mesh> source);
+
+            // Call after editing a registered mesh in place, to refresh its bounds
+            void markMeshChanged(uint32_t meshIndex);
+
+            // Parents must be added before their children, which keeps the nodes in
+            // an order where one forward pass updates every world matrix
+            NodeId addNode(uint32_t meshIndex, const matrix4x4& local, NodeId parent = NONE);
+
+            // Setting the transform a node already has is not counted as a change
+            void setTransform(NodeId node, const matrix4x4& local);
+            const matrix4x4& getWorldTransform(NodeId node) const { return nodes[node].world; }
+
+            // Recompute world matrices after setTransform; drawing reads them as they are
+            void updateTransforms();
+
+            const std::vector<Node>& getNodes() const { return nodes; }
+            const std::vector<MeshEntry>& getMeshes() const { return meshes; }
+            size_t nodeCount() const { return nodes.size(); }
+            void clear();
+
+            // Incremented by every change to meshes, nodes or transforms, so callers can
+            // tell whether the scene needs to be drawn again
+            uint64_t getVersion() const { return version; }
+
+        private:
+            std::vector<MeshEntry> meshes;
+            std::vector<Node> nodes;
+            bool dirty = false;
+            uint64_t version = 0;
+    };
+
+    // Object space bounds of all of the mesh's vertices
+    AABB computeBounds(const mesh& m);
+}
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef SIMPLIFY_H
+#define SIMPLIFY_H
+
+#include <cstddef>
+#include "engine.h"
+
+namespace Engine3D {
+
+    // Simplify source to at most targetTriangles triangles by quadric error edge
+    // collapses (Garland and Heckbert), always collapsing the edge whose removal
+    // moves the surface least. Vertices are collapsed onto one of their neighbors
+    // instead of a new position, so the kept vertices' normals and texture
+    // coordinates stay valid and are copied as they are. Vertices on open borders
+    // or split along a normal or texture seam never move, which can stop the mesh
+    // short of the target. The texture is shared.
+    // Returns the object space error: the largest root mean square distance of a
+    // collapsed vertex's neighborhood to the planes of the faces it replaced.
+    float simplifyMesh(const mesh& source, size_t targetTriangles, mesh& result);
+}
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef TEXTURE_H
+#define TEXTURE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Engine3D {
+
+    // ARGB8888 texture with its full mip chain, built once when the image is set.
+    // Every level is stored in Morton (Z) order, so texels close in u and v are close
+    // in memory whichever way a triangle walks across the texture. Sizes are powers
+    // of two; other images are resized to the next power of two on creation.
+    class Texture {
+        public:
+            static const int MAX_LEVELS = 16;
+
+            // Pixels are rows from the top. Returns false for an empty or oversized image.
+            bool create(const uint32_t* pixels, int width, int height);
+
+            // Binary PPM (P6), the format writePPM produces
+            bool loadFromFile(const std::string& filename);
+
+            bool empty() const { return levelCount == 0; }
+            int getWidth() const { return levelWidth[0]; }
+            int getHeight() const { return levelHeight[0]; }
+            int getLevelCount() const { return levelCount; }
+
+            // Texel (x, y) of a mip level, with the coordinates wrapped
+            uint32_t fetch(int level, int x, int y) const {
+                x &= levelWidth[level] - 1;
+                y &= levelHeight[level] - 1;
+                return texels[levelOffset[level] + mortonIndex(x, y, levelShift[level])];
+            }
+
+            // Storage layout, for samplers that address the texels themselves. Level
+            // arrays hold MAX_LEVELS entries, repeating the smallest level past the last.
+            const uint32_t* getTexels() const { return texels.data(); }
+            const int32_t* getLevelOffsets() const { return levelOffset; }
+            const int32_t* getLevelWidths() const { return levelWidth; }
+            const int32_t* getLevelHeights() const { return levelHeight; }
+            const int32_t* getLevelShifts() const { return levelShift; }
+
+            // Position of (x, y) within a level whose shorter side is 1 << shift: the
+            // level is a row or column of square blocks of that size, each in Z order
+            static uint32_t mortonIndex(uint32_t x, uint32_t y, int shift) {
+                uint32_t mask = (1u << shift) - 1;
+                uint32_t block = (x >> shift) + (y >> shift);
+                return (block << (2 * shift)) | spreadBits(x & mask) | (spreadBits(y & mask) << 1);
+            }
+
+            // Moves bit i of a 16-bit value to bit 2i
+            static uint32_t spreadBits(uint32_t v) {
+                v = (v | (v << 8)) & 0x00FF00FFu;
+                v = (v | (v << 4)) & 0x0F0F0F0Fu;
+                v = (v | (v << 2)) & 0x33333333u;
+                v = (v | (v << 1)) & 0x55555555u;
+                return v;
+            }
+
+        private:
+            std::vector<uint32_t> texels;
+            int32_t levelOffset[MAX_LEVELS] = {};
+            int32_t levelWidth[MAX_LEVELS] = {};
+            int32_t levelHeight[MAX_LEVELS] = {};
+            int32_t levelShift[MAX_LEVELS] = {};
+            int levelCount = 0;
+    };
+
+    // Square texture of size x size texels with squares x squares checkers
+    void createCheckerTexture(Texture& texture, int size, int squares, uint32_t colorA, uint32_t colorB);
+}
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Engine3D {
+
+    // Fixed set of worker threads running indexed tasks. Every thread owns a queue of
+    // task indices; an idle thread steals from the back of the other queues, so uneven
+    // tasks (such as busy screen tiles) still keep every core occupied. Jobs started
+    // by different threads share the workers and run at the same time.
+    class ThreadPool {
+        public:
+            // threadCount includes the calling thread; 0 uses every hardware thread
+            explicit ThreadPool(unsigned threadCount = 0);
+            ~ThreadPool();
+
+            ThreadPool(const ThreadPool&) = delete;
+            ThreadPool& operator=(const ThreadPool&) = delete;
+
+            unsigned getThreadCount() const { return (unsigned)queues.size(); }
+
+            // Run task(0) .. task(count - 1) across the pool and return once all have
+            // finished. The calling thread takes part in its own job only. Any number
+            // of threads may call this at once; must not be called from a task.
+            void parallelFor(size_t count, const std::function<void(size_t)>& task);
+
+        private:
+            struct Job {
+                const std::function<void(size_t)>* task;
+                std::atomic<size_t> remaining;
+            };
+
+            struct WorkItem {
+                Job* job;
+                size_t index;
+            };
+
+            struct WorkQueue {
+                std::mutex mutex;
+                std::deque<WorkItem> items;
+            };
+
+            void workerLoop(unsigned queueIndex);
+
+            // Run one item, of any job or only of the given one
+            bool runOne(unsigned queueIndex, const Job* only);
+
+            std::vector<std::thread> workers;
+            std::vector<std::unique_ptr<WorkQueue>> queues;
+
+            std::mutex stateMutex;
+            std::condition_variable wakeWorkers;
+            std::condition_variable jobDone;
+            unsigned long long generation;
+            bool stopping;
+    };
+}
+
+#endif
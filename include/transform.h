@@ -0,0 +1,43 @@
+#ifndef TRANSFORM_H
+#define TRANSFORM_H
+
+#include <cstddef>
+#include "engine.h"
+
+namespace Engine3D {
+
+    // Instruction sets the batch transforms can run on, detected once at runtime
+    enum class SimdLevel {
+        Scalar,
+        SSE,
+        AVX2,
+        AVX512
+    };
+
+    // Highest level the CPU supports
+    SimdLevel detectSimdLevel();
+    const char* simdLevelName(SimdLevel level);
+
+    // Kernel used by the batch transforms. Defaults to detectSimdLevel() capped at
+    // AVX2, so AVX-512 has to be asked for; requests above what the CPU supports are
+    // clamped, which lets benchmarks compare levels.
+    void setSimdLevel(SimdLevel level);
+    SimdLevel getSimdLevel();
+
+    // Homogeneous transform of count points (x, y, z, 1) by m into clip space,
+    // without the divide by w. Every level gives bit-identical results.
+    void transformPoints(const matrix4x4& m,
+                         const float* x, const float* y, const float* z,
+                         float* outX, float* outY, float* outZ, float* outW,
+                         size_t count);
+
+    // Same as calling m.multiplyVector on every point, including the divide by w
+    void transformPointsProjected(const matrix4x4& m,
+                                  const float* x, const float* y, const float* z,
+                                  float* outX, float* outY, float* outZ,
+                                  size_t count);
+
+    void transformPointsProjected(const matrix4x4& m, const VertexStream& in, VertexStream& out);
+}
+
+#endif
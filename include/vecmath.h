@@ -0,0 +1,142 @@
+#ifndef VECMATH_H
+#define VECMATH_H
+
+#include <cmath>
+#include <cstddef>
+#include "engine.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define ENGINE_VECMATH_SSE 1
+#include <emmintrin.h>
+#endif
+
+namespace Engine3D {
+
+    // 16-byte aligned counterparts of vec3d and matrix4x4 whose operators work on
+    // whole SSE registers. Conventions are the same: row vectors, v * (a * b)
+    // applies a first. vec4 * mat4 adds its terms in the order matrix4x4 does and
+    // gives bit-identical results; normalize uses a refined reciprocal square root
+    // and may differ in the last bit. Matrices are concatenated and cross products
+    // taken with matrix4x4 and vec3d, which math_bench measured as fast or faster.
+    struct alignas(16) vec4 {
+        float x, y, z, w;
+
+        vec4() : x(0), y(0), z(0), w(0) {}
+        vec4(float x_, float y_, float z_, float w_) : x(x_), y(y_), z(z_), w(w_) {}
+        vec4(const vec3d& v, float w_) : x(v.x), y(v.y), z(v.z), w(w_) {}
+
+        vec3d xyz() const { return vec3d(x, y, z); }
+    };
+
+    struct alignas(16) mat4 {
+        vec4 rows[4];
+
+        mat4() {}
+        explicit mat4(const matrix4x4& m) {
+            for (int i = 0; i < 4; i++) {
+                rows[i] = vec4(m.m[i][0], m.m[i][1], m.m[i][2], m.m[i][3]);
+            }
+        }
+
+        matrix4x4 toMatrix() const {
+            matrix4x4 m;
+            for (int i = 0; i < 4; i++) {
+                m.m[i][0] = rows[i].x; m.m[i][1] = rows[i].y; m.m[i][2] = rows[i].z; m.m[i][3] = rows[i].w;
+            }
+            return m;
+        }
+    };
+
+#ifdef ENGINE_VECMATH_SSE
+    // Lane by lane rather than _mm_load_ps, so a vec4 just built from scalars goes
+    // straight into a register instead of through a stalled store to the stack
+    inline __m128 load(const vec4& v) { return _mm_set_ps(v.w, v.z, v.y, v.x); }
+
+    inline vec4 store(__m128 r) {
+        vec4 v;
+        _mm_store_ps(&v.x, r);
+        return v;
+    }
+
+    // Sum of a row of m weighted by each lane of v
+    inline __m128 rowCombination(__m128 v, const mat4& m) {
+        __m128 sum = _mm_mul_ps(_mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 0, 0, 0)), load(m.rows[0]));
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1)), load(m.rows[1])));
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 2, 2)), load(m.rows[2])));
+        return _mm_add_ps(sum, _mm_mul_ps(_mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3)), load(m.rows[3])));
+    }
+
+    // x * x + y * y + z * z in every lane
+    inline __m128 dot3Splat(__m128 a, __m128 b) {
+        __m128 p = _mm_mul_ps(a, b);
+        __m128 sum = _mm_add_ps(_mm_shuffle_ps(p, p, _MM_SHUFFLE(0, 0, 0, 0)), _mm_shuffle_ps(p, p, _MM_SHUFFLE(1, 1, 1, 1)));
+        return _mm_add_ps(sum, _mm_shuffle_ps(p, p, _MM_SHUFFLE(2, 2, 2, 2)));
+    }
+#endif
+
+    inline vec4 operator +(const vec4& a, const vec4& b) {
+#ifdef ENGINE_VECMATH_SSE
+        return store(_mm_add_ps(load(a), load(b)));
+#else
+        return vec4(a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w);
+#endif
+    }
+
+    inline vec4 operator -(const vec4& a, const vec4& b) {
+#ifdef ENGINE_VECMATH_SSE
+        return store(_mm_sub_ps(load(a), load(b)));
+#else
+        return vec4(a.x - b.x, a.y - b.y, a.z - b.z, a.w - b.w);
+#endif
+    }
+
+    inline vec4 operator *(const vec4& a, float s) {
+#ifdef ENGINE_VECMATH_SSE
+        return store(_mm_mul_ps(load(a), _mm_set1_ps(s)));
+#else
+        return vec4(a.x * s, a.y * s, a.z * s, a.w * s);
+#endif
+    }
+
+    // Row vector times matrix
+    inline vec4 operator *(const vec4& v, const mat4& m) {
+#ifdef ENGINE_VECMATH_SSE
+        return store(rowCombination(load(v), m));
+#else
+        const vec4* r = m.rows;
+        return vec4(v.x * r[0].x + v.y * r[1].x + v.z * r[2].x + v.w * r[3].x,
+                    v.x * r[0].y + v.y * r[1].y + v.z * r[2].y + v.w * r[3].y,
+                    v.x * r[0].z + v.y * r[1].z + v.z * r[2].z + v.w * r[3].z,
+                    v.x * r[0].w + v.y * r[1].w + v.z * r[2].w + v.w * r[3].w);
+#endif
+    }
+
+    // Of the x, y and z parts
+    inline float dot3(const vec4& a, const vec4& b) {
+        return a.x * b.x + a.y * b.y + a.z * b.z;
+    }
+
+    // Scaled so x, y and z have unit length, with w scaled along; zero stays zero
+    inline vec4 normalize3(const vec4& v) {
+#ifdef ENGINE_VECMATH_SSE
+        // Reciprocal square root estimate refined by one Newton-Raphson step
+        __m128 r = load(v);
+        __m128 lengthSquared = dot3Splat(r, r);
+        __m128 estimate = _mm_rsqrt_ps(lengthSquared);
+        __m128 refined = _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(0.5f), estimate),
+                                    _mm_sub_ps(_mm_set1_ps(3.0f), _mm_mul_ps(lengthSquared, _mm_mul_ps(estimate, estimate))));
+        __m128 nonzero = _mm_cmpgt_ps(lengthSquared, _mm_setzero_ps());
+        return store(_mm_and_ps(_mm_mul_ps(r, refined), nonzero));
+#else
+        float lengthSquared = dot3(v, v);
+        return lengthSquared > 0.0f ? v * (1.0f / std::sqrt(lengthSquared)) : vec4();
+#endif
+    }
+
+    // Rotate directions (w = 0) by m and normalize them, in place: face and vertex
+    // normals carried into the world by a normal matrix. Four at a time with SSE,
+    // bit-identical to normalize3(v * m) one by one.
+    void transformNormals(const mat4& m, vec4* normals, size_t count);
+}
+
+#endif
@@ -0,0 +1,274 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include "../include/engine.h"
+#include "../include/bvh.h"
+#include "../include/camera.h"
+#include "../include/imagewriter.h"
+#include "../include/scene.h"
+#include "../include/texture.h"
+#include "../graphics/renderer.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+using namespace Engine3D;
+using namespace std;
+
+// Offline turntable renderer: draws every OBJ file from a list with no window and
+// writes its frames as PNG or PPM images, keeping all cores busy.
+//
+// Usage: batch_render [options] file.obj...
+//   --list file        read more OBJ paths from a file, one per line
+//   --output dir       where images go (default .), named <name>_<frame>.<format>
+//   --format png|ppm   (default png)
+//   --frames N         frames per asset (default 36)
+//   --size WxH         (default 512x512)
+//   --orbit degrees    turntable rotation over all frames (default 360)
+//   --elevation deg    camera height above the horizon (default 20)
+//   --distance d       camera distance in bounding radii (default 2.5)
+//   --fov degrees      vertical field of view (default 45)
+//   --y-down           the OBJ files already use the engine's y-down convention
+//   --cache            use and write binary mesh cache sidecars next to the OBJs
+//   --texture file     PPM texture for the assets that have texture coordinates
+//   --threads N        worker threads, 0 for all cores (default)
+
+namespace {
+    struct Options {
+        vector<string> files;
+        string outputDir = ".";
+        string format = "png";
+        int frames = 36;
+        int width = 512, height = 512;
+        float orbit = 360.0f;
+        float elevation = 20.0f;
+        float distance = 2.5f;
+        float fov = 45.0f;
+        bool yUp = true;
+        bool useCache = false;
+        string texturePath;
+        shared_ptr<const Texture> texture;  // loaded from texturePath
+        unsigned threads = 0;
+    };
+
+    // A run of frames of one asset, rendered by one worker
+    struct Job {
+        size_t asset;
+        int firstFrame, endFrame;
+    };
+
+    string baseName(const string& path) {
+        size_t slash = path.find_last_of("/\\");
+        string name = slash == string::npos ? path : path.substr(slash + 1);
+        size_t dot = name.find_last_of('.');
+        return dot == string::npos ? name : name.substr(0, dot);
+    }
+
+    // Moves the bounds' center to the origin and scales them to a unit radius. OBJ
+    // files are y-up, so by default they are also turned upside down around x,
+    // which keeps the winding (a mirror would turn every face around).
+    matrix4x4 normalizeModel(const AABB& bounds, bool yUp) {
+        vec3d center = bounds.center();
+        vec3d extent = bounds.max - bounds.min;
+        float radius = 0.5f * sqrtf(extent.x * extent.x + extent.y * extent.y + extent.z * extent.z);
+        float scale = radius > 0.0f ? 1.0f / radius : 1.0f;
+
+        matrix4x4 model;
+        model.m[0][0] = scale;
+        model.m[1][1] = scale;
+        model.m[2][2] = scale;
+        model.m[3][0] = -center.x * scale;
+        model.m[3][1] = -center.y * scale;
+        model.m[3][2] = -center.z * scale;
+        model.m[3][3] = 1.0f;
+
+        if (yUp) {
+            matrix4x4 flip;
+            createRotationMatrixX(flip, (float)M_PI);
+            model = model * flip;
+        }
+        return model;
+    }
+
+    bool renderJob(Renderer& renderer, const Job& job, const Options& options) {
+        const string& filename = options.files[job.asset];
+        // Parsed on this worker's thread alone, since every core already has a worker
+        mesh m;
+        if (!m.loadFromObjectFile(filename, options.useCache)) {
+            return false;
+        }
+        m.computeFaceNormals();
+        matrix4x4 normalize = normalizeModel(computeBounds(m), options.yUp);
+        m.texture = options.texture;
+
+        // The camera stays put and the model turns around the vertical axis
+        Camera camera((float)options.width, (float)options.height);
+        float elevation = options.elevation * (float)M_PI / 180.0f;
+        camera.position = vec3d(0.0f, -sinf(elevation) * options.distance, -cosf(elevation) * options.distance);
+        camera.lookAt(vec3d(0.0f, 0.0f, 0.0f));
+        camera.fov = options.fov;
+        camera.zNear = options.distance * 0.01f;
+        camera.zFar = options.distance * 10.0f;
+
+        string stem = options.outputDir + "/" + baseName(filename) + "_";
+        for (int frame = job.firstFrame; frame < job.endFrame; frame++) {
+            matrix4x4 spin;
+            createRotationMatrixY(spin, options.orbit * (float)M_PI / 180.0f * frame / options.frames);
+
+            renderer.clear();
+            renderer.drawMesh(m, normalize * spin, camera);
+            renderer.present();
+
+            char number[16];
+            snprintf(number, sizeof(number), "%04d.", frame);
+            const FrameBuffer& frameBuffer = renderer.getFrameBuffer();
+            if (!writeImage(stem + number + options.format, frameBuffer.color.data(), frameBuffer.width, frameBuffer.height)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool parseOptions(int argc, char** argv, Options& options) {
+        for (int i = 1; i < argc; i++) {
+            string arg = argv[i];
+            bool hasValue = i + 1 < argc;
+            if (arg == "--list" && hasValue) {
+                ifstream list(argv[++i]);
+                if (!list.is_open()) {
+                    cerr << "could not open " << argv[i] << endl;
+                    return false;
+                }
+                string line;
+                while (getline(list, line)) {
+                    if (!line.empty()) {
+                        options.files.push_back(line);
+                    }
+                }
+            } else if (arg == "--output" && hasValue) {
+                options.outputDir = argv[++i];
+            } else if (arg == "--format" && hasValue) {
+                options.format = argv[++i];
+                if (options.format != "png" && options.format != "ppm") {
+                    return false;
+                }
+            } else if (arg == "--frames" && hasValue) {
+                options.frames = max(1, atoi(argv[++i]));
+            } else if (arg == "--size" && hasValue) {
+                if (sscanf(argv[++i], "%dx%d", &options.width, &options.height) != 2 ||
+                    options.width <= 0 || options.height <= 0) {
+                    return false;
+                }
+            } else if (arg == "--orbit" && hasValue) {
+                options.orbit = (float)atof(argv[++i]);
+            } else if (arg == "--elevation" && hasValue) {
+                options.elevation = (float)atof(argv[++i]);
+            } else if (arg == "--distance" && hasValue) {
+                options.distance = (float)atof(argv[++i]);
+            } else if (arg == "--fov" && hasValue) {
+                options.fov = (float)atof(argv[++i]);
+            } else if (arg == "--y-down") {
+                options.yUp = false;
+            } else if (arg == "--cache") {
+                options.useCache = true;
+            } else if (arg == "--texture" && hasValue) {
+                options.texturePath = argv[++i];
+            } else if (arg == "--threads" && hasValue) {
+                options.threads = (unsigned)atoi(argv[++i]);
+            } else if (arg.size() > 2 && arg.compare(0, 2, "--") == 0) {
+                return false;
+            } else {
+                options.files.push_back(arg);
+            }
+        }
+        return !options.files.empty();
+    }
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        cerr << "usage: batch_render [--list file] [--output dir] [--format png|ppm] [--frames N] [--size WxH]\n"
+                "                    [--orbit deg] [--elevation deg] [--distance d] [--fov deg] [--y-down]\n"
+                "                    [--cache] [--texture file.ppm] [--threads N] file.obj..." << endl;
+        return 1;
+    }
+
+    if (!options.texturePath.empty()) {
+        shared_ptr<Texture> texture = make_shared<Texture>();
+        if (!texture->loadFromFile(options.texturePath)) {
+            cerr << "could not load texture " << options.texturePath << endl;
+            return 1;
+        }
+        options.texture = texture;
+    }
+
+    unsigned threads = options.threads ? options.threads : max(1u, thread::hardware_concurrency());
+
+    // Every worker owns a single-threaded renderer. With fewer assets than workers
+    // the frames of each asset are split into runs, so a short list still uses
+    // every core; each run loads its own copy of the mesh.
+    size_t splits = max<size_t>(1, (threads + options.files.size() - 1) / options.files.size());
+    splits = min<size_t>(splits, (size_t)options.frames);
+    vector<Job> jobs;
+    for (size_t asset = 0; asset < options.files.size(); asset++) {
+        for (size_t s = 0; s < splits; s++) {
+            int first = (int)(options.frames * s / splits);
+            int end = (int)(options.frames * (s + 1) / splits);
+            jobs.push_back(Job{ asset, first, end });
+        }
+    }
+
+    atomic<size_t> nextJob(0);
+    atomic<size_t> framesWritten(0);
+    vector<uint8_t> failed(options.files.size(), 0);
+    mutex outputMutex;
+
+    auto worker = [&]() {
+        Renderer renderer(options.width, options.height, true);
+        renderer.init();
+        renderer.setThreadCount(1);
+        for (size_t j = nextJob++; j < jobs.size(); j = nextJob++) {
+            const Job& job = jobs[j];
+            if (renderJob(renderer, job, options)) {
+                framesWritten += job.endFrame - job.firstFrame;
+            } else {
+                lock_guard<mutex> lock(outputMutex);
+                if (!failed[job.asset]) {
+                    cerr << "failed to render " << options.files[job.asset] << endl;
+                }
+                failed[job.asset] = 1;
+            }
+        }
+    };
+
+    auto start = chrono::steady_clock::now();
+    size_t workerCount = min<size_t>(threads, jobs.size());
+    vector<thread> workers;
+    for (size_t w = 1; w < workerCount; w++) {
+        workers.emplace_back(worker);
+    }
+    worker();
+    for (thread& t : workers) {
+        t.join();
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    size_t failures = count(failed.begin(), failed.end(), 1);
+    printf("%zu frames of %zu assets in %.2f s: %.1f frames/s on %zu threads",
+           framesWritten.load(), options.files.size() - failures, seconds,
+           framesWritten.load() / max(seconds, 1e-9), workerCount);
+    if (failures) {
+        printf(", %zu assets failed", failures);
+    }
+    printf("\n");
+    return failures ? 1 : 0;
+}
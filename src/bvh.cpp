@@ -0,0 +1,328 @@
+#include "../include/bvh.h"
+#include <numeric>
+
+namespace Engine3D {
+
+    namespace {
+        // Leaves stop splitting at this size, and are forced to split above the larger one
+        const uint32_t MIN_LEAF = 4;
+        const uint32_t MAX_LEAF = 16;
+
+        // Centroid bins per axis for the SAH sweep
+        const int SAH_BINS = 16;
+
+        AABB triangleBounds(const mesh& m, uint32_t t) {
+            AABB box;
+            box.expand(m.vertices.get(m.indices[t * 3]));
+            box.expand(m.vertices.get(m.indices[t * 3 + 1]));
+            box.expand(m.vertices.get(m.indices[t * 3 + 2]));
+            return box;
+        }
+
+        float axisOf(const vec3d& v, int axis) {
+            return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+        }
+
+        // Slab test, returns the entry distance or INFINITY on a miss
+        float intersectBox(const AABB& box, const Ray& ray, const vec3d& inverseDir, float maxT) {
+            float t0x = (box.min.x - ray.origin.x) * inverseDir.x, t1x = (box.max.x - ray.origin.x) * inverseDir.x;
+            float t0y = (box.min.y - ray.origin.y) * inverseDir.y, t1y = (box.max.y - ray.origin.y) * inverseDir.y;
+            float t0z = (box.min.z - ray.origin.z) * inverseDir.z, t1z = (box.max.z - ray.origin.z) * inverseDir.z;
+            float tNear = std::max({ std::min(t0x, t1x), std::min(t0y, t1y), std::min(t0z, t1z), 0.0f });
+            float tFar = std::min({ std::max(t0x, t1x), std::max(t0y, t1y), std::max(t0z, t1z), maxT });
+            return tNear <= tFar ? tNear : INFINITY;
+        }
+
+        // Moller-Trumbore, both faces count
+        bool intersectTriangle(const triangle& tri, const Ray& ray, float& t, float& u, float& v) {
+            vec3d edge1 = tri.points[1] - tri.points[0];
+            vec3d edge2 = tri.points[2] - tri.points[0];
+            vec3d p = ray.direction.cross(edge2);
+            float det = edge1.dot(p);
+            if (std::fabs(det) < 1e-12f) return false;
+
+            float inverseDet = 1.0f / det;
+            vec3d s = ray.origin - tri.points[0];
+            u = s.dot(p) * inverseDet;
+            if (u < 0.0f || u > 1.0f) return false;
+
+            vec3d q = s.cross(edge1);
+            v = ray.direction.dot(q) * inverseDet;
+            if (v < 0.0f || u + v > 1.0f) return false;
+
+            t = edge2.dot(q) * inverseDet;
+            return t >= 0.0f;
+        }
+    }
+
+    Frustum Frustum::fromMatrix(const matrix4x4& m) {
+        // Clip component j of a row vector p is dot((p, 1), column j)
+        auto column = [&](int j) {
+            Plane plane;
+            plane.normal = vec3d(m.m[0][j], m.m[1][j], m.m[2][j]);
+            plane.d = m.m[3][j];
+            return plane;
+        };
+        auto add = [](const Plane& a, const Plane& b, float sign) {
+            Plane plane;
+            plane.normal = vec3d(a.normal.x + sign * b.normal.x, a.normal.y + sign * b.normal.y, a.normal.z + sign * b.normal.z);
+            plane.d = a.d + sign * b.d;
+            return plane;
+        };
+
+        Plane x = column(0), y = column(1), z = column(2), w = column(3);
+        Frustum frustum;
+        frustum.planes[0] = add(w, x, 1.0f);   // left
+        frustum.planes[1] = add(w, x, -1.0f);  // right
+        frustum.planes[2] = add(w, y, 1.0f);   // bottom
+        frustum.planes[3] = add(w, y, -1.0f);  // top
+        frustum.planes[4] = z;                 // near
+        frustum.planes[5] = add(w, z, -1.0f);  // far
+        return frustum;
+    }
+
+    Frustum::Result Frustum::classify(const AABB& box) const {
+        Result result = Inside;
+        for (const Plane& plane : planes) {
+            // Corners furthest along and against the plane normal
+            vec3d positive(plane.normal.x >= 0.0f ? box.max.x : box.min.x,
+                           plane.normal.y >= 0.0f ? box.max.y : box.min.y,
+                           plane.normal.z >= 0.0f ? box.max.z : box.min.z);
+            vec3d negative(plane.normal.x >= 0.0f ? box.min.x : box.max.x,
+                           plane.normal.y >= 0.0f ? box.min.y : box.max.y,
+                           plane.normal.z >= 0.0f ? box.min.z : box.max.z);
+
+            if (plane.distance(positive) < 0.0f) {
+                return Outside;
+            }
+            if (plane.distance(negative) < 0.0f) {
+                result = Intersecting;
+            }
+        }
+        return result;
+    }
+
+    void BVH::build(const mesh& m) {
+        uint32_t count = (uint32_t)m.triangleCount();
+        nodes.clear();
+        triangleOrder.resize(count);
+        std::iota(triangleOrder.begin(), triangleOrder.end(), 0u);
+        if (count == 0) {
+            return;
+        }
+
+        std::vector<AABB> bounds(count);
+        std::vector<vec3d> centroids(count);
+        for (uint32_t t = 0; t < count; t++) {
+            bounds[t] = triangleBounds(m, t);
+            centroids[t] = bounds[t].center();
+        }
+
+        nodes.reserve(2 * (size_t)count / MIN_LEAF + 1);
+        nodes.push_back(Node{ AABB(), 0, count, 0 });
+
+        std::vector<uint32_t> stack(1, 0);
+        while (!stack.empty()) {
+            uint32_t index = stack.back();
+            stack.pop_back();
+
+            uint32_t begin = nodes[index].begin;
+            uint32_t size = nodes[index].count;
+            uint32_t end = begin + size;
+
+            AABB nodeBounds, centroidBounds;
+            for (uint32_t i = begin; i < end; i++) {
+                nodeBounds.expand(bounds[triangleOrder[i]]);
+                centroidBounds.expand(centroids[triangleOrder[i]]);
+            }
+            nodes[index].bounds = nodeBounds;
+
+            if (size <= MIN_LEAF) {
+                continue;
+            }
+
+            // Binned SAH: sweep the bin boundaries of every axis for the cheapest split
+            int bestAxis = -1, bestSplit = 0;
+            float bestCost = INFINITY;
+            for (int axis = 0; axis < 3; axis++) {
+                float lo = axisOf(centroidBounds.min, axis);
+                float extent = axisOf(centroidBounds.max, axis) - lo;
+                if (extent <= 0.0f) continue;
+
+                uint32_t binCount[SAH_BINS] = {};
+                AABB binBounds[SAH_BINS];
+                float scale = SAH_BINS / extent;
+                for (uint32_t i = begin; i < end; i++) {
+                    uint32_t t = triangleOrder[i];
+                    int bin = std::min(SAH_BINS - 1, (int)((axisOf(centroids[t], axis) - lo) * scale));
+                    binCount[bin]++;
+                    binBounds[bin].expand(bounds[t]);
+                }
+
+                float rightCost[SAH_BINS];
+                AABB accumulated;
+                uint32_t accumulatedCount = 0;
+                for (int b = SAH_BINS - 1; b > 0; b--) {
+                    accumulated.expand(binBounds[b]);
+                    accumulatedCount += binCount[b];
+                    rightCost[b] = accumulated.surfaceArea() * accumulatedCount;
+                }
+
+                accumulated = AABB();
+                accumulatedCount = 0;
+                for (int b = 0; b < SAH_BINS - 1; b++) {
+                    accumulated.expand(binBounds[b]);
+                    accumulatedCount += binCount[b];
+                    float cost = accumulated.surfaceArea() * accumulatedCount + rightCost[b + 1];
+                    if (accumulatedCount > 0 && accumulatedCount < size && cost < bestCost) {
+                        bestCost = cost;
+                        bestAxis = axis;
+                        bestSplit = b + 1;
+                    }
+                }
+            }
+
+            // Keep the leaf when splitting does not pay off and it is small enough
+            float leafCost = nodeBounds.surfaceArea() * size;
+            if (size <= MAX_LEAF && (bestAxis < 0 || bestCost >= leafCost)) {
+                continue;
+            }
+
+            uint32_t middle;
+            if (bestAxis >= 0) {
+                float lo = axisOf(centroidBounds.min, bestAxis);
+                float scale = SAH_BINS / (axisOf(centroidBounds.max, bestAxis) - lo);
+                middle = (uint32_t)(std::partition(triangleOrder.begin() + begin, triangleOrder.begin() + end,
+                    [&](uint32_t t) {
+                        return std::min(SAH_BINS - 1, (int)((axisOf(centroids[t], bestAxis) - lo) * scale)) < bestSplit;
+                    }) - triangleOrder.begin());
+            } else {
+                // Every centroid coincides, split the range in half
+                middle = begin + size / 2;
+            }
+
+            uint32_t left = (uint32_t)nodes.size();
+            nodes[index].left = left;
+            nodes.push_back(Node{ AABB(), begin, middle - begin, 0 });
+            nodes.push_back(Node{ AABB(), middle, end - middle, 0 });
+            stack.push_back(left);
+            stack.push_back(left + 1);
+        }
+    }
+
+    void BVH::refit(const mesh& m) {
+        // Children always come after their parent, so a reverse sweep is bottom-up
+        for (size_t i = nodes.size(); i-- > 0;) {
+            Node& node = nodes[i];
+            AABB box;
+            if (node.left == 0) {
+                for (uint32_t j = node.begin; j < node.begin + node.count; j++) {
+                    box.expand(triangleBounds(m, triangleOrder[j]));
+                }
+            } else {
+                box.expand(nodes[node.left].bounds);
+                box.expand(nodes[node.left + 1].bounds);
+            }
+            node.bounds = box;
+        }
+    }
+
+    void BVH::cullFrustum(const Frustum& frustum, std::vector<Range>& visible) const {
+        if (nodes.empty()) {
+            return;
+        }
+
+        auto emit = [&](const Node& node) {
+            // Neighbouring subtrees are contiguous in triangleOrder, merge them
+            if (!visible.empty() && visible.back().begin + visible.back().count == node.begin) {
+                visible.back().count += node.count;
+            } else {
+                visible.push_back(Range{ node.begin, node.count });
+            }
+        };
+
+        uint32_t stack[64];
+        int top = 0;
+        stack[top++] = 0;
+        while (top > 0) {
+            const Node& node = nodes[stack[--top]];
+            Frustum::Result result = frustum.classify(node.bounds);
+            if (result == Frustum::Outside) {
+                continue;
+            }
+            if (result == Frustum::Inside || node.left == 0 || top + 2 > 64) {
+                emit(node);
+                continue;
+            }
+
+            // Right first so the left subtree is emitted first and ranges stay ordered
+            stack[top++] = node.left + 1;
+            stack[top++] = node.left;
+        }
+    }
+
+    bool BVH::intersectRay(const mesh& m, const Ray& ray, RayHit& hit) const {
+        if (nodes.empty()) {
+            return false;
+        }
+
+        vec3d inverseDir(1.0f / ray.direction.x, 1.0f / ray.direction.y, 1.0f / ray.direction.z);
+        hit.t = INFINITY;
+        bool found = false;
+
+        uint32_t stack[64];
+        int top = 0;
+        if (intersectBox(nodes[0].bounds, ray, inverseDir, hit.t) != INFINITY) {
+            stack[top++] = 0;
+        }
+
+        while (top > 0) {
+            const Node& node = nodes[stack[--top]];
+            if (intersectBox(node.bounds, ray, inverseDir, hit.t) == INFINITY) {
+                continue;
+            }
+
+            if (node.left == 0 || top + 2 > 64) {
+                for (uint32_t i = node.begin; i < node.begin + node.count; i++) {
+                    float t, u, v;
+                    uint32_t tri = triangleOrder[i];
+                    if (intersectTriangle(m.getTriangle(tri), ray, t, u, v) && t < hit.t) {
+                        hit.t = t;
+                        hit.triangle = tri;
+                        hit.u = u;
+                        hit.v = v;
+                        found = true;
+                    }
+                }
+                continue;
+            }
+
+            // Visit the nearer child first so the far one is likely pruned
+            float nearLeft = intersectBox(nodes[node.left].bounds, ray, inverseDir, hit.t);
+            float nearRight = intersectBox(nodes[node.left + 1].bounds, ray, inverseDir, hit.t);
+            uint32_t first = node.left, second = node.left + 1;
+            if (nearRight < nearLeft) {
+                std::swap(first, second);
+                std::swap(nearLeft, nearRight);
+            }
+            if (nearRight != INFINITY) stack[top++] = second;
+            if (nearLeft != INFINITY) stack[top++] = first;
+        }
+        return found;
+    }
+
+    void mesh::buildBVH() {
+        if (!bvh) {
+            bvh = std::make_shared<BVH>();
+        }
+        bvh->build(*this);
+    }
+
+    void mesh::refitBVH() {
+        if (bvh && bvh->triangleCount() == triangleCount()) {
+            bvh->refit(*this);
+        } else {
+            buildBVH();
+        }
+    }
+}
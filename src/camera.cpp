@@ -0,0 +1,53 @@
+#include "../include/camera.h"
+#include <algorithm>
+#include <cmath>
+
+namespace Engine3D {
+
+    // Just short of 90 degrees, where the view direction and up vector would align
+    static const float MAX_PITCH = 1.55f;
+
+    static const vec3d WORLD_UP(0.0f, -1.0f, 0.0f);
+
+    vec3d Camera::forward() const {
+        return vec3d(sinf(yaw) * cosf(pitch), -sinf(pitch), cosf(yaw) * cosf(pitch));
+    }
+
+    vec3d Camera::right() const {
+        return forward().cross(WORLD_UP).normalize();
+    }
+
+    vec3d Camera::up() const {
+        return right().cross(forward());
+    }
+
+    void Camera::lookAt(const vec3d& target) {
+        vec3d direction = (target - position).normalize();
+        yaw = atan2f(direction.x, direction.z);
+        pitch = std::clamp(asinf(-direction.y), -MAX_PITCH, MAX_PITCH);
+    }
+
+    void Camera::move(float forwardAmount, float rightAmount, float upAmount) {
+        vec3d f = forward(), r = right(), u = up();
+        position = vec3d(position.x + f.x * forwardAmount + r.x * rightAmount + u.x * upAmount,
+                         position.y + f.y * forwardAmount + r.y * rightAmount + u.y * upAmount,
+                         position.z + f.z * forwardAmount + r.z * rightAmount + u.z * upAmount);
+    }
+
+    void Camera::rotate(float yawDelta, float pitchDelta) {
+        yaw += yawDelta;
+        pitch = std::clamp(pitch + pitchDelta, -MAX_PITCH, MAX_PITCH);
+    }
+
+    matrix4x4 Camera::getViewMatrix() const {
+        matrix4x4 view;
+        createLookAtMatrix(view, position, position + forward(), WORLD_UP);
+        return view;
+    }
+
+    matrix4x4 Camera::getProjectionMatrix() const {
+        matrix4x4 projection;
+        createProjectionMatrix(projection, fov, aspectRatio, zNear, zFar);
+        return projection;
+    }
+}
@@ -1,7 +1,7 @@
 #include "../include/engine.h"
+#include "../include/radixsort.h"
+#include <algorithm>
 #include <cmath>
-#include <fstream>
-#include <sstream>
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
@@ -9,12 +9,13 @@
 
 namespace Engine3D {
     void populateMatrix(matrix4x4& mat, float width, float height, float z_length) {
-        float zNear = 0.1f;
-        float zFar = z_length;
-        float fov = 90.0f;
-        float aspectRatio = height / width;
-        float fovRad = 1.0f / tanf((fov * 0.5f) * (M_PI / 180.0f));
+        createProjectionMatrix(mat, 90.0f, height / width, 0.1f, z_length);
+    }
+
+    void createProjectionMatrix(matrix4x4& mat, float fovDegrees, float aspectRatio, float zNear, float zFar) {
+        float fovRad = 1.0f / tanf((fovDegrees * 0.5f) * (M_PI / 180.0f));
 
+        mat = matrix4x4();
         mat.m[0][0] = aspectRatio * fovRad;
         mat.m[1][1] = fovRad;
         mat.m[2][2] = zFar / (zFar - zNear);
@@ -38,6 +39,21 @@ namespace Engine3D {
         mat.m[2][2] = cosf(angle);
     }
 
+    void createRotationMatrixY(matrix4x4& mat, float angle) {
+        // Initialize as identity matrix
+        for (int i = 0; i < 4; i++) {
+            for (int j = 0; j < 4; j++) {
+                mat.m[i][j] = (i == j) ? 1.0f : 0.0f;
+            }
+        }
+        
+        // Set rotation values
+        mat.m[0][0] = cosf(angle);
+        mat.m[0][2] = -sinf(angle);
+        mat.m[2][0] = sinf(angle);
+        mat.m[2][2] = cosf(angle);
+    }
+
     void createRotationMatrixZ(matrix4x4& mat, float angle) {
         // Initialize as identity matrix
         for (int i = 0; i < 4; i++) {
@@ -53,63 +69,36 @@ namespace Engine3D {
         mat.m[1][1] = cosf(angle);
     }
 
-    triangle rotateTriangle(const triangle& tri, const matrix4x4& rotX, const matrix4x4& rotZ) {
-        triangle rotated;
-        
-        // First rotate around Z axis, then X axis
-        for (int i = 0; i < 3; i++) {
-            vec3d rotatedZ = rotZ.multiplyVector(tri.points[i]);
-            rotated.points[i] = rotX.multiplyVector(rotatedZ);
+    void createTranslationMatrix(matrix4x4& mat, float x, float y, float z) {
+        // Initialize as identity matrix
+        for (int i = 0; i < 4; i++) {
+            for (int j = 0; j < 4; j++) {
+                mat.m[i][j] = (i == j) ? 1.0f : 0.0f;
+            }
         }
-        
-        return rotated;
-    }
 
-    bool mesh::loadFromObjectFile(const string& filename) {
-        ifstream file(filename);
-        if (!file.is_open()) {
-            return false;
-        }
+        // Row vectors carry the translation in the last row
+        mat.m[3][0] = x;
+        mat.m[3][1] = y;
+        mat.m[3][2] = z;
+    }
 
-        // Clear existing triangles
-        triangles.clear();
-        
-        // Local cache of vertices
-        vector<vec3d> vertices;
-
-        string line;
-        while (getline(file, line)) {
-            if (line.empty()) continue;
-            
-            istringstream ss(line);
-            string prefix;
-            ss >> prefix;
-
-            if (prefix == "v") {
-                // Vertex line: v x y z
-                vec3d vertex;
-                ss >> vertex.x >> vertex.y >> vertex.z;
-                vertices.push_back(vertex);
-            }
-            else if (prefix == "f") {
-                // Face line: f v1 v2 v3 (1-indexed)
-                int f[3];
-                ss >> f[0] >> f[1] >> f[2];
-                
-                // Convert to 0-indexed and create triangle
-                if (f[0] > 0 && f[1] > 0 && f[2] > 0 && 
-                    f[0] <= vertices.size() && f[1] <= vertices.size() && f[2] <= vertices.size()) {
-                    triangles.push_back(triangle(
-                        vertices[f[0] - 1], 
-                        vertices[f[1] - 1], 
-                        vertices[f[2] - 1]
-                    ));
-                }
-            }
-        }
+    void createLookAtMatrix(matrix4x4& mat, const vec3d& eye, const vec3d& target, const vec3d& up) {
+        // View space looks down +z with x to the right and y down the screen
+        vec3d zAxis = (target - eye).normalize();
+        vec3d xAxis = zAxis.cross(up).normalize();
+        vec3d yAxis = zAxis.cross(xAxis);
 
-        file.close();
-        return !triangles.empty();
+        // Rows of the inverse camera transform: rotate into the axes, then move the
+        // eye to the origin
+        mat = matrix4x4();
+        mat.m[0][0] = xAxis.x; mat.m[0][1] = yAxis.x; mat.m[0][2] = zAxis.x;
+        mat.m[1][0] = xAxis.y; mat.m[1][1] = yAxis.y; mat.m[1][2] = zAxis.y;
+        mat.m[2][0] = xAxis.z; mat.m[2][1] = yAxis.z; mat.m[2][2] = zAxis.z;
+        mat.m[3][0] = -xAxis.dot(eye);
+        mat.m[3][1] = -yAxis.dot(eye);
+        mat.m[3][2] = -zAxis.dot(eye);
+        mat.m[3][3] = 1.0f;
     }
 
     float calculateLighting(const vec3d& normal, const vec3d& lightDirection) {
@@ -119,4 +108,111 @@ namespace Engine3D {
         // Clamp to 0-1 range (no negative lighting)
         return max(0.0f, dp);
     }
+
+    void mesh::computeVertexNormals() {
+        size_t count = vertices.size();
+        std::vector<vec3d> sums(count);
+
+        // Read through a const view, so indices mapped from a mesh cache stay borrowed
+        const GeometryArray<uint32_t>& triangleIndices = indices;
+
+        // The unnormalized cross product is twice the face area along its normal,
+        // so summing it weights every face by its area
+        for (size_t t = 0; t < triangleCount(); t++) {
+            triangle tri = getTriangle(t);
+            vec3d n = (tri.points[1] - tri.points[0]).cross(tri.points[2] - tri.points[0]);
+            for (int i = 0; i < 3; i++) {
+                vec3d& sum = sums[triangleIndices[t * 3 + i]];
+                sum = sum + n;
+            }
+        }
+
+        normals.resize(count);
+        for (size_t i = 0; i < count; i++) {
+            normals.set(i, sums[i].normalize());
+        }
+    }
+
+    void mesh::computeFaceNormals() {
+        faceNormals.resize(triangleCount());
+        for (size_t t = 0; t < triangleCount(); t++) {
+            triangle tri = getTriangle(t);
+            tri.calculateNormal();
+            faceNormals.set(t, tri.normal);
+        }
+    }
+
+    void mesh::computeEdges() {
+        // Every triangle side as (lower index, higher index), sorted by the higher
+        // index and then stably by the lower one, so duplicates end up adjacent
+        const GeometryArray<uint32_t>& triangleIndices = indices;
+        vector<uint64_t> items, scratch(indices.size());
+        items.reserve(indices.size());
+        for (size_t t = 0; t < triangleCount(); t++) {
+            for (int i = 0; i < 3; i++) {
+                uint32_t a = triangleIndices[t * 3 + i], b = triangleIndices[t * 3 + (i + 1) % 3];
+                if (a != b) {
+                    items.push_back(makeSortItem(std::max(a, b), std::min(a, b)));
+                }
+            }
+        }
+        uint64_t* sorted = radixSortByKey(items.data(), scratch.data(), items.size());
+        for (size_t i = 0; i < items.size(); i++) {
+            sorted[i] = makeSortItem(sortItemPayload(sorted[i]), (uint32_t)(sorted[i] >> 32));
+        }
+        sorted = radixSortByKey(sorted, sorted == items.data() ? scratch.data() : items.data(), items.size());
+
+        edges.clear();
+        for (size_t i = 0; i < items.size(); i++) {
+            if (i == 0 || sorted[i] != sorted[i - 1]) {
+                edges.push_back((uint32_t)(sorted[i] >> 32));
+                edges.push_back(sortItemPayload(sorted[i]));
+            }
+        }
+    }
+
+    void populateCube(mesh& m) {
+        m.vertices.clear();
+        m.normals.clear();
+        m.faceNormals.clear();
+        m.edges.clear();
+        m.lods.clear();
+        m.bvh.reset();
+        m.texCoords.clear();
+        m.indices.clear();
+
+        // Define the 8 vertices of a cube
+        m.vertices.push_back(vec3d(0.0f, 0.0f, 0.0f)); // 0: front bottom left
+        m.vertices.push_back(vec3d(0.0f, 0.0f, 1.0f)); // 1: back bottom right
+        m.vertices.push_back(vec3d(0.0f, 1.0f, 0.0f)); // 2: front top left
+        m.vertices.push_back(vec3d(0.0f, 1.0f, 1.0f)); // 3: back top left
+        m.vertices.push_back(vec3d(1.0f, 0.0f, 0.0f)); // 4: front bottom right
+        m.vertices.push_back(vec3d(1.0f, 0.0f, 1.0f)); // 5: back bottom right
+        m.vertices.push_back(vec3d(1.0f, 1.0f, 0.0f)); // 6: front top right
+        m.vertices.push_back(vec3d(1.0f, 1.0f, 1.0f)); // 7: back top right
+
+        // Front face
+        m.addTriangle(0, 2, 6);
+        m.addTriangle(0, 6, 4);
+
+        // Back face
+        m.addTriangle(5, 7, 3);
+        m.addTriangle(5, 3, 1);
+
+        // Left face
+        m.addTriangle(1, 3, 2);
+        m.addTriangle(1, 2, 0);
+
+        // Right face
+        m.addTriangle(4, 6, 7);
+        m.addTriangle(4, 7, 5);
+
+        // Top face
+        m.addTriangle(2, 3, 7);
+        m.addTriangle(2, 7, 6);
+
+        // Bottom face
+        m.addTriangle(5, 1, 0);
+        m.addTriangle(5, 0, 4);
+    }
 }
@@ -0,0 +1,72 @@
+#include "../include/framearena.h"
+#include <algorithm>
+#include <cstdint>
+
+namespace Engine3D {
+
+    FrameArena::FrameArena(size_t initialSize)
+        : allocations(0), heapAllocations(0) {
+        current.store(addBlock(initialSize));
+    }
+
+    FrameArena::Block* FrameArena::addBlock(size_t size) {
+        std::unique_ptr<Block> block = std::make_unique<Block>();
+        block->memory.reset(new char[size]);
+        block->size = size;
+        block->used.store(0);
+        blocks.push_back(std::move(block));
+        heapAllocations++;
+        return blocks.back().get();
+    }
+
+    void* FrameArena::allocate(size_t bytes, size_t alignment) {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+
+        // Reserve enough for the worst case padding, so the fast path is one atomic add
+        size_t reserved = bytes + alignment - 1;
+        for (;;) {
+            Block* block = current.load(std::memory_order_acquire);
+            size_t offset = block->used.fetch_add(reserved, std::memory_order_relaxed);
+            if (offset + reserved <= block->size) {
+                uintptr_t address = (uintptr_t)(block->memory.get() + offset);
+                address = (address + alignment - 1) & ~(uintptr_t)(alignment - 1);
+                return (void*)address;
+            }
+
+            // Out of space: the first thread to get here chains a bigger block
+            std::lock_guard<std::mutex> lock(growMutex);
+            if (current.load(std::memory_order_relaxed) == block) {
+                size_t size = std::max(block->size * 2, reserved);
+                current.store(addBlock(size), std::memory_order_release);
+            }
+        }
+    }
+
+    void FrameArena::reset() {
+        allocations.store(0, std::memory_order_relaxed);
+        heapAllocations = 0;
+
+        if (blocks.size() > 1) {
+            // Replace the chain with one block large enough for the whole frame
+            size_t total = 0;
+            for (const std::unique_ptr<Block>& block : blocks) {
+                total += block->size;
+            }
+            blocks.clear();
+            current.store(addBlock(total));
+        } else {
+            blocks[0]->used.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    FrameArena::Stats FrameArena::getStats() const {
+        Stats stats;
+        stats.allocations = allocations.load(std::memory_order_relaxed);
+        stats.heapAllocations = heapAllocations;
+        for (const std::unique_ptr<Block>& block : blocks) {
+            stats.bytesUsed += std::min(block->used.load(std::memory_order_relaxed), block->size);
+            stats.capacity += block->size;
+        }
+        return stats;
+    }
+}
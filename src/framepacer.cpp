@@ -0,0 +1,50 @@
+#include "../include/framepacer.h"
+#include <thread>
+
+namespace Engine3D {
+
+    namespace {
+        // Weight of the newest frame in the average work time
+        const double WORK_SMOOTHING = 0.1;
+
+        // Shares of the interval the average work time has to cross to fall behind
+        // and to catch up again, apart so the state does not flip every frame
+        const double BEHIND_SHARE = 0.95;
+        const double CAUGHT_UP_SHARE = 0.6;
+    }
+
+    FramePacer::FramePacer(double framesPerSecond) {
+        setTargetRate(framesPerSecond);
+        deadline = Clock::now();
+        workStart = deadline;
+        averageWork = 0.0;
+        behind = false;
+    }
+
+    void FramePacer::setTargetRate(double framesPerSecond) {
+        interval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / framesPerSecond));
+    }
+
+    void FramePacer::beginFrame() {
+        Clock::time_point now = Clock::now();
+        if (now > deadline + interval) {
+            deadline = now;
+        } else {
+            std::this_thread::sleep_until(deadline);
+        }
+        deadline += interval;
+        workStart = Clock::now();
+    }
+
+    void FramePacer::endFrame() {
+        double work = std::chrono::duration<double>(Clock::now() - workStart).count();
+        averageWork += (work - averageWork) * WORK_SMOOTHING;
+
+        double target = std::chrono::duration<double>(interval).count();
+        if (!behind && averageWork > target * BEHIND_SHARE) {
+            behind = true;
+        } else if (behind && averageWork < target * CAUGHT_UP_SHARE) {
+            behind = false;
+        }
+    }
+}
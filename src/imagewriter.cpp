@@ -0,0 +1,581 @@
+#include "../include/imagewriter.h"
+#include "../include/mappedfile.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace Engine3D {
+
+    namespace {
+        // Deflate with LZ77 matches over a 32 KB window and the fixed Huffman codes of
+        // RFC 1951, which needs no code tables in the stream. Rendered images have
+        // large flat areas, so this gets most of the way to zlib's default level.
+        const int WINDOW_SIZE = 32768;
+        const int MIN_MATCH = 3;
+        const int MAX_MATCH = 258;
+        const int HASH_BITS = 15;
+        const int MAX_CHAIN = 16;
+
+        // Largest side readPNG accepts
+        const uint32_t MAX_PNG_SIZE = 32768;
+
+        const uint16_t LENGTH_BASE[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                           35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+        const uint8_t LENGTH_EXTRA[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                           3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+        const uint16_t DISTANCE_BASE[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+                                             257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+                                             8193, 12289, 16385, 24577 };
+        const uint8_t DISTANCE_EXTRA[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+                                             7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+        // Deflate packs bits from the least significant end; Huffman codes are stored
+        // most significant bit first
+        class BitWriter {
+            public:
+                explicit BitWriter(std::vector<uint8_t>& out) : out(out), buffer(0), count(0) {}
+
+                void putBits(uint32_t value, int bits) {
+                    buffer |= value << count;
+                    count += bits;
+                    while (count >= 8) {
+                        out.push_back((uint8_t)buffer);
+                        buffer >>= 8;
+                        count -= 8;
+                    }
+                }
+
+                void putCode(uint32_t code, int bits) {
+                    uint32_t reversed = 0;
+                    for (int i = 0; i < bits; i++) {
+                        reversed = (reversed << 1) | ((code >> i) & 1);
+                    }
+                    putBits(reversed, bits);
+                }
+
+                void flush() {
+                    if (count > 0) {
+                        out.push_back((uint8_t)buffer);
+                    }
+                    buffer = 0;
+                    count = 0;
+                }
+
+            private:
+                std::vector<uint8_t>& out;
+                uint32_t buffer;
+                int count;
+        };
+
+        void putLiteral(BitWriter& bits, int symbol) {
+            if (symbol < 144) {
+                bits.putCode(0x30 + symbol, 8);
+            } else if (symbol < 256) {
+                bits.putCode(0x190 + symbol - 144, 9);
+            } else if (symbol < 280) {
+                bits.putCode(symbol - 256, 7);
+            } else {
+                bits.putCode(0xC0 + symbol - 280, 8);
+            }
+        }
+
+        void putMatch(BitWriter& bits, int length, int distance) {
+            int l = 28;
+            while (LENGTH_BASE[l] > length) l--;
+            putLiteral(bits, 257 + l);
+            bits.putBits(length - LENGTH_BASE[l], LENGTH_EXTRA[l]);
+
+            int d = 29;
+            while (DISTANCE_BASE[d] > distance) d--;
+            bits.putCode(d, 5);
+            bits.putBits(distance - DISTANCE_BASE[d], DISTANCE_EXTRA[d]);
+        }
+
+        // Deflate bits for decoding, from the least significant end. Reading past the
+        // end gives zeros and sets overrun().
+        class BitReader {
+            public:
+                BitReader(const uint8_t* data, size_t size) : data(data), size(size), position(0), buffer(0), count(0), past(false) {}
+
+                // Up to 16 bits
+                uint32_t getBits(int bits) {
+                    while (count < bits) {
+                        if (position < size) {
+                            buffer |= (uint32_t)data[position++] << count;
+                        } else {
+                            past = true;
+                        }
+                        count += 8;
+                    }
+                    uint32_t value = buffer & ((1u << bits) - 1);
+                    buffer >>= bits;
+                    count -= bits;
+                    return value;
+                }
+
+                uint32_t getCode(int bits) {
+                    uint32_t code = 0;
+                    for (int i = 0; i < bits; i++) {
+                        code = (code << 1) | getBits(1);
+                    }
+                    return code;
+                }
+
+                // Stored blocks start at the next byte
+                void alignToByte() {
+                    buffer >>= count & 7;
+                    count -= count & 7;
+                }
+
+                bool overrun() const { return past; }
+
+            private:
+                const uint8_t* data;
+                size_t size;
+                size_t position;
+                uint32_t buffer;
+                int count;
+                bool past;
+        };
+
+        // Symbol of the fixed literal/length code, the inverse of putLiteral
+        int getLiteral(BitReader& bits) {
+            uint32_t code = bits.getCode(7);
+            if (code < 0x18) {
+                return 256 + (int)code;
+            }
+            code = (code << 1) | bits.getBits(1);
+            if (code < 0xC0) {
+                return (int)code - 0x30;
+            }
+            if (code < 0xC8) {
+                return 280 + (int)code - 0xC0;
+            }
+            code = (code << 1) | bits.getBits(1);
+            return 144 + (int)code - 0x190;
+        }
+
+        uint32_t adler32(const uint8_t* data, size_t size) {
+            uint32_t a = 1, b = 0;
+            for (size_t k = 0; k < size; k++) {
+                a = (a + data[k]) % 65521;
+                b = (b + a) % 65521;
+            }
+            return (b << 16) | a;
+        }
+
+        uint32_t getBigEndian(const uint8_t* p) {
+            return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+        }
+
+        uint32_t hashAt(const uint8_t* p) {
+            uint32_t v = ((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 8) | p[2];
+            return (v * 2654435761u) >> (32 - HASH_BITS);
+        }
+
+        // zlib stream (RFC 1950) holding a single fixed-Huffman block
+        void compress(const uint8_t* data, size_t size, std::vector<uint8_t>& out) {
+            out.push_back(0x78);
+            out.push_back(0x01);
+
+            BitWriter bits(out);
+            bits.putBits(1, 1);  // final block
+            bits.putBits(1, 2);  // fixed Huffman codes
+
+            std::vector<int32_t> head((size_t)1 << HASH_BITS, -1);
+            std::vector<int32_t> previous(WINDOW_SIZE, -1);
+            auto insert = [&](size_t pos) {
+                uint32_t h = hashAt(data + pos);
+                previous[pos & (WINDOW_SIZE - 1)] = head[h];
+                head[h] = (int32_t)pos;
+            };
+
+            size_t i = 0;
+            while (i < size) {
+                int bestLength = 0, bestDistance = 0;
+                if (i + MIN_MATCH <= size) {
+                    int32_t candidate = head[hashAt(data + i)];
+                    int maxLength = (int)std::min<size_t>(MAX_MATCH, size - i);
+                    for (int chain = 0; chain < MAX_CHAIN && candidate >= 0 && i - candidate <= WINDOW_SIZE; chain++) {
+                        const uint8_t* a = data + candidate;
+                        const uint8_t* b = data + i;
+                        int length = 0;
+                        while (length < maxLength && a[length] == b[length]) length++;
+                        if (length > bestLength) {
+                            bestLength = length;
+                            bestDistance = (int)(i - candidate);
+                            if (length == maxLength) break;
+                        }
+
+                        // Slots are reused once the window wraps; only follow older positions
+                        int32_t next = previous[candidate & (WINDOW_SIZE - 1)];
+                        if (next >= candidate) break;
+                        candidate = next;
+                    }
+                    insert(i);
+                }
+
+                if (bestLength >= MIN_MATCH) {
+                    putMatch(bits, bestLength, bestDistance);
+                    for (size_t k = i + 1; k < i + bestLength && k + MIN_MATCH <= size; k++) {
+                        insert(k);
+                    }
+                    i += bestLength;
+                } else {
+                    putLiteral(bits, data[i]);
+                    i++;
+                }
+            }
+            putLiteral(bits, 256);  // end of block
+            bits.flush();
+
+            // Adler-32 of the uncompressed data, big-endian
+            uint32_t adler = adler32(data, size);
+            for (int shift = 24; shift >= 0; shift -= 8) {
+                out.push_back((uint8_t)(adler >> shift));
+            }
+        }
+
+        // zlib stream of stored and fixed-Huffman blocks holding at most limit bytes,
+        // with its checksum verified
+        bool decompress(const uint8_t* data, size_t size, size_t limit, std::vector<uint8_t>& out) {
+            if (size < 6 || (data[0] & 0x0F) != 8 || (data[1] & 0x20) || ((data[0] << 8) | data[1]) % 31 != 0) {
+                return false;
+            }
+
+            BitReader bits(data + 2, size - 6);
+            bool final = false;
+            while (!final) {
+                final = bits.getBits(1) != 0;
+                uint32_t type = bits.getBits(2);
+                if (type == 0) {
+                    bits.alignToByte();
+                    uint32_t length = bits.getBits(16);
+                    if ((bits.getBits(16) ^ 0xFFFFu) != length || out.size() + length > limit) {
+                        return false;
+                    }
+                    for (uint32_t k = 0; k < length; k++) {
+                        out.push_back((uint8_t)bits.getBits(8));
+                    }
+                } else if (type == 1) {
+                    while (true) {
+                        int symbol = getLiteral(bits);
+                        if (symbol < 256) {
+                            if (out.size() == limit) {
+                                return false;
+                            }
+                            out.push_back((uint8_t)symbol);
+                            continue;
+                        }
+                        if (symbol == 256 || bits.overrun()) {
+                            break;
+                        }
+                        if (symbol > 285) {
+                            return false;
+                        }
+                        int l = symbol - 257;
+                        size_t length = LENGTH_BASE[l] + bits.getBits(LENGTH_EXTRA[l]);
+                        uint32_t d = bits.getCode(5);
+                        if (d >= 30) {
+                            return false;
+                        }
+                        size_t distance = DISTANCE_BASE[d] + bits.getBits(DISTANCE_EXTRA[d]);
+                        if (distance > out.size() || out.size() + length > limit) {
+                            return false;
+                        }
+                        for (size_t k = 0; k < length; k++) {
+                            out.push_back(out[out.size() - distance]);
+                        }
+                    }
+                } else {
+                    // Dynamic Huffman codes, which compress never writes
+                    return false;
+                }
+                if (bits.overrun()) {
+                    return false;
+                }
+            }
+            return adler32(out.data(), out.size()) == getBigEndian(data + size - 4);
+        }
+
+        // The PNG predictor for the Paeth filter
+        int paeth(int a, int b, int c) {
+            int p = a + b - c;
+            int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+            if (pa <= pb && pa <= pc) {
+                return a;
+            }
+            return pb <= pc ? b : c;
+        }
+
+        // Next whitespace separated number of a PPM header, skipping # comments
+        bool readHeaderValue(const char*& p, const char* end, int& value) {
+            while (p < end && (std::isspace((unsigned char)*p) || *p == '#')) {
+                if (*p == '#') {
+                    while (p < end && *p != '\n') p++;
+                } else {
+                    p++;
+                }
+            }
+            if (p == end || !std::isdigit((unsigned char)*p)) {
+                return false;
+            }
+            value = 0;
+            while (p < end && std::isdigit((unsigned char)*p) && value < 1000000) {
+                value = value * 10 + (*p++ - '0');
+            }
+            return true;
+        }
+
+        struct CrcTable {
+            uint32_t values[256];
+
+            CrcTable() {
+                for (uint32_t n = 0; n < 256; n++) {
+                    uint32_t c = n;
+                    for (int k = 0; k < 8; k++) {
+                        c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                    }
+                    values[n] = c;
+                }
+            }
+        };
+
+        uint32_t crc32(const uint8_t* data, size_t size) {
+            static const CrcTable table;
+            uint32_t crc = 0xFFFFFFFFu;
+            for (size_t k = 0; k < size; k++) {
+                crc = table.values[(crc ^ data[k]) & 0xFF] ^ (crc >> 8);
+            }
+            return ~crc;
+        }
+
+        void putBigEndian(std::vector<uint8_t>& out, uint32_t value) {
+            for (int shift = 24; shift >= 0; shift -= 8) {
+                out.push_back((uint8_t)(value >> shift));
+            }
+        }
+
+        void putChunk(std::vector<uint8_t>& out, const char type[4], const std::vector<uint8_t>& data) {
+            putBigEndian(out, (uint32_t)data.size());
+            size_t start = out.size();
+            out.insert(out.end(), type, type + 4);
+            out.insert(out.end(), data.begin(), data.end());
+            putBigEndian(out, crc32(out.data() + start, out.size() - start));
+        }
+
+        std::string lowerExtension(const std::string& filename) {
+            size_t dot = filename.find_last_of('.');
+            std::string extension = dot == std::string::npos ? "" : filename.substr(dot);
+            for (char& c : extension) {
+                c = (char)std::tolower((unsigned char)c);
+            }
+            return extension;
+        }
+
+        bool writeFile(const std::string& filename, const uint8_t* data, size_t size) {
+            FILE* file = fopen(filename.c_str(), "wb");
+            if (!file) {
+                return false;
+            }
+            bool written = fwrite(data, 1, size, file) == size;
+            return fclose(file) == 0 && written;
+        }
+    }
+
+    bool writePPM(const std::string& filename, const uint32_t* pixels, int width, int height) {
+        char header[64];
+        int headerSize = snprintf(header, sizeof(header), "P6\n%d %d\n255\n", width, height);
+
+        std::vector<uint8_t> data(header, header + headerSize);
+        data.reserve(headerSize + (size_t)width * height * 3);
+        for (size_t i = 0; i < (size_t)width * height; i++) {
+            data.push_back((uint8_t)(pixels[i] >> 16));
+            data.push_back((uint8_t)(pixels[i] >> 8));
+            data.push_back((uint8_t)pixels[i]);
+        }
+        return writeFile(filename, data.data(), data.size());
+    }
+
+    std::vector<uint8_t> encodePNG(const uint32_t* pixels, int width, int height) {
+        // Rows use the Up filter, which turns areas repeated from the row above
+        // into zeros
+        size_t stride = (size_t)width * 3;
+        std::vector<uint8_t> raw((stride + 1) * height);
+        std::vector<uint8_t> row(stride), above(stride, 0);
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                uint32_t p = pixels[(size_t)y * width + x];
+                row[x * 3] = (uint8_t)(p >> 16);
+                row[x * 3 + 1] = (uint8_t)(p >> 8);
+                row[x * 3 + 2] = (uint8_t)p;
+            }
+            uint8_t* out = &raw[(stride + 1) * y];
+            out[0] = 2;
+            for (size_t k = 0; k < stride; k++) {
+                out[k + 1] = (uint8_t)(row[k] - above[k]);
+            }
+            row.swap(above);
+        }
+
+        std::vector<uint8_t> png = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+        std::vector<uint8_t> header;
+        putBigEndian(header, (uint32_t)width);
+        putBigEndian(header, (uint32_t)height);
+        header.push_back(8);  // bits per channel
+        header.push_back(2);  // RGB
+        header.push_back(0);  // deflate
+        header.push_back(0);  // adaptive filtering
+        header.push_back(0);  // no interlace
+        putChunk(png, "IHDR", header);
+
+        std::vector<uint8_t> compressed;
+        compress(raw.data(), raw.size(), compressed);
+        putChunk(png, "IDAT", compressed);
+        putChunk(png, "IEND", std::vector<uint8_t>());
+        return png;
+    }
+
+    bool writePNG(const std::string& filename, const uint32_t* pixels, int width, int height) {
+        std::vector<uint8_t> png = encodePNG(pixels, width, height);
+        return writeFile(filename, png.data(), png.size());
+    }
+
+    bool writeImage(const std::string& filename, const uint32_t* pixels, int width, int height) {
+        std::string extension = lowerExtension(filename);
+        if (extension == ".ppm") {
+            return writePPM(filename, pixels, width, height);
+        }
+        if (extension == ".png") {
+            return writePNG(filename, pixels, width, height);
+        }
+        return false;
+    }
+
+    bool readPPM(const std::string& filename, std::vector<uint32_t>& pixels, int& width, int& height) {
+        MappedFile file;
+        if (!file.open(filename) || file.size() < 2) {
+            return false;
+        }
+
+        const char* p = file.data();
+        const char* end = p + file.size();
+        if (p[0] != 'P' || p[1] != '6') {
+            return false;
+        }
+        p += 2;
+
+        int maxValue;
+        if (!readHeaderValue(p, end, width) || !readHeaderValue(p, end, height) ||
+            !readHeaderValue(p, end, maxValue) || maxValue <= 0 || maxValue > 255 || p == end) {
+            return false;
+        }
+        p++;  // the single whitespace before the samples
+        if (width <= 0 || height <= 0 || (size_t)(end - p) / 3 / (size_t)width < (size_t)height) {
+            return false;
+        }
+
+        pixels.resize((size_t)width * height);
+        for (size_t i = 0; i < pixels.size(); i++, p += 3) {
+            uint32_t r = std::min(255u, (uint8_t)p[0] * 255u / maxValue);
+            uint32_t g = std::min(255u, (uint8_t)p[1] * 255u / maxValue);
+            uint32_t b = std::min(255u, (uint8_t)p[2] * 255u / maxValue);
+            pixels[i] = 0xFF000000u | (r << 16) | (g << 8) | b;
+        }
+        return true;
+    }
+
+    bool readPNG(const std::string& filename, std::vector<uint32_t>& pixels, int& width, int& height) {
+        static const uint8_t SIGNATURE[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+        MappedFile file;
+        if (!file.open(filename) || file.size() < sizeof(SIGNATURE) ||
+            memcmp(file.data(), SIGNATURE, sizeof(SIGNATURE)) != 0) {
+            return false;
+        }
+
+        // Chunks up to IEND, each checked against its CRC
+        const uint8_t* p = (const uint8_t*)file.data() + sizeof(SIGNATURE);
+        const uint8_t* end = (const uint8_t*)file.data() + file.size();
+        std::vector<uint8_t> compressed;
+        width = height = 0;
+        while (true) {
+            if (end - p < 12) {
+                return false;
+            }
+            uint32_t length = getBigEndian(p);
+            if ((size_t)(end - p) - 12 < length) {
+                return false;
+            }
+            const uint8_t* type = p + 4;
+            const uint8_t* body = p + 8;
+            if (crc32(type, (size_t)length + 4) != getBigEndian(body + length)) {
+                return false;
+            }
+            if (memcmp(type, "IHDR", 4) == 0) {
+                // 8-bit RGB, deflate, adaptive filtering, no interlace
+                if (length != 13 || body[8] != 8 || body[9] != 2 || body[10] != 0 || body[11] != 0 || body[12] != 0 ||
+                    getBigEndian(body) > MAX_PNG_SIZE || getBigEndian(body + 4) > MAX_PNG_SIZE) {
+                    return false;
+                }
+                width = (int)getBigEndian(body);
+                height = (int)getBigEndian(body + 4);
+            } else if (memcmp(type, "IDAT", 4) == 0) {
+                compressed.insert(compressed.end(), body, body + length);
+            } else if (memcmp(type, "IEND", 4) == 0) {
+                break;
+            }
+            p = body + length + 4;
+        }
+        if (width == 0 || height == 0) {
+            return false;
+        }
+
+        size_t stride = (size_t)width * 3;
+        std::vector<uint8_t> raw;
+        raw.reserve((stride + 1) * height);
+        if (!decompress(compressed.data(), compressed.size(), (stride + 1) * height, raw) ||
+            raw.size() != (stride + 1) * height) {
+            return false;
+        }
+
+        // Undo each row's filter in place, against the row above once it is undone
+        std::vector<uint8_t> zeros(stride, 0);
+        pixels.resize((size_t)width * height);
+        for (int y = 0; y < height; y++) {
+            uint8_t* row = &raw[(stride + 1) * y + 1];
+            const uint8_t* above = y > 0 ? row - (stride + 1) : zeros.data();
+            uint8_t filter = row[-1];
+            for (size_t k = 0; k < stride; k++) {
+                int a = k >= 3 ? row[k - 3] : 0;
+                int b = above[k];
+                int c = k >= 3 ? above[k - 3] : 0;
+                switch (filter) {
+                    case 0: break;
+                    case 1: row[k] = (uint8_t)(row[k] + a); break;
+                    case 2: row[k] = (uint8_t)(row[k] + b); break;
+                    case 3: row[k] = (uint8_t)(row[k] + (a + b) / 2); break;
+                    case 4: row[k] = (uint8_t)(row[k] + paeth(a, b, c)); break;
+                    default: return false;
+                }
+            }
+            for (int x = 0; x < width; x++) {
+                pixels[(size_t)y * width + x] = 0xFF000000u | ((uint32_t)row[x * 3] << 16) | ((uint32_t)row[x * 3 + 1] << 8) | row[x * 3 + 2];
+            }
+        }
+        return true;
+    }
+
+    bool readImage(const std::string& filename, std::vector<uint32_t>& pixels, int& width, int& height) {
+        std::string extension = lowerExtension(filename);
+        if (extension == ".ppm") {
+            return readPPM(filename, pixels, width, height);
+        }
+        if (extension == ".png") {
+            return readPNG(filename, pixels, width, height);
+        }
+        return false;
+    }
+}
@@ -1,26 +1,44 @@
 #include <iostream>
 #include <SDL.h>
 #include <cmath>
+#include <cstring>
 #include "../include/engine.h"
+#include "../include/camera.h"
+#include "../include/framepacer.h"
+#include "../include/scene.h"
 #include "../graphics/renderer.h"
 
 using namespace Engine3D;
 using namespace std;
 
-void populateCube(mesh& m);
-
 int main(){
-    mesh shape;
-    vec3d cameraPos(0.0f, 0.0f, 0.0f);
+    shared_ptr<mesh> shape = make_shared<mesh>();
     
     // Try to load tetrahedron from file, fallback to cube if failed
-    // if (!shape.loadFromObjectFile("tetrahedron.obj")) {
+    // if (!shape->loadFromObjectFile("tetrahedron.obj")) {
     //     cout << "Failed to load tetrahedron.obj, using default cube" << endl;
-    //     populateCube(shape);
+    //     populateCube(*shape);
     // } else {
-    //     cout << "Successfully loaded tetrahedron.obj with " << shape.triangles.size() << " triangles" << endl;
+    //     cout << "Successfully loaded tetrahedron.obj with " << shape->triangleCount() << " triangles" << endl;
     // }
-    populateCube(shape);
+    populateCube(*shape);
+    shape->computeVertexNormals();
+    shape->computeFaceNormals();
+    shape->computeEdges();
+
+    // A spinning group in front of the camera holding a grid of instances of the
+    // shape, each turning around its own corner
+    Scene scene;
+    uint32_t shapeIndex = scene.addMesh(shape);
+    matrix4x4 identity;
+    createTranslationMatrix(identity, 0.0f, 0.0f, 0.0f);
+    Scene::NodeId group = scene.addNode(Scene::NONE, identity);
+    vector<Scene::NodeId> instances;
+    for (int y = -1; y <= 1; y++) {
+        for (int x = -1; x <= 1; x++) {
+            instances.push_back(scene.addNode(shapeIndex, identity, group));
+        }
+    }
     
     int width = 800;
     int height = 600;
@@ -33,78 +51,143 @@ int main(){
         cout << "Failed to initialize renderer!" << endl;
         return -1;
     }
+
+    // Only tiles whose triangles changed are redrawn and uploaded
+    renderer.setIncrementalRendering(true);
+
+    // Frames are rasterized while the next one is being built; whether the loop
+    // waits for each frame to show depends on whether it keeps up with the pacer
+    renderer.setPipelinedFrames(true);
+    FramePacer pacer(60.0);
     
-    matrix4x4 projection;
-    populateMatrix(projection, width, height, z_length);
+    // WASD moves, the arrow keys look around, Space pauses the animation, Tab prints
+    // frame stats, F1 toggles the profiling overlay, F2 starts and stops a Chrome
+    // trace capture, F3 cycles through flat, Gouraud and Phong shading and F4
+    // draws the edges of every instance over the image
+    Camera camera((float)width, (float)height);
+    camera.zFar = (float)z_length;
+    const float moveSpeed = 0.05f;
+    const float turnSpeed = 0.02f;
 
     // Rotation variables
     float theta = 0.0f;
+    bool paused = false;
+    bool wireframe = false;
+
+    // What the last presented frame showed, to skip frames where nothing changed
+    uint64_t drawnVersion = 0;
+    matrix4x4 drawnViewProjection;
+    bool redraw = true;
     
     bool running = true;
     SDL_Event event;
     while (running) {
+        // Wait for the frame to be due before reading input, so what it shows is as
+        // recent as possible
+        pacer.beginFrame();
 
         while (SDL_PollEvent(&event)) {
             if (event.type == SDL_QUIT) {
                 running = false;
             }
+            // Tab prints the counters of the last frame
+            if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_TAB) {
+                cout << renderer.getFrameStats() << endl;
+            }
+            if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_SPACE) {
+                paused = !paused;
+            }
+            if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_F1) {
+                renderer.setOverlayEnabled(!renderer.isOverlayEnabled());
+                redraw = true;
+            }
+            if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_F3) {
+                ShadingMode next = (ShadingMode)(((int)renderer.getShadingMode() + 1) % 3);
+                renderer.setShadingMode(next);
+                redraw = true;
+            }
+            if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_F4) {
+                wireframe = !wireframe;
+                redraw = true;
+            }
+            if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_F2) {
+                Profiler& profiler = renderer.getProfiler();
+                if (!profiler.isCapturing()) {
+                    profiler.setEnabled(true);
+                    profiler.startCapture();
+                    cout << "Capturing a trace, press F2 again to stop" << endl;
+                } else {
+                    profiler.stopCapture();
+                    if (profiler.writeChromeTrace("trace.json")) {
+                        cout << "Trace written to trace.json" << endl;
+                    }
+                }
+            }
         }
 
+        const Uint8* keys = SDL_GetKeyboardState(nullptr);
+        camera.move((keys[SDL_SCANCODE_W] - keys[SDL_SCANCODE_S]) * moveSpeed,
+                    (keys[SDL_SCANCODE_D] - keys[SDL_SCANCODE_A]) * moveSpeed, 0.0f);
+        camera.rotate((keys[SDL_SCANCODE_RIGHT] - keys[SDL_SCANCODE_LEFT]) * turnSpeed,
+                      (keys[SDL_SCANCODE_UP] - keys[SDL_SCANCODE_DOWN]) * turnSpeed);
+
         // Update rotation angle
-        theta += 0.01f;
+        if (!paused) {
+            theta += 0.01f;
+        }
 
         // Create rotation matrices
         matrix4x4 rotX, rotZ;
         createRotationMatrixX(rotX, theta);
         createRotationMatrixZ(rotZ, theta);
 
+        // Spin every instance in place and the whole grid around its center
+        for (size_t i = 0; i < instances.size(); i++) {
+            matrix4x4 offset;
+            createTranslationMatrix(offset, ((int)(i % 3) - 1) * 2.0f, ((int)(i / 3) - 1) * 2.0f, 0.0f);
+            scene.setTransform(instances[i], rotZ * rotX * offset);
+        }
+        matrix4x4 spin, distance;
+        createRotationMatrixZ(spin, theta * 0.25f);
+        createTranslationMatrix(distance, 0.0f, 0.0f, 8.0f);
+        scene.setTransform(group, spin * distance);
+        scene.updateTransforms();
+
+        // Sleep until the next event while the scene and camera stand still. The
+        // overlay shows live timings, so it keeps every frame drawn.
+        matrix4x4 viewProjection = camera.getViewProjectionMatrix();
+        if (!redraw && !renderer.isOverlayEnabled() && scene.getVersion() == drawnVersion &&
+            memcmp(viewProjection.m, drawnViewProjection.m, sizeof(viewProjection.m)) == 0) {
+            renderer.finish();
+            SDL_WaitEventTimeout(nullptr, 100);
+            continue;
+        }
+        drawnVersion = scene.getVersion();
+        drawnViewProjection = viewProjection;
+        redraw = false;
+
         // Render
         renderer.clear();
-        renderer.drawMesh(shape, projection, rotX, rotZ, cameraPos);
+        renderer.drawScene(scene, camera);
+        if (wireframe) {
+            for (const Scene::Node& node : scene.getNodes()) {
+                if (node.meshIndex != Scene::NONE) {
+                    renderer.drawWireframe(*scene.getMeshes()[node.meshIndex].source, node.world, camera, RGB::GREEN);
+                }
+            }
+        }
         renderer.present();
-        
-        // Cap framerate
-        SDL_Delay(16);
+
+        // With time to spare the frame is shown right away. A loop that cannot keep
+        // up leaves it rasterizing behind the next frame's geometry, trading a frame
+        // of latency for throughput.
+        if (!pacer.isBehind()) {
+            renderer.finish();
+        }
+        pacer.endFrame();
     }
     
+    renderer.finish();
     renderer.cleanup();
     return 0;
 }
-
-void populateCube(mesh& m) {
-    // Define the 8 vertices of a cube
-    vec3d vertices[8] = {
-        vec3d(0.0f, 0.0f, 0.0f), // 0: front bottom left
-        vec3d(0.0f, 0.0f, 1.0f), // 1: back bottom right
-        vec3d(0.0f, 1.0f, 0.0f), // 2: front top left
-        vec3d(0.0f, 1.0f, 1.0f), // 3: back top left
-        vec3d(1.0f, 0.0f, 0.0f), // 4: front bottom right
-        vec3d(1.0f, 0.0f, 1.0f), // 5: back bottom right
-        vec3d(1.0f, 1.0f, 0.0f), // 6: front top right
-        vec3d(1.0f, 1.0f, 1.0f)  // 7: back top right
-    };
-    
-    // Front face
-    m.triangles.push_back(triangle(vertices[0], vertices[2], vertices[6]));
-    m.triangles.push_back(triangle(vertices[0], vertices[6], vertices[4]));
-
-    // Back face
-    m.triangles.push_back(triangle(vertices[5], vertices[7], vertices[3]));
-    m.triangles.push_back(triangle(vertices[5], vertices[3], vertices[1]));
-
-    // Left face
-    m.triangles.push_back(triangle(vertices[1], vertices[3], vertices[2]));
-    m.triangles.push_back(triangle(vertices[1], vertices[2], vertices[0]));
-
-    // Right face
-    m.triangles.push_back(triangle(vertices[4], vertices[6], vertices[7]));
-    m.triangles.push_back(triangle(vertices[4], vertices[7], vertices[5]));
-    
-    // Top face
-    m.triangles.push_back(triangle(vertices[2], vertices[3], vertices[7]));
-    m.triangles.push_back(triangle(vertices[2], vertices[7], vertices[6]));
-
-    // Bottom face
-    m.triangles.push_back(triangle(vertices[5], vertices[1], vertices[0]));
-    m.triangles.push_back(triangle(vertices[5], vertices[0], vertices[4]));
-}
@@ -0,0 +1,83 @@
+#include "../include/mappedfile.h"
+#include <fstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define ENGINE_HAS_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Engine3D {
+
+    MappedFile::MappedFile() : bytes(nullptr), length(0), opened(false), mapped(false) {}
+
+    MappedFile::~MappedFile() {
+        close();
+    }
+
+    bool MappedFile::open(const std::string& filename) {
+        close();
+
+#ifdef ENGINE_HAS_MMAP
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+
+        struct stat info;
+        if (fstat(fd, &info) != 0) {
+            ::close(fd);
+            return false;
+        }
+
+        length = (size_t)info.st_size;
+        if (length > 0) {
+            void* address = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (address != MAP_FAILED) {
+                madvise(address, length, MADV_SEQUENTIAL);
+                bytes = (const char*)address;
+                mapped = true;
+            }
+        }
+        ::close(fd);
+
+        if (mapped || length == 0) {
+            opened = true;
+            return true;
+        }
+#endif
+
+        // No mmap, read the whole file instead
+        std::ifstream file(filename, std::ios::binary | std::ios::ate);
+        if (!file.is_open()) {
+            return false;
+        }
+        fallback.resize((size_t)file.tellg());
+        file.seekg(0);
+        if (!file.read(fallback.data(), (std::streamsize)fallback.size())) {
+            fallback.clear();
+            return false;
+        }
+
+        bytes = fallback.data();
+        length = fallback.size();
+        opened = true;
+        return true;
+    }
+
+    void MappedFile::close() {
+#ifdef ENGINE_HAS_MMAP
+        if (mapped) {
+            munmap((void*)bytes, length);
+        }
+#endif
+        fallback.clear();
+        fallback.shrink_to_fit();
+        bytes = nullptr;
+        length = 0;
+        opened = false;
+        mapped = false;
+    }
+}
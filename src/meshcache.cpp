@@ -0,0 +1,215 @@
+#include "../include/engine.h"
+#include "../include/mappedfile.h"
+#include "../include/meshcache.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+
+#if defined(_WIN32)
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+namespace Engine3D {
+
+    namespace {
+        uint64_t alignUp(uint64_t offset) {
+            return (offset + MESH_CACHE_ALIGNMENT - 1) / MESH_CACHE_ALIGNMENT * MESH_CACHE_ALIGNMENT;
+        }
+
+        // Size and modification time identifying one version of a source file
+        bool sourceStamp(const string& filename, uint64_t& size, int64_t& modified) {
+            std::error_code error;
+            size = (uint64_t)std::filesystem::file_size(filename, error);
+            if (error) return false;
+            std::filesystem::file_time_type time = std::filesystem::last_write_time(filename, error);
+            if (error) return false;
+            modified = (int64_t)time.time_since_epoch().count();
+            return true;
+        }
+
+        bool rangeInside(uint64_t offset, uint64_t count, uint64_t elementSize, uint64_t fileSize) {
+            return offset % MESH_CACHE_ALIGNMENT == 0 && offset <= fileSize &&
+                   count <= (fileSize - offset) / elementSize;
+        }
+
+        // Temporary name beside the cache, unique to this process and call, so writers
+        // of the same cache from several threads or processes never share a file
+        string tempCachePath(const string& filename) {
+            static std::atomic<uint64_t> counter(0);
+            return filename + "." + std::to_string((long long)getpid()) + "." + std::to_string(counter++) + ".tmp";
+        }
+
+        bool writeCache(const mesh& m, const string& filename, uint64_t sourceSize, int64_t sourceModified) {
+            MeshCacheHeader header;
+            memset(&header, 0, sizeof(header));
+            memcpy(header.magic, MESH_CACHE_MAGIC, sizeof(header.magic));
+            header.version = MESH_CACHE_VERSION;
+            header.endianCheck = MESH_CACHE_ENDIAN_CHECK;
+            header.sourceSize = sourceSize;
+            header.sourceModified = sourceModified;
+            header.vertexCount = m.vertices.size();
+            header.indexCount = m.indices.size();
+            header.normalCount = m.normals.size() == m.vertices.size() ? m.normals.size() : 0;
+            header.texCoordCount = m.texCoords.size() == m.vertices.size() ? m.texCoords.size() : 0;
+
+            uint64_t floatBytes = header.vertexCount * sizeof(float);
+            header.xOffset = alignUp(sizeof(header));
+            header.yOffset = alignUp(header.xOffset + floatBytes);
+            header.zOffset = alignUp(header.yOffset + floatBytes);
+            header.indexOffset = alignUp(header.zOffset + floatBytes);
+            uint64_t normalBytes = header.normalCount * sizeof(float);
+            header.nxOffset = alignUp(header.indexOffset + header.indexCount * sizeof(uint32_t));
+            header.nyOffset = alignUp(header.nxOffset + normalBytes);
+            header.nzOffset = alignUp(header.nyOffset + normalBytes);
+            uint64_t texCoordBytes = header.texCoordCount * sizeof(float);
+            header.uOffset = alignUp(header.nzOffset + normalBytes);
+            header.vOffset = alignUp(header.uOffset + texCoordBytes);
+
+            // Write beside the target and rename over it, so readers (including meshes
+            // still mapping the old cache) never see a partial file. Concurrent writers
+            // each rename a complete file; the last one wins.
+            string tempName = tempCachePath(filename);
+            FILE* out = fopen(tempName.c_str(), "wb");
+            if (!out) {
+                return false;
+            }
+
+            struct Block { uint64_t offset; const void* data; uint64_t bytes; };
+            Block blocks[] = {
+                { 0, &header, sizeof(header) },
+                { header.xOffset, m.vertices.x.data(), floatBytes },
+                { header.yOffset, m.vertices.y.data(), floatBytes },
+                { header.zOffset, m.vertices.z.data(), floatBytes },
+                { header.indexOffset, m.indices.data(), header.indexCount * sizeof(uint32_t) },
+                { header.nxOffset, m.normals.x.data(), normalBytes },
+                { header.nyOffset, m.normals.y.data(), normalBytes },
+                { header.nzOffset, m.normals.z.data(), normalBytes },
+                { header.uOffset, m.texCoords.u.data(), texCoordBytes },
+                { header.vOffset, m.texCoords.v.data(), texCoordBytes }
+            };
+
+            bool ok = true;
+            uint64_t written = 0;
+            const char padding[MESH_CACHE_ALIGNMENT] = {};
+            for (const Block& block : blocks) {
+                ok = ok && fwrite(padding, 1, block.offset - written, out) == block.offset - written;
+                ok = ok && (block.bytes == 0 || fwrite(block.data, 1, block.bytes, out) == block.bytes);
+                written = block.offset + block.bytes;
+            }
+            ok = fclose(out) == 0 && ok;
+
+            std::error_code error;
+            if (ok) {
+                std::filesystem::rename(tempName, filename, error);
+            }
+            if (!ok || error) {
+                std::filesystem::remove(tempName, error);
+                return false;
+            }
+            return true;
+        }
+
+        // Map a cache and point the mesh arrays into it. With checkSource the cache is
+        // only accepted if it was built from a source of the given size and time.
+        bool mapCache(mesh& m, const string& filename, bool checkSource, uint64_t sourceSize, int64_t sourceModified) {
+            std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>();
+            if (!file->open(filename) || file->size() < sizeof(MeshCacheHeader)) {
+                return false;
+            }
+
+            MeshCacheHeader header;
+            memcpy(&header, file->data(), sizeof(header));
+            uint64_t fileSize = file->size();
+            if (memcmp(header.magic, MESH_CACHE_MAGIC, sizeof(header.magic)) != 0 ||
+                header.version != MESH_CACHE_VERSION ||
+                header.endianCheck != MESH_CACHE_ENDIAN_CHECK ||
+                header.indexCount % 3 != 0 ||
+                header.vertexCount > UINT32_MAX ||
+                !rangeInside(header.xOffset, header.vertexCount, sizeof(float), fileSize) ||
+                !rangeInside(header.yOffset, header.vertexCount, sizeof(float), fileSize) ||
+                !rangeInside(header.zOffset, header.vertexCount, sizeof(float), fileSize) ||
+                !rangeInside(header.indexOffset, header.indexCount, sizeof(uint32_t), fileSize) ||
+                (header.normalCount != 0 && header.normalCount != header.vertexCount) ||
+                !rangeInside(header.nxOffset, header.normalCount, sizeof(float), fileSize) ||
+                !rangeInside(header.nyOffset, header.normalCount, sizeof(float), fileSize) ||
+                !rangeInside(header.nzOffset, header.normalCount, sizeof(float), fileSize) ||
+                (header.texCoordCount != 0 && header.texCoordCount != header.vertexCount) ||
+                !rangeInside(header.uOffset, header.texCoordCount, sizeof(float), fileSize) ||
+                !rangeInside(header.vOffset, header.texCoordCount, sizeof(float), fileSize)) {
+                return false;
+            }
+
+            if (checkSource && (header.sourceSize != sourceSize || header.sourceModified != sourceModified)) {
+                return false;
+            }
+
+            // A corrupt index would make the renderer read out of bounds
+            const uint32_t* indexData = (const uint32_t*)(file->data() + header.indexOffset);
+            uint32_t maxIndex = 0;
+            for (uint64_t i = 0; i < header.indexCount; i++) {
+                maxIndex = std::max(maxIndex, indexData[i]);
+            }
+            if (header.indexCount > 0 && maxIndex >= header.vertexCount) {
+                return false;
+            }
+
+            const char* base = file->data();
+            m.vertices.x.borrow((const float*)(base + header.xOffset), header.vertexCount, file);
+            m.vertices.y.borrow((const float*)(base + header.yOffset), header.vertexCount, file);
+            m.vertices.z.borrow((const float*)(base + header.zOffset), header.vertexCount, file);
+            m.indices.borrow(indexData, header.indexCount, file);
+            m.normals.x.borrow((const float*)(base + header.nxOffset), header.normalCount, file);
+            m.normals.y.borrow((const float*)(base + header.nyOffset), header.normalCount, file);
+            m.normals.z.borrow((const float*)(base + header.nzOffset), header.normalCount, file);
+            m.texCoords.u.borrow((const float*)(base + header.uOffset), header.texCoordCount, file);
+            m.texCoords.v.borrow((const float*)(base + header.vOffset), header.texCoordCount, file);
+            m.faceNormals.clear();
+            m.edges.clear();
+            m.lods.clear();
+            m.bvh.reset();
+            return true;
+        }
+    }
+
+    string meshCachePath(const string& objFilename) {
+        return objFilename + ".e3dm";
+    }
+
+    bool mesh::loadFromObjectFile(const string& filename, bool useCache, ThreadPool* pool) {
+        if (!useCache) {
+            return parseObjectFile(filename, pool);
+        }
+
+        uint64_t sourceSize;
+        int64_t sourceModified;
+        if (!sourceStamp(filename, sourceSize, sourceModified)) {
+            return false;
+        }
+
+        string cachePath = meshCachePath(filename);
+        if (mapCache(*this, cachePath, true, sourceSize, sourceModified)) {
+            return !indices.empty();
+        }
+
+        if (!parseObjectFile(filename, pool)) {
+            return false;
+        }
+
+        // Best effort, a read-only directory just means parsing again next time
+        writeCache(*this, cachePath, sourceSize, sourceModified);
+        return true;
+    }
+
+    bool mesh::loadFromCacheFile(const string& filename) {
+        return mapCache(*this, filename, false, 0, 0);
+    }
+
+    bool mesh::saveToCacheFile(const string& filename) const {
+        return writeCache(*this, filename, 0, 0);
+    }
+}
@@ -0,0 +1,369 @@
+#include "../include/engine.h"
+#include "../include/mappedfile.h"
+#include "../include/threadpool.h"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <unordered_map>
+
+namespace Engine3D {
+
+    namespace {
+        // Files are split into line-aligned chunks of about this size, parsed in parallel
+        const size_t CHUNK_BYTES = 4 << 20;
+
+        // Reference of a face corner without a texture coordinate or normal
+        const uint32_t NO_REFERENCE = UINT32_MAX;
+
+        // Face corner references into one kind of element (v, vt or vn), one per
+        // corner. They are absolute, except the corners listed in relative, which
+        // came from negative indices and only become absolute once the element count
+        // of all earlier chunks is known.
+        struct ObjReferences {
+            std::vector<uint32_t> indices;
+            std::vector<size_t> relative;
+            size_t base;
+
+            void push(long reference, size_t elementCount) {
+                if (reference > 0) {
+                    indices.push_back((uint32_t)(reference - 1));
+                } else if (reference < 0) {
+                    // Relative corners may be negative until fixed up; unsigned
+                    // wraparound makes adding the base later come out right
+                    relative.push_back(indices.size());
+                    indices.push_back((uint32_t)((long)elementCount + reference));
+                } else {
+                    indices.push_back(NO_REFERENCE);
+                }
+            }
+
+            void resolve() {
+                for (size_t i : relative) {
+                    indices[i] += (uint32_t)base;
+                }
+            }
+        };
+
+        // Geometry parsed from one chunk
+        struct ObjChunk {
+            const char* begin;
+            const char* end;
+            std::vector<float> x, y, z;
+            std::vector<float> u, v;
+            std::vector<float> nx, ny, nz;
+            ObjReferences positions, texCoords, normals;
+            size_t indexBase;
+        };
+
+        inline bool isSpace(char c) {
+            return c == ' ' || c == '\t' || c == '\r';
+        }
+
+        inline const char* skipSpaces(const char* p, const char* end) {
+            while (p < end && isSpace(*p)) p++;
+            return p;
+        }
+
+        inline const char* parseFloat(const char* p, const char* end, float& value) {
+            p = skipSpaces(p, end);
+            if (p < end && *p == '+') p++;
+            std::from_chars_result result = std::from_chars(p, end, value);
+            return result.ec == std::errc() ? result.ptr : nullptr;
+        }
+
+        // Up to count floats of an element line, leaving missing ones at 0
+        void parseFloats(const char* p, const char* end, float* values, int count) {
+            for (int i = 0; i < count; i++) {
+                values[i] = 0.0f;
+            }
+            for (int i = 0; i < count && p; i++) {
+                p = parseFloat(p, end, values[i]);
+            }
+        }
+
+        // Optional index after a '/' of a face corner, 0 when absent
+        long parseReference(const char*& q, const char* end) {
+            long reference = 0;
+            if (q < end && *q == '/') {
+                q++;
+                std::from_chars_result result = std::from_chars(q, end, reference);
+                if (result.ec != std::errc()) {
+                    reference = 0;
+                }
+                while (q < end && *q != '/' && !isSpace(*q)) q++;
+            }
+            return reference;
+        }
+
+        void parseChunk(ObjChunk& chunk) {
+            const char* p = chunk.begin;
+            const char* end = chunk.end;
+            std::vector<long> corners[3];
+
+            while (p < end) {
+                const char* lineEnd = (const char*)memchr(p, '\n', (size_t)(end - p));
+                if (!lineEnd) lineEnd = end;
+                p = skipSpaces(p, lineEnd);
+
+                if (lineEnd - p > 1 && p[0] == 'v' && isSpace(p[1])) {
+                    // Vertex line: v x y z [w], anything after z is ignored
+                    float v[3];
+                    parseFloats(p + 1, lineEnd, v, 3);
+                    chunk.x.push_back(v[0]);
+                    chunk.y.push_back(v[1]);
+                    chunk.z.push_back(v[2]);
+                }
+                else if (lineEnd - p > 2 && p[0] == 'v' && p[1] == 't' && isSpace(p[2])) {
+                    // Texture coordinate line: vt u [v [w]]
+                    float t[2];
+                    parseFloats(p + 2, lineEnd, t, 2);
+                    chunk.u.push_back(t[0]);
+                    chunk.v.push_back(t[1]);
+                }
+                else if (lineEnd - p > 2 && p[0] == 'v' && p[1] == 'n' && isSpace(p[2])) {
+                    // Normal line: vn x y z
+                    float n[3];
+                    parseFloats(p + 2, lineEnd, n, 3);
+                    chunk.nx.push_back(n[0]);
+                    chunk.ny.push_back(n[1]);
+                    chunk.nz.push_back(n[2]);
+                }
+                else if (lineEnd - p > 1 && p[0] == 'f' && isSpace(p[1])) {
+                    // Face line: f v1 v2 v3 ..., each corner v, v/vt, v//vn or v/vt/vn
+                    for (std::vector<long>& list : corners) {
+                        list.clear();
+                    }
+                    bool valid = true;
+                    const char* q = skipSpaces(p + 1, lineEnd);
+                    while (q < lineEnd) {
+                        long index = 0;
+                        std::from_chars_result result = std::from_chars(q, lineEnd, index);
+                        if (result.ec != std::errc() || index == 0) {
+                            valid = false;
+                            break;
+                        }
+
+                        // 1-based, or negative counting back from the latest element
+                        q = result.ptr;
+                        corners[0].push_back(index);
+                        corners[1].push_back(parseReference(q, lineEnd));
+                        corners[2].push_back(parseReference(q, lineEnd));
+                        while (q < lineEnd && !isSpace(*q)) q++;
+                        q = skipSpaces(q, lineEnd);
+                    }
+
+                    // Quads and larger polygons are triangulated as a fan
+                    if (valid && corners[0].size() >= 3) {
+                        for (size_t i = 1; i + 1 < corners[0].size(); i++) {
+                            size_t fan[3] = { 0, i, i + 1 };
+                            for (size_t c : fan) {
+                                chunk.positions.push(corners[0][c], chunk.x.size());
+                                chunk.texCoords.push(corners[1][c], chunk.u.size());
+                                chunk.normals.push(corners[2][c], chunk.nx.size());
+                            }
+                        }
+                    }
+                }
+
+                p = lineEnd + 1;
+            }
+        }
+
+        // Whether every corner references an element that exists
+        bool allValid(const std::vector<uint32_t>& references, size_t elementCount) {
+            if (elementCount == 0) {
+                return false;
+            }
+            for (uint32_t r : references) {
+                if (r >= elementCount) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        struct CornerKey {
+            uint32_t vertex, texCoord, normal;
+            bool operator==(const CornerKey& o) const {
+                return vertex == o.vertex && texCoord == o.texCoord && normal == o.normal;
+            }
+        };
+
+        struct CornerKeyHash {
+            size_t operator()(const CornerKey& k) const {
+                uint64_t h = ((uint64_t)k.vertex << 32) ^ ((uint64_t)k.texCoord * 0x9E3779B97F4A7C15ull) ^ k.normal;
+                return (size_t)(h ^ (h >> 29));
+            }
+        };
+
+        // Give every vertex the texture coordinate and normal its corners reference
+        // (NO_REFERENCE for kinds that are not used). A vertex referenced with several,
+        // like one on a hard edge or a texture seam, is split into one copy per
+        // combination; copies keep the vertex's normal when normals are not used.
+        void applyCornerAttributes(mesh& m, const std::vector<uint32_t>& texIndices, const std::vector<float>& u,
+                                   const std::vector<float>& v, const std::vector<uint32_t>& normalIndices,
+                                   const std::vector<float>& nx, const std::vector<float>& ny,
+                                   const std::vector<float>& nz) {
+            const uint64_t UNUSED = UINT64_MAX;
+            std::vector<uint64_t> attributesOf(m.vertices.size(), UNUSED);
+            std::unordered_map<CornerKey, uint32_t, CornerKeyHash> splits;
+            bool keepNormals = normalIndices.empty();
+            for (size_t i = 0; i < m.indices.size(); i++) {
+                uint32_t vertex = m.indices[i];
+                uint32_t t = texIndices.empty() ? NO_REFERENCE : texIndices[i];
+                uint32_t n = normalIndices.empty() ? NO_REFERENCE : normalIndices[i];
+                uint64_t attributes = ((uint64_t)t << 32) | n;
+                if (attributesOf[vertex] == UNUSED) {
+                    attributesOf[vertex] = attributes;
+                } else if (attributesOf[vertex] != attributes) {
+                    auto found = splits.find(CornerKey{ vertex, t, n });
+                    if (found == splits.end()) {
+                        found = splits.emplace(CornerKey{ vertex, t, n }, (uint32_t)m.vertices.size()).first;
+                        m.vertices.push_back(m.vertices.get(vertex));
+                        if (keepNormals) {
+                            m.normals.push_back(m.normals.get(vertex));
+                        }
+                        attributesOf.push_back(attributes);
+                    }
+                    m.indices[i] = found->second;
+                }
+            }
+
+            // Vertices no face uses get a zero normal and texture coordinate
+            size_t count = m.vertices.size();
+            if (!normalIndices.empty()) {
+                m.normals.resize(count);
+                for (size_t i = 0; i < count; i++) {
+                    uint32_t n = (uint32_t)attributesOf[i];
+                    m.normals.set(i, attributesOf[i] == UNUSED ? vec3d() : vec3d(nx[n], ny[n], nz[n]).normalize());
+                }
+            }
+            if (!texIndices.empty()) {
+                // OBJ puts v = 0 at the bottom of the image, textures start at the top
+                m.texCoords.resize(count);
+                float* outU = m.texCoords.u.data();
+                float* outV = m.texCoords.v.data();
+                for (size_t i = 0; i < count; i++) {
+                    uint32_t t = (uint32_t)(attributesOf[i] >> 32);
+                    outU[i] = attributesOf[i] == UNUSED ? 0.0f : u[t];
+                    outV[i] = attributesOf[i] == UNUSED ? 0.0f : 1.0f - v[t];
+                }
+            }
+        }
+    }
+
+    bool mesh::parseObjectFile(const string& filename, ThreadPool* pool) {
+        MappedFile file;
+        if (!file.open(filename)) {
+            return false;
+        }
+
+        // Clear existing geometry
+        vertices.clear();
+        normals.clear();
+        faceNormals.clear();
+        edges.clear();
+        lods.clear();
+        bvh.reset();
+        texCoords.clear();
+        indices.clear();
+
+        // Split into chunks that start right after a newline
+        std::vector<ObjChunk> chunks;
+        const char* data = file.data();
+        const char* fileEnd = data + file.size();
+        const char* p = data;
+        while (p < fileEnd) {
+            const char* end = p + std::min(CHUNK_BYTES, (size_t)(fileEnd - p));
+            if (end < fileEnd) {
+                const char* newline = (const char*)memchr(end, '\n', (size_t)(fileEnd - end));
+                end = newline ? newline + 1 : fileEnd;
+            }
+
+            ObjChunk chunk;
+            chunk.begin = p;
+            chunk.end = end;
+            chunks.push_back(std::move(chunk));
+            p = end;
+        }
+
+        // A single chunk is not worth handing to the pool
+        auto forEachChunk = [&](const std::function<void(size_t)>& task) {
+            if (pool && chunks.size() > 1) {
+                pool->parallelFor(chunks.size(), task);
+            } else {
+                for (size_t c = 0; c < chunks.size(); c++) {
+                    task(c);
+                }
+            }
+        };
+        forEachChunk([&](size_t c) {
+            parseChunk(chunks[c]);
+        });
+
+        // Where every chunk lands in the merged buffers
+        size_t vertexCount = 0, texCount = 0, normalCount = 0, indexCount = 0;
+        for (ObjChunk& chunk : chunks) {
+            chunk.positions.base = vertexCount;
+            chunk.texCoords.base = texCount;
+            chunk.normals.base = normalCount;
+            chunk.indexBase = indexCount;
+            vertexCount += chunk.x.size();
+            texCount += chunk.u.size();
+            normalCount += chunk.nx.size();
+            indexCount += chunk.positions.indices.size();
+        }
+
+        vertices.resize(vertexCount);
+        indices.resize(indexCount);
+        std::vector<float> u(texCount), v(texCount);
+        std::vector<float> nx(normalCount), ny(normalCount), nz(normalCount);
+        std::vector<uint32_t> texIndices(indexCount), normalIndices(indexCount);
+        forEachChunk([&](size_t c) {
+            ObjChunk& chunk = chunks[c];
+            chunk.positions.resolve();
+            chunk.texCoords.resolve();
+            chunk.normals.resolve();
+            std::copy(chunk.x.begin(), chunk.x.end(), vertices.x.begin() + chunk.positions.base);
+            std::copy(chunk.y.begin(), chunk.y.end(), vertices.y.begin() + chunk.positions.base);
+            std::copy(chunk.z.begin(), chunk.z.end(), vertices.z.begin() + chunk.positions.base);
+            std::copy(chunk.u.begin(), chunk.u.end(), u.begin() + chunk.texCoords.base);
+            std::copy(chunk.v.begin(), chunk.v.end(), v.begin() + chunk.texCoords.base);
+            std::copy(chunk.nx.begin(), chunk.nx.end(), nx.begin() + chunk.normals.base);
+            std::copy(chunk.ny.begin(), chunk.ny.end(), ny.begin() + chunk.normals.base);
+            std::copy(chunk.nz.begin(), chunk.nz.end(), nz.begin() + chunk.normals.base);
+            std::copy(chunk.positions.indices.begin(), chunk.positions.indices.end(), indices.begin() + chunk.indexBase);
+            std::copy(chunk.texCoords.indices.begin(), chunk.texCoords.indices.end(), texIndices.begin() + chunk.indexBase);
+            std::copy(chunk.normals.indices.begin(), chunk.normals.indices.end(), normalIndices.begin() + chunk.indexBase);
+        });
+
+        // Drop triangles referencing vertices that do not exist
+        size_t kept = 0;
+        for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+            if (indices[i] < vertexCount && indices[i + 1] < vertexCount && indices[i + 2] < vertexCount) {
+                for (size_t k = 0; k < 3; k++) {
+                    texIndices[kept] = texIndices[i + k];
+                    normalIndices[kept] = normalIndices[i + k];
+                    indices[kept++] = indices[i + k];
+                }
+            }
+        }
+        indices.resize(kept);
+        texIndices.resize(kept);
+        normalIndices.resize(kept);
+
+        // Texture coordinates and normals are only used when every corner has them.
+        // Computed normals come first, so splitting along texture seams keeps them smooth.
+        if (!allValid(texIndices, texCount)) {
+            texIndices.clear();
+        }
+        if (!allValid(normalIndices, normalCount)) {
+            normalIndices.clear();
+            computeVertexNormals();
+        }
+        if (!texIndices.empty() || !normalIndices.empty()) {
+            applyCornerAttributes(*this, texIndices, u, v, normalIndices, nx, ny, nz);
+        }
+        return !indices.empty();
+    }
+}
@@ -0,0 +1,175 @@
+#include "../include/profiler.h"
+#include <algorithm>
+#include <cstdio>
+
+namespace Engine3D {
+
+    namespace {
+        const char* const STAGE_NAMES[(size_t)ProfileStage::Count] = {
+            "clear", "cull", "transform", "shade", "bin", "sort", "rasterize", "present"
+        };
+
+        // Small stable thread numbers for the trace, in order of first use
+        uint32_t traceThreadId() {
+            static std::atomic<uint32_t> nextId(0);
+            static thread_local uint32_t id = nextId.fetch_add(1);
+            return id;
+        }
+    }
+
+    const size_t Profiler::FRAME_HISTORY;
+
+    const char* profileStageName(ProfileStage stage) {
+        return stage < ProfileStage::Count ? STAGE_NAMES[(size_t)stage] : "unknown";
+    }
+
+    Profiler::Profiler()
+        : enabled(false), capturing(false), origin(Clock::now()), frameStart(origin), frameCount(0) {
+        for (size_t s = 0; s < (size_t)ProfileStage::Count; s++) {
+            stageNanoseconds[s].store(0);
+            lastStageTimes[s] = 0.0;
+        }
+    }
+
+    void Profiler::setEnabled(bool enabled) {
+        this->enabled.store(enabled);
+    }
+
+    int64_t Profiler::microseconds(Clock::time_point t) const {
+        return std::chrono::duration_cast<std::chrono::microseconds>(t - origin).count();
+    }
+
+    void Profiler::record(ProfileStage stage, Clock::time_point start, Clock::time_point end) {
+        int64_t nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+        stageNanoseconds[(size_t)stage].fetch_add(nanoseconds, std::memory_order_relaxed);
+
+        if (capturing.load(std::memory_order_relaxed)) {
+            TraceEvent event;
+            event.name = profileStageName(stage);
+            event.thread = traceThreadId();
+            event.counter = false;
+            event.start = microseconds(start);
+            event.duration = std::max<int64_t>(microseconds(end) - event.start, 0);
+            event.value = 0.0;
+
+            std::lock_guard<std::mutex> lock(traceMutex);
+            trace.push_back(event);
+        }
+    }
+
+    void Profiler::endFrame() {
+        Clock::time_point now = Clock::now();
+        frameTimes[frameCount % FRAME_HISTORY] = std::chrono::duration<float, std::milli>(now - frameStart).count();
+        frameCount++;
+        frameStart = now;
+
+        for (size_t s = 0; s < (size_t)ProfileStage::Count; s++) {
+            lastStageTimes[s] = (double)stageNanoseconds[s].exchange(0) * 1e-6;
+        }
+    }
+
+    double Profiler::getStageTime(ProfileStage stage) const {
+        return lastStageTimes[(size_t)stage];
+    }
+
+    double Profiler::getLastFrameTime() const {
+        return frameCount ? frameTimes[(frameCount - 1) % FRAME_HISTORY] : 0.0;
+    }
+
+    std::vector<float> Profiler::getFrameTimes() const {
+        size_t count = std::min(frameCount, FRAME_HISTORY);
+        std::vector<float> times;
+        times.reserve(count);
+        for (size_t i = frameCount - count; i < frameCount; i++) {
+            times.push_back(frameTimes[i % FRAME_HISTORY]);
+        }
+        return times;
+    }
+
+    FrameTimeSummary Profiler::getFrameTimeSummary() const {
+        std::vector<float> times = getFrameTimes();
+        FrameTimeSummary summary;
+        summary.frames = times.size();
+        if (times.empty()) {
+            return summary;
+        }
+
+        double total = 0.0;
+        for (float t : times) {
+            total += t;
+        }
+        std::sort(times.begin(), times.end());
+        auto percentile = [&](double q) { return (double)times[(size_t)(q * (double)(times.size() - 1) + 0.5)]; };
+
+        summary.min = times.front();
+        summary.mean = total / (double)times.size();
+        summary.p50 = percentile(0.5);
+        summary.p95 = percentile(0.95);
+        summary.p99 = percentile(0.99);
+        summary.max = times.back();
+        return summary;
+    }
+
+    std::vector<uint32_t> Profiler::getFrameTimeHistogram(size_t buckets, double bucketMilliseconds) const {
+        std::vector<uint32_t> counts(buckets, 0);
+        if (buckets == 0) {
+            return counts;
+        }
+        for (float t : getFrameTimes()) {
+            size_t bucket = (size_t)std::max(0.0, (double)t / bucketMilliseconds);
+            counts[std::min(bucket, buckets - 1)]++;
+        }
+        return counts;
+    }
+
+    void Profiler::startCapture() {
+        std::lock_guard<std::mutex> lock(traceMutex);
+        trace.clear();
+        capturing.store(true);
+    }
+
+    void Profiler::stopCapture() {
+        capturing.store(false);
+    }
+
+    void Profiler::addCounterSample(const char* name, double value) {
+        if (!capturing.load(std::memory_order_relaxed)) {
+            return;
+        }
+
+        TraceEvent event;
+        event.name = name;
+        event.thread = traceThreadId();
+        event.counter = true;
+        event.start = microseconds(Clock::now());
+        event.duration = 0;
+        event.value = value;
+
+        std::lock_guard<std::mutex> lock(traceMutex);
+        trace.push_back(event);
+    }
+
+    bool Profiler::writeChromeTrace(const std::string& filename) const {
+        FILE* out = fopen(filename.c_str(), "w");
+        if (!out) {
+            return false;
+        }
+
+        // Trace Event Format: complete events ("X") for scopes, counter events ("C")
+        std::lock_guard<std::mutex> lock(traceMutex);
+        fprintf(out, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+        for (size_t i = 0; i < trace.size(); i++) {
+            const TraceEvent& event = trace[i];
+            if (event.counter) {
+                fprintf(out, "{\"name\": \"%s\", \"ph\": \"C\", \"ts\": %lld, \"pid\": 1, \"args\": {\"value\": %.17g}}",
+                        event.name, (long long)event.start, event.value);
+            } else {
+                fprintf(out, "{\"name\": \"%s\", \"ph\": \"X\", \"ts\": %lld, \"dur\": %lld, \"pid\": 1, \"tid\": %u}",
+                        event.name, (long long)event.start, (long long)event.duration, event.thread);
+            }
+            fprintf(out, "%s\n", i + 1 < trace.size() ? "," : "");
+        }
+        fprintf(out, "]}\n");
+        return fclose(out) == 0;
+    }
+}
@@ -0,0 +1,106 @@
+#include "../include/radixsort.h"
+#include <algorithm>
+#include <vector>
+
+namespace Engine3D {
+
+    namespace {
+        const int RADIX_BITS = 11;
+        const int PASSES = 3;
+        const size_t BUCKETS = (size_t)1 << RADIX_BITS;
+        const uint32_t DIGIT_MASK = (uint32_t)BUCKETS - 1;
+
+        // Smallest block worth handing to another thread
+        const size_t MIN_BLOCK = (size_t)1 << 16;
+    }
+
+    uint64_t* radixSortByKey(uint64_t* items, uint64_t* scratch, size_t count, ThreadPool* pool) {
+        size_t blockCount = 1;
+        if (pool && pool->getThreadCount() > 1 && count >= 2 * MIN_BLOCK) {
+            blockCount = std::min(count / MIN_BLOCK, (size_t)pool->getThreadCount() * 2);
+        }
+        size_t blockSize = (count + blockCount - 1) / blockCount;
+
+        auto forEachBlock = [&](const std::function<void(size_t)>& task) {
+            if (blockCount == 1) {
+                task(0);
+            } else {
+                pool->parallelFor(blockCount, task);
+            }
+        };
+
+        // Per block and pass digit counts, kept between calls so sorting every frame
+        // does not allocate. The reference lets the pool threads see this thread's copy.
+        static thread_local std::vector<uint32_t> countStorage;
+        std::vector<uint32_t>& counts = countStorage;
+        counts.assign(blockCount * PASSES * BUCKETS, 0);
+
+        // A single read builds the histograms of every pass
+        forEachBlock([&](size_t block) {
+            uint32_t* histogram = &counts[block * PASSES * BUCKETS];
+            size_t end = std::min(count, (block + 1) * blockSize);
+            for (size_t i = block * blockSize; i < end; i++) {
+                uint32_t key = (uint32_t)(items[i] >> 32);
+                for (int pass = 0; pass < PASSES; pass++) {
+                    histogram[pass * BUCKETS + ((key >> (pass * RADIX_BITS)) & DIGIT_MASK)]++;
+                }
+            }
+        });
+
+        uint64_t* source = items;
+        uint64_t* target = scratch;
+        bool reordered = false;
+        for (int pass = 0; pass < PASSES; pass++) {
+            // Nothing to reorder if every key shares this digit
+            bool uniform = false;
+            for (size_t digit = 0; digit < BUCKETS && !uniform; digit++) {
+                size_t digitCount = 0;
+                for (size_t block = 0; block < blockCount; block++) {
+                    digitCount += counts[(block * PASSES + pass) * BUCKETS + digit];
+                }
+                uniform = digitCount == count;
+            }
+            if (uniform) {
+                continue;
+            }
+
+            // Once the items have been reordered the blocks hold different keys, so
+            // with several blocks this pass is counted again
+            int shift = 32 + pass * RADIX_BITS;
+            if (reordered && blockCount > 1) {
+                forEachBlock([&](size_t block) {
+                    uint32_t* histogram = &counts[(block * PASSES + pass) * BUCKETS];
+                    std::fill(histogram, histogram + BUCKETS, 0u);
+                    size_t end = std::min(count, (block + 1) * blockSize);
+                    for (size_t i = block * blockSize; i < end; i++) {
+                        histogram[(source[i] >> shift) & DIGIT_MASK]++;
+                    }
+                });
+            }
+
+            // Counts become scatter offsets, digit-major and then in block order so
+            // equal keys keep their relative order
+            uint32_t offset = 0;
+            for (size_t digit = 0; digit < BUCKETS; digit++) {
+                for (size_t block = 0; block < blockCount; block++) {
+                    uint32_t& slot = counts[(block * PASSES + pass) * BUCKETS + digit];
+                    uint32_t digitCount = slot;
+                    slot = offset;
+                    offset += digitCount;
+                }
+            }
+
+            forEachBlock([&](size_t block) {
+                uint32_t* offsets = &counts[(block * PASSES + pass) * BUCKETS];
+                size_t end = std::min(count, (block + 1) * blockSize);
+                for (size_t i = block * blockSize; i < end; i++) {
+                    uint64_t item = source[i];
+                    target[offsets[(item >> shift) & DIGIT_MASK]++] = item;
+                }
+            });
+            std::swap(source, target);
+            reordered = true;
+        }
+        return source;
+    }
+}
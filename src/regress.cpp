@@ -0,0 +1,415 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include "../include/engine.h"
+#include "../include/camera.h"
+#include "../include/imagewriter.h"
+#include "../include/scene.h"
+#include "../include/texture.h"
+#include "../graphics/renderer.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#ifndef ENGINE_SOURCE_DIR
+#define ENGINE_SOURCE_DIR "."
+#endif
+
+using namespace Engine3D;
+using namespace std;
+
+// Image regression check of the renderer: draws a fixed set of scenes with fixed
+// cameras and compares them to golden images, so optimizations can show that they
+// leave the output alone. Every scene is drawn on one thread and again on several,
+// plainly, pipelined and incrementally, and all of these must match bit for bit;
+// the single-threaded image is then compared to the golden one within a tolerance.
+//
+// Usage: render_regress [options] [scene...]
+//   --golden dir       golden images, <scene>.png (default golden/ of the source tree)
+//   --update           write the golden images instead of comparing against them
+//   --tolerance N      largest channel difference a pixel may have (default 2)
+//   --max-pixels N     pixels allowed beyond the tolerance (default 0)
+//   --output dir       write the image and a difference image of failing scenes
+//   --threads N        threads of the multithreaded runs, 0 for all cores (default)
+//   --obj file         the tetrahedron (default tetrahedron.obj of the source tree)
+//   --list             print the scene names and exit
+//
+// Only the scenes named on the command line are drawn, all of them by default.
+// Exits with 1 when any scene fails.
+
+namespace {
+    const int WIDTH = 320;
+    const int HEIGHT = 240;
+
+    // Scenes are drawn at this time, after one earlier frame for the modes whose
+    // frames depend on the one before
+    const float TIME = 1.0f;
+    const float PREVIOUS_TIME = 0.9f;
+
+    struct Options {
+        vector<string> scenes;
+        string goldenDir = ENGINE_SOURCE_DIR "/golden";
+        bool update = false;
+        int tolerance = 2;
+        size_t maxPixels = 0;
+        string outputDir;
+        unsigned threads = 0;
+        string objPath = ENGINE_SOURCE_DIR "/tetrahedron.obj";
+        bool list = false;
+    };
+
+    struct Assets {
+        shared_ptr<mesh> cube;          // with vertex and face normals and edges
+        shared_ptr<mesh> texturedCube;  // the cube with a checker texture
+        shared_ptr<mesh> tetrahedron;   // with vertex normals only
+        matrix4x4 tetrahedronCenter;    // moves the tetrahedron's bounds to the origin
+    };
+
+    // A fixed picture: renderer settings and what to draw at a given time
+    struct TestScene {
+        const char* name;
+        ShadingMode shading;
+        bool painter;
+        bool antialiasedLines;
+        void (*draw)(Renderer& renderer, const Assets& assets, float time);
+    };
+
+    // Ways of running the renderer that must all give the same image
+    struct Mode {
+        const char* name;
+        bool multithreaded;
+        bool pipelined;
+        bool incremental;
+    };
+
+    const Mode MODES[] = {
+        { "single-threaded", false, false, false },
+        { "multithreaded", true, false, false },
+        { "pipelined", true, true, false },
+        { "incremental", true, false, true },
+    };
+
+    Camera makeCamera(const vec3d& position, float fov, float zNear) {
+        Camera camera((float)WIDTH, (float)HEIGHT);
+        camera.position = position;
+        camera.lookAt(vec3d(0.0f, 0.0f, 0.0f));
+        camera.fov = fov;
+        camera.zNear = zNear;
+        camera.zFar = 100.0f;
+        return camera;
+    }
+
+    // The unit cube scaled and centered on the origin, then turned with time
+    matrix4x4 cubeModel(float scale, float time) {
+        matrix4x4 center, scaling, rotX, rotY;
+        createTranslationMatrix(center, -0.5f, -0.5f, -0.5f);
+        scaling.m[0][0] = scale;
+        scaling.m[1][1] = scale;
+        scaling.m[2][2] = scale;
+        scaling.m[3][3] = 1.0f;
+        createRotationMatrixY(rotY, 0.7f * time);
+        createRotationMatrixX(rotX, 0.5f * time);
+        return center * scaling * rotY * rotX;
+    }
+
+    void drawCube(Renderer& renderer, const Assets& assets, float time) {
+        renderer.drawMesh(*assets.cube, cubeModel(1.0f, time), makeCamera(vec3d(0.0f, 0.0f, -2.5f), 60.0f, 0.1f));
+    }
+
+    void drawTexturedCube(Renderer& renderer, const Assets& assets, float time) {
+        renderer.drawMesh(*assets.texturedCube, cubeModel(1.0f, time), makeCamera(vec3d(0.0f, 0.0f, -2.5f), 60.0f, 0.1f));
+    }
+
+    // A large cube whose nearest corner reaches past the near plane and the camera,
+    // with sides running far off screen
+    void drawClippedCube(Renderer& renderer, const Assets& assets, float time) {
+        renderer.drawMesh(*assets.cube, cubeModel(2.0f, time), makeCamera(vec3d(0.2f, -0.1f, -2.0f), 100.0f, 0.5f));
+    }
+
+    // Turned upside down around x, since the OBJ is y-up
+    void drawTetrahedron(Renderer& renderer, const Assets& assets, float time) {
+        matrix4x4 flip, spin;
+        createRotationMatrixX(flip, (float)M_PI + 0.6f * time);
+        createRotationMatrixY(spin, 2.0f * time);
+        renderer.drawMesh(*assets.tetrahedron, assets.tetrahedronCenter * flip * spin,
+                          makeCamera(vec3d(0.0f, -0.4f, -2.0f), 45.0f, 0.1f));
+    }
+
+    // The demo's spinning grid of cube instances, overlapping in depth
+    void drawGrid(Renderer& renderer, const Assets& assets, float time) {
+        Scene scene;
+        uint32_t cube = scene.addMesh(assets.cube);
+        matrix4x4 spin, distance, rotX, rotZ;
+        createRotationMatrixZ(spin, 0.25f * time);
+        createTranslationMatrix(distance, 0.0f, 0.0f, 5.0f);
+        Scene::NodeId group = scene.addNode(Scene::NONE, spin * distance);
+        createRotationMatrixX(rotX, time);
+        createRotationMatrixZ(rotZ, time);
+        for (int i = 0; i < 9; i++) {
+            matrix4x4 offset;
+            createTranslationMatrix(offset, (i % 3 - 1) * 1.2f, (i / 3 - 1) * 1.2f, (i % 2) * 1.5f);
+            scene.addNode(cube, rotZ * rotX * offset, group);
+        }
+        scene.updateTransforms();
+
+        Camera camera((float)WIDTH, (float)HEIGHT);
+        renderer.drawScene(scene, camera);
+    }
+
+    // Lit cube with its edges over it, and the tetrahedron's triangle sides
+    void drawWireframes(Renderer& renderer, const Assets& assets, float time) {
+        Camera camera = makeCamera(vec3d(0.0f, 0.0f, -3.0f), 60.0f, 0.1f);
+        matrix4x4 model = cubeModel(1.0f, time);
+        renderer.drawMesh(*assets.cube, model, camera);
+        renderer.drawWireframe(*assets.cube, model, camera, RGB::GREEN);
+
+        matrix4x4 flip, offset;
+        createRotationMatrixX(flip, (float)M_PI + 0.5f * time);
+        createTranslationMatrix(offset, 0.9f, 0.3f, -0.5f);
+        renderer.drawWireframe(*assets.tetrahedron, assets.tetrahedronCenter * flip * offset, camera, RGB::WHITE);
+    }
+
+    const TestScene SCENES[] = {
+        { "cube_flat", ShadingMode::Flat, false, false, drawCube },
+        { "cube_gouraud", ShadingMode::Gouraud, false, false, drawCube },
+        { "cube_phong", ShadingMode::Phong, false, false, drawCube },
+        { "cube_textured", ShadingMode::Gouraud, false, false, drawTexturedCube },
+        { "cube_clipped", ShadingMode::Phong, false, false, drawClippedCube },
+        { "tetrahedron_flat", ShadingMode::Flat, false, false, drawTetrahedron },
+        { "tetrahedron_gouraud", ShadingMode::Gouraud, false, false, drawTetrahedron },
+        { "tetrahedron_phong", ShadingMode::Phong, false, false, drawTetrahedron },
+        { "grid", ShadingMode::Phong, false, false, drawGrid },
+        { "grid_painter", ShadingMode::Flat, true, false, drawGrid },
+        { "wireframe", ShadingMode::Flat, false, false, drawWireframes },
+        { "wireframe_smooth", ShadingMode::Flat, false, true, drawWireframes },
+    };
+
+    bool loadAssets(const Options& options, Assets& assets) {
+        assets.cube = make_shared<mesh>();
+        populateCube(*assets.cube);
+        assets.cube->computeVertexNormals();
+        assets.cube->computeFaceNormals();
+        assets.cube->computeEdges();
+
+        // Texture coordinates sheared by depth, so no side of the cube is uniform
+        assets.texturedCube = make_shared<mesh>(*assets.cube);
+        for (size_t i = 0; i < assets.cube->vertices.size(); i++) {
+            vec3d v = assets.cube->vertices.get(i);
+            assets.texturedCube->texCoords.push_back(v.x + 0.5f * v.z, v.y + 0.5f * v.z);
+        }
+        shared_ptr<Texture> checker = make_shared<Texture>();
+        createCheckerTexture(*checker, 64, 8, 0xFFFFFFFFu, 0xFF3060C0u);
+        assets.texturedCube->texture = checker;
+
+        // Parsed on every run rather than through a mesh cache, which would write
+        // into the source tree
+        assets.tetrahedron = make_shared<mesh>();
+        if (!assets.tetrahedron->loadFromObjectFile(options.objPath, false)) {
+            cerr << "could not load " << options.objPath << endl;
+            return false;
+        }
+        vec3d center = computeBounds(*assets.tetrahedron).center();
+        createTranslationMatrix(assets.tetrahedronCenter, -center.x, -center.y, -center.z);
+        return true;
+    }
+
+    vector<uint32_t> render(const TestScene& scene, const Assets& assets, const Mode& mode, unsigned threads) {
+        Renderer renderer(WIDTH, HEIGHT, true);
+        renderer.init();
+        renderer.setThreadCount(mode.multithreaded ? threads : 1);
+        renderer.setPipelinedFrames(mode.pipelined);
+        renderer.setIncrementalRendering(mode.incremental);
+        renderer.setShadingMode(scene.shading);
+        renderer.setPainterMode(scene.painter);
+        renderer.setLineAntialiasing(scene.antialiasedLines);
+
+        // A frame in flight or tiles kept from the frame before are what these
+        // modes get wrong, so they get a frame before
+        if (mode.pipelined || mode.incremental) {
+            renderer.clear();
+            scene.draw(renderer, assets, PREVIOUS_TIME);
+            renderer.present();
+        }
+        renderer.clear();
+        scene.draw(renderer, assets, TIME);
+        renderer.present();
+        renderer.finish();
+
+        vector<uint32_t> image = renderer.getFrameBuffer().color;
+        renderer.cleanup();
+        return image;
+    }
+
+    int channelDifference(uint32_t a, uint32_t b) {
+        int largest = 0;
+        for (int shift = 0; shift < 24; shift += 8) {
+            largest = max(largest, abs((int)((a >> shift) & 0xFF) - (int)((b >> shift) & 0xFF)));
+        }
+        return largest;
+    }
+
+    // Pixels differing by more than the tolerance, and the largest difference
+    struct Difference {
+        size_t pixels = 0;
+        int largest = 0;
+    };
+
+    Difference compare(const vector<uint32_t>& image, const vector<uint32_t>& golden, int tolerance) {
+        Difference difference;
+        for (size_t i = 0; i < image.size(); i++) {
+            int d = channelDifference(image[i], golden[i]);
+            difference.largest = max(difference.largest, d);
+            difference.pixels += d > tolerance;
+        }
+        return difference;
+    }
+
+    // The golden image darkened, with pixels beyond the tolerance in red and those
+    // within it in yellow
+    vector<uint32_t> differenceImage(const vector<uint32_t>& image, const vector<uint32_t>& golden, int tolerance) {
+        vector<uint32_t> out(image.size());
+        for (size_t i = 0; i < image.size(); i++) {
+            int d = channelDifference(image[i], golden[i]);
+            if (d > tolerance) {
+                out[i] = 0xFFFF0000u;
+            } else if (d > 0) {
+                out[i] = 0xFFFFFF00u;
+            } else {
+                out[i] = 0xFF000000u | ((golden[i] >> 2) & 0x3F3F3F);
+            }
+        }
+        return out;
+    }
+
+    // Checks one scene and prints a line about it, returning whether it passed
+    bool runScene(const TestScene& scene, const Assets& assets, const Options& options, unsigned threads) {
+        string status;
+        bool passed = true;
+
+        vector<uint32_t> image = render(scene, assets, MODES[0], 1);
+        for (size_t m = 1; m < sizeof(MODES) / sizeof(MODES[0]); m++) {
+            vector<uint32_t> other = render(scene, assets, MODES[m], threads);
+            Difference difference = compare(other, image, 0);
+            if (difference.pixels) {
+                status += string(MODES[m].name) + " differs in " + to_string(difference.pixels) + " pixels, ";
+                passed = false;
+            }
+        }
+
+        string goldenPath = options.goldenDir + "/" + scene.name + ".png";
+        vector<uint32_t> golden;
+        int width = 0, height = 0;
+        if (options.update) {
+            if (!writePNG(goldenPath, image.data(), WIDTH, HEIGHT)) {
+                status += "could not write " + goldenPath;
+                passed = false;
+            } else {
+                status += "written";
+            }
+        } else if (!readPNG(goldenPath, golden, width, height)) {
+            status += "no golden image " + goldenPath;
+            passed = false;
+        } else if (width != WIDTH || height != HEIGHT) {
+            status += "golden image is " + to_string(width) + "x" + to_string(height);
+            passed = false;
+        } else {
+            Difference difference = compare(image, golden, options.tolerance);
+            if (difference.pixels > options.maxPixels) {
+                status += to_string(difference.pixels) + " pixels differ from the golden image, by up to " +
+                          to_string(difference.largest);
+                passed = false;
+            } else {
+                status += difference.largest ? "ok, within " + to_string(difference.largest) : "ok";
+            }
+        }
+
+        if (!passed && !options.outputDir.empty()) {
+            string stem = options.outputDir + "/" + scene.name;
+            bool written = writePNG(stem + ".png", image.data(), WIDTH, HEIGHT);
+            if (golden.size() == image.size()) {
+                written = writePNG(stem + "_diff.png", differenceImage(image, golden, options.tolerance).data(), WIDTH, HEIGHT) && written;
+            }
+            if (!written) {
+                cerr << "could not write to " << options.outputDir << endl;
+            }
+        }
+
+        printf("%-20s %s\n", scene.name, status.c_str());
+        return passed;
+    }
+
+    bool parseOptions(int argc, char** argv, Options& options) {
+        for (int i = 1; i < argc; i++) {
+            string arg = argv[i];
+            bool hasValue = i + 1 < argc;
+            if (arg == "--golden" && hasValue) {
+                options.goldenDir = argv[++i];
+            } else if (arg == "--update") {
+                options.update = true;
+            } else if (arg == "--tolerance" && hasValue) {
+                options.tolerance = max(0, atoi(argv[++i]));
+            } else if (arg == "--max-pixels" && hasValue) {
+                options.maxPixels = (size_t)max(0, atoi(argv[++i]));
+            } else if (arg == "--output" && hasValue) {
+                options.outputDir = argv[++i];
+            } else if (arg == "--threads" && hasValue) {
+                options.threads = (unsigned)atoi(argv[++i]);
+            } else if (arg == "--obj" && hasValue) {
+                options.objPath = argv[++i];
+            } else if (arg == "--list") {
+                options.list = true;
+            } else if (arg.size() > 2 && arg.compare(0, 2, "--") == 0) {
+                return false;
+            } else {
+                options.scenes.push_back(arg);
+            }
+        }
+        return true;
+    }
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        cerr << "usage: render_regress [--golden dir] [--update] [--tolerance N] [--max-pixels N]\n"
+                "                      [--output dir] [--threads N] [--obj file.obj] [--list] [scene...]" << endl;
+        return 1;
+    }
+
+    vector<const TestScene*> selected;
+    for (const TestScene& scene : SCENES) {
+        if (options.list) {
+            printf("%s\n", scene.name);
+        }
+        if (options.scenes.empty() || find(options.scenes.begin(), options.scenes.end(), scene.name) != options.scenes.end()) {
+            selected.push_back(&scene);
+        }
+    }
+    if (options.list) {
+        return 0;
+    }
+    if (selected.size() < options.scenes.size()) {
+        cerr << "unknown scene name, see --list" << endl;
+        return 1;
+    }
+
+    Assets assets;
+    if (!loadAssets(options, assets)) {
+        return 1;
+    }
+
+    // Several threads even on a single core, so the multithreaded paths are taken
+    unsigned threads = options.threads ? options.threads : max(2u, thread::hardware_concurrency());
+
+    size_t failures = 0;
+    for (const TestScene* scene : selected) {
+        failures += !runScene(*scene, assets, options, threads);
+    }
+    printf("%zu of %zu scenes passed, multithreaded runs on %u threads\n", selected.size() - failures, selected.size(), threads);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,70 @@
+#include "../include/scene.h"
+#include <cstring>
+
+namespace Engine3D {
+
+    AABB computeBounds(const mesh& m) {
+        if (m.bvh && !m.bvh->empty()) {
+            return m.bvh->bounds();
+        }
+
+        AABB bounds;
+        for (size_t i = 0; i < m.vertices.size(); i++) {
+            bounds.expand(m.vertices.get(i));
+        }
+        return bounds;
+    }
+
+    uint32_t Scene::addMesh(std::shared_ptr<const mesh> source) {
+        MeshEntry entry;
+        entry.bounds = computeBounds(*source);
+        entry.source = std::move(source);
+        meshes.push_back(std::move(entry));
+        version++;
+        return (uint32_t)(meshes.size() - 1);
+    }
+
+    void Scene::markMeshChanged(uint32_t meshIndex) {
+        meshes[meshIndex].bounds = computeBounds(*meshes[meshIndex].source);
+        version++;
+    }
+
+    Scene::NodeId Scene::addNode(uint32_t meshIndex, const matrix4x4& local, NodeId parent) {
+        Node node;
+        node.local = local;
+        node.world = parent == NONE ? local : local * nodes[parent].world;
+        node.parent = parent;
+        node.meshIndex = meshIndex;
+        nodes.push_back(node);
+        version++;
+        return (NodeId)(nodes.size() - 1);
+    }
+
+    void Scene::setTransform(NodeId node, const matrix4x4& local) {
+        if (std::memcmp(nodes[node].local.m, local.m, sizeof(local.m)) == 0) {
+            return;
+        }
+        nodes[node].local = local;
+        dirty = true;
+        version++;
+    }
+
+    void Scene::updateTransforms() {
+        if (!dirty) {
+            return;
+        }
+
+        // Row vectors: the node's own transform applies first, then its parent's
+        for (Node& node : nodes) {
+            node.world = node.parent == NONE ? node.local : node.local * nodes[node.parent].world;
+        }
+        dirty = false;
+    }
+
+    void Scene::clear() {
+        meshes.clear();
+        nodes.clear();
+        dirty = false;
+        version++;
+    }
+}
@@ -0,0 +1,414 @@
+#include "../include/simplify.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <queue>
+#include <unordered_map>
+
+namespace Engine3D {
+
+    namespace {
+        // Cosine of the largest turn a collapse may give a face's normal
+        const double MIN_NORMAL_COSINE = 0.5;
+
+        // Symmetric 4 x 4 matrix whose quadratic form is the weighted sum of squared
+        // distances to a set of planes, plus the total weight of the planes
+        struct Quadric {
+            double a2 = 0, ab = 0, ac = 0, ad = 0, b2 = 0, bc = 0, bd = 0, c2 = 0, cd = 0, d2 = 0;
+            double weight = 0;
+
+            void addPlane(double a, double b, double c, double d, double w) {
+                a2 += w * a * a; ab += w * a * b; ac += w * a * c; ad += w * a * d;
+                b2 += w * b * b; bc += w * b * c; bd += w * b * d;
+                c2 += w * c * c; cd += w * c * d;
+                d2 += w * d * d;
+                weight += w;
+            }
+
+            void add(const Quadric& q) {
+                a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad;
+                b2 += q.b2; bc += q.bc; bd += q.bd;
+                c2 += q.c2; cd += q.cd;
+                d2 += q.d2;
+                weight += q.weight;
+            }
+
+            double evaluate(const vec3d& p) const {
+                double x = p.x, y = p.y, z = p.z;
+                double value = a2 * x * x + b2 * y * y + c2 * z * z + d2 +
+                               2.0 * (ab * x * y + ac * x * z + bc * y * z + ad * x + bd * y + cd * z);
+                return std::max(0.0, value);
+            }
+        };
+
+        struct Collapse {
+            double cost;
+            uint32_t from, to;
+            uint32_t fromVersion, toVersion;
+
+            bool operator>(const Collapse& o) const { return cost > o.cost; }
+        };
+
+        struct PositionKey {
+            uint32_t x, y, z;
+            bool operator==(const PositionKey& o) const { return x == o.x && y == o.y && z == o.z; }
+        };
+
+        struct PositionKeyHash {
+            size_t operator()(const PositionKey& k) const {
+                uint64_t h = ((uint64_t)k.x * 0x9E3779B97F4A7C15ull) ^ ((uint64_t)k.y * 0xC2B2AE3D27D4EB4Full) ^ k.z;
+                return (size_t)(h ^ (h >> 31));
+            }
+        };
+
+        inline uint64_t edgeKey(uint32_t a, uint32_t b) {
+            return a < b ? ((uint64_t)a << 32) | b : ((uint64_t)b << 32) | a;
+        }
+
+        vec3d faceNormal(const vec3d& p0, const vec3d& p1, const vec3d& p2) {
+            return (p1 - p0).cross(p2 - p0);
+        }
+
+        class Simplifier {
+            public:
+                explicit Simplifier(const mesh& source);
+                float run(size_t targetTriangles);
+                void output(const mesh& source, mesh& result) const;
+
+            private:
+                std::vector<vec3d> positions;
+                std::vector<uint32_t> positionOf;  // vertices at the same point share one
+                std::vector<Quadric> quadrics;     // per position
+                std::vector<uint8_t> locked;       // never moved, only collapsed onto
+                std::vector<uint8_t> vertexAlive;
+                std::vector<uint32_t> version;     // bumped whenever a vertex's quadric grows
+
+                std::vector<uint32_t> indices;     // rewritten by the collapses
+                std::vector<uint8_t> triangleAlive;
+                std::vector<std::vector<uint32_t>> trianglesOf;  // may hold dead triangles
+                size_t liveTriangles;
+
+                std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> heap;
+                std::vector<uint32_t> scratchA, scratchB;
+
+                bool contains(uint32_t t, uint32_t v) const {
+                    return indices[t * 3] == v || indices[t * 3 + 1] == v || indices[t * 3 + 2] == v;
+                }
+                size_t sharedTriangles(uint32_t from, uint32_t to) const;
+                void neighbors(uint32_t v, std::vector<uint32_t>& out) const;
+                void push(uint32_t from, uint32_t to);
+                bool valid(const Collapse& c);
+                void apply(const Collapse& c);
+        };
+
+        Simplifier::Simplifier(const mesh& source) {
+            size_t vertexCount = source.vertices.size();
+            positions.resize(vertexCount);
+            positionOf.resize(vertexCount);
+            std::unordered_map<PositionKey, uint32_t, PositionKeyHash> ids;
+            std::vector<uint32_t> wedges;
+            for (size_t i = 0; i < vertexCount; i++) {
+                positions[i] = source.vertices.get(i);
+                PositionKey key;
+                std::memcpy(&key.x, &positions[i].x, sizeof(float));
+                std::memcpy(&key.y, &positions[i].y, sizeof(float));
+                std::memcpy(&key.z, &positions[i].z, sizeof(float));
+                auto found = ids.emplace(key, (uint32_t)wedges.size()).first;
+                if (found->second == wedges.size()) {
+                    wedges.push_back(0);
+                }
+                positionOf[i] = found->second;
+                wedges[found->second]++;
+            }
+
+            // Degenerate index triples are dropped up front
+            size_t triangleCount = source.triangleCount();
+            indices.assign(source.indices.begin(), source.indices.end());
+            triangleAlive.assign(triangleCount, 1);
+            trianglesOf.resize(vertexCount);
+            liveTriangles = 0;
+            std::unordered_map<uint64_t, uint32_t> edgeUses;
+            for (size_t t = 0; t < triangleCount; t++) {
+                const uint32_t* v = &indices[t * 3];
+                if (v[0] == v[1] || v[1] == v[2] || v[2] == v[0]) {
+                    triangleAlive[t] = 0;
+                    continue;
+                }
+                liveTriangles++;
+                for (int k = 0; k < 3; k++) {
+                    trianglesOf[v[k]].push_back((uint32_t)t);
+                    edgeUses[edgeKey(positionOf[v[k]], positionOf[v[(k + 1) % 3]])]++;
+                }
+            }
+
+            // Face planes weighted by area. Vertices on open borders, on edges shared
+            // by more than two faces or split along a seam stay where they are, so
+            // pieces that only touch along a border never open up between each other.
+            quadrics.resize(wedges.size());
+            std::vector<uint8_t> lockedPosition(wedges.size(), 0);
+            for (size_t t = 0; t < triangleCount; t++) {
+                if (!triangleAlive[t]) {
+                    continue;
+                }
+                const uint32_t* v = &indices[t * 3];
+                for (int k = 0; k < 3; k++) {
+                    uint32_t a = positionOf[v[k]], b = positionOf[v[(k + 1) % 3]];
+                    if (edgeUses[edgeKey(a, b)] != 2) {
+                        lockedPosition[a] = lockedPosition[b] = 1;
+                    }
+                }
+
+                vec3d normal = faceNormal(positions[v[0]], positions[v[1]], positions[v[2]]);
+                double length = std::sqrt((double)normal.x * normal.x + (double)normal.y * normal.y + (double)normal.z * normal.z);
+                if (length == 0.0) {
+                    continue;
+                }
+                double nx = normal.x / length, ny = normal.y / length, nz = normal.z / length;
+                double d = -(nx * positions[v[0]].x + ny * positions[v[0]].y + nz * positions[v[0]].z);
+                for (int k = 0; k < 3; k++) {
+                    quadrics[positionOf[v[k]]].addPlane(nx, ny, nz, d, 0.5 * length);
+                }
+            }
+
+            locked.resize(vertexCount);
+            for (size_t i = 0; i < vertexCount; i++) {
+                locked[i] = wedges[positionOf[i]] > 1 || lockedPosition[positionOf[i]];
+            }
+            vertexAlive.assign(vertexCount, 1);
+            version.assign(vertexCount, 0);
+
+            for (size_t t = 0; t < triangleCount; t++) {
+                if (triangleAlive[t]) {
+                    for (int k = 0; k < 3; k++) {
+                        push(indices[t * 3 + k], indices[t * 3 + (k + 1) % 3]);
+                        push(indices[t * 3 + (k + 1) % 3], indices[t * 3 + k]);
+                    }
+                }
+            }
+        }
+
+        size_t Simplifier::sharedTriangles(uint32_t from, uint32_t to) const {
+            size_t shared = 0;
+            for (uint32_t t : trianglesOf[from]) {
+                if (triangleAlive[t] && contains(t, to)) {
+                    shared++;
+                }
+            }
+            return shared;
+        }
+
+        void Simplifier::neighbors(uint32_t v, std::vector<uint32_t>& out) const {
+            out.clear();
+            for (uint32_t t : trianglesOf[v]) {
+                if (triangleAlive[t]) {
+                    for (int k = 0; k < 3; k++) {
+                        if (indices[t * 3 + k] != v) {
+                            out.push_back(indices[t * 3 + k]);
+                        }
+                    }
+                }
+            }
+            std::sort(out.begin(), out.end());
+            out.erase(std::unique(out.begin(), out.end()), out.end());
+        }
+
+        void Simplifier::push(uint32_t from, uint32_t to) {
+            if (locked[from]) {
+                return;
+            }
+            Quadric q = quadrics[positionOf[from]];
+            q.add(quadrics[positionOf[to]]);
+            heap.push(Collapse{ q.evaluate(positions[to]), from, to, version[from], version[to] });
+        }
+
+        bool Simplifier::valid(const Collapse& c) {
+            if (!vertexAlive[c.from] || !vertexAlive[c.to] ||
+                version[c.from] != c.fromVersion || version[c.to] != c.toVersion) {
+                return false;
+            }
+
+            // Still an edge
+            size_t shared = sharedTriangles(c.from, c.to);
+            if (shared == 0) {
+                return false;
+            }
+
+            // Link condition: the ends may only share the neighbors across the faces
+            // being removed, or the collapse would pinch the surface
+            neighbors(c.from, scratchA);
+            neighbors(c.to, scratchB);
+            size_t common = 0;
+            for (size_t i = 0, j = 0; i < scratchA.size() && j < scratchB.size(); ) {
+                if (scratchA[i] < scratchB[j]) {
+                    i++;
+                } else if (scratchB[j] < scratchA[i]) {
+                    j++;
+                } else {
+                    common++;
+                    i++;
+                    j++;
+                }
+            }
+            if (common != shared) {
+                return false;
+            }
+
+            // No remaining face may fold over or collapse to a sliver. Slivers have
+            // no reliable normal of their own, so faces are also held to the
+            // area weighted normal of the whole neighborhood.
+            vec3d around = { 0.0f, 0.0f, 0.0f };
+            for (uint32_t t : trianglesOf[c.from]) {
+                if (triangleAlive[t]) {
+                    around = around + faceNormal(positions[indices[t * 3]],
+                        positions[indices[t * 3 + 1]], positions[indices[t * 3 + 2]]);
+                }
+            }
+            for (uint32_t t : trianglesOf[c.from]) {
+                if (!triangleAlive[t] || contains(t, c.to)) {
+                    continue;
+                }
+                vec3d before[3], after[3];
+                for (int k = 0; k < 3; k++) {
+                    uint32_t v = indices[t * 3 + k];
+                    before[k] = positions[v];
+                    after[k] = positions[v == c.from ? c.to : v];
+                }
+                vec3d n0 = faceNormal(before[0], before[1], before[2]).normalize();
+                vec3d n1 = faceNormal(after[0], after[1], after[2]).normalize();
+                if ((n0.dot(n0) > 0.0f && n0.dot(n1) < MIN_NORMAL_COSINE) || n1.dot(around) <= 0.0f) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        void Simplifier::apply(const Collapse& c) {
+            for (uint32_t t : trianglesOf[c.from]) {
+                if (!triangleAlive[t]) {
+                    continue;
+                }
+                if (contains(t, c.to)) {
+                    triangleAlive[t] = 0;
+                    liveTriangles--;
+                } else {
+                    for (int k = 0; k < 3; k++) {
+                        if (indices[t * 3 + k] == c.from) {
+                            indices[t * 3 + k] = c.to;
+                        }
+                    }
+                    trianglesOf[c.to].push_back(t);
+                }
+            }
+            trianglesOf[c.from].clear();
+            trianglesOf[c.from].shrink_to_fit();
+            vertexAlive[c.from] = 0;
+            quadrics[positionOf[c.to]].add(quadrics[positionOf[c.from]]);
+            version[c.to]++;
+
+            std::vector<uint32_t>& list = trianglesOf[c.to];
+            list.erase(std::remove_if(list.begin(), list.end(), [&](uint32_t t) { return !triangleAlive[t]; }), list.end());
+
+            // Every collapse into or out of the grown vertex has a new cost
+            neighbors(c.to, scratchA);
+            for (uint32_t v : scratchA) {
+                push(v, c.to);
+                push(c.to, v);
+            }
+        }
+
+        float Simplifier::run(size_t targetTriangles) {
+            double maxError = 0.0;
+            while (liveTriangles > targetTriangles && !heap.empty()) {
+                Collapse c = heap.top();
+                heap.pop();
+                if (!valid(c)) {
+                    continue;
+                }
+
+                Quadric merged = quadrics[positionOf[c.from]];
+                merged.add(quadrics[positionOf[c.to]]);
+                if (merged.weight > 0.0) {
+                    maxError = std::max(maxError, std::sqrt(c.cost / merged.weight));
+                }
+                apply(c);
+            }
+            return (float)maxError;
+        }
+
+        void Simplifier::output(const mesh& source, mesh& result) const {
+            result.vertices.clear();
+            result.normals.clear();
+            result.faceNormals.clear();
+            result.edges.clear();
+            result.texCoords.clear();
+            result.indices.clear();
+            result.lods.clear();
+            result.bvh.reset();
+            result.texture = source.texture;
+            result.position = source.position;
+
+            bool hasNormals = source.normals.size() == source.vertices.size();
+            bool hasTexCoords = source.texCoords.size() == source.vertices.size();
+            std::vector<uint32_t> remap(positions.size(), UINT32_MAX);
+            for (size_t t = 0; t < triangleAlive.size(); t++) {
+                if (!triangleAlive[t]) {
+                    continue;
+                }
+                uint32_t corner[3];
+                for (int k = 0; k < 3; k++) {
+                    uint32_t v = indices[t * 3 + k];
+                    if (remap[v] == UINT32_MAX) {
+                        remap[v] = (uint32_t)result.vertices.size();
+                        result.vertices.push_back(positions[v]);
+                        if (hasNormals) {
+                            result.normals.push_back(source.normals.get(v));
+                        }
+                        if (hasTexCoords) {
+                            result.texCoords.push_back(source.texCoords.u[v], source.texCoords.v[v]);
+                        }
+                    }
+                    corner[k] = remap[v];
+                }
+                result.addTriangle(corner[0], corner[1], corner[2]);
+            }
+        }
+    }
+
+    float simplifyMesh(const mesh& source, size_t targetTriangles, mesh& result) {
+        Simplifier simplifier(source);
+        float error = simplifier.run(targetTriangles);
+        simplifier.output(source, result);
+        return error;
+    }
+
+    void mesh::buildLODs(size_t minTriangles) {
+        lods.clear();
+        const mesh* previous = this;
+        float error = 0.0f;
+        while (previous->triangleCount() / 2 >= std::max<size_t>(minTriangles, 1)) {
+            std::shared_ptr<mesh> lod = std::make_shared<mesh>();
+            float stepError = simplifyMesh(*previous, previous->triangleCount() / 2, *lod);
+
+            // Seams and borders can stop the collapses early; a level barely smaller
+            // than the one before is not worth keeping
+            if (lod->triangleCount() * 10 > previous->triangleCount() * 9) {
+                break;
+            }
+
+            // Each level is simplified from the one before, so their errors add up
+            error += stepError;
+            if (bvh) {
+                lod->buildBVH();
+            }
+            if (!faceNormals.empty()) {
+                lod->computeFaceNormals();
+            }
+            if (!edges.empty()) {
+                lod->computeEdges();
+            }
+            lods.push_back(MeshLOD{ lod, error });
+            previous = lod.get();
+        }
+    }
+}
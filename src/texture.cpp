@@ -0,0 +1,129 @@
+#include "../include/texture.h"
+#include "../include/imagewriter.h"
+#include <algorithm>
+
+namespace Engine3D {
+
+    namespace {
+        // Largest side Texture::mortonIndex can address
+        const int MAX_SIZE = 1 << (Texture::MAX_LEVELS - 1);
+
+        int nextPowerOfTwo(int v) {
+            int p = 1;
+            while (p < v) p <<= 1;
+            return p;
+        }
+
+        int log2Exact(int v) {
+            int shift = 0;
+            while ((1 << shift) < v) shift++;
+            return shift;
+        }
+
+        // Average of up to four texels per channel, rounded
+        uint32_t average(const uint32_t* texels, int count) {
+            uint32_t sum[4] = { 0, 0, 0, 0 };
+            for (int i = 0; i < count; i++) {
+                for (int c = 0; c < 4; c++) {
+                    sum[c] += (texels[i] >> (c * 8)) & 0xFF;
+                }
+            }
+            uint32_t result = 0;
+            for (int c = 0; c < 4; c++) {
+                result |= ((sum[c] + count / 2) / count) << (c * 8);
+            }
+            return result;
+        }
+    }
+
+    bool Texture::create(const uint32_t* pixels, int width, int height) {
+        texels.clear();
+        levelCount = 0;
+        if (width <= 0 || height <= 0 || width > MAX_SIZE || height > MAX_SIZE) {
+            return false;
+        }
+
+        // Nearest resize to power of two sides
+        int w = nextPowerOfTwo(width), h = nextPowerOfTwo(height);
+        std::vector<uint32_t> level((size_t)w * h);
+        for (int y = 0; y < h; y++) {
+            const uint32_t* row = pixels + (size_t)((int64_t)y * height / h) * width;
+            for (int x = 0; x < w; x++) {
+                level[(size_t)y * w + x] = row[(int64_t)x * width / w];
+            }
+        }
+
+        // Each level halves both sides down to 1 x 1, averaging 2 x 2 texels, or 2
+        // once one side is down to a single texel
+        size_t total = 0;
+        for (int lw = w, lh = h; ; lw = std::max(1, lw / 2), lh = std::max(1, lh / 2)) {
+            total += (size_t)lw * lh;
+            if (lw == 1 && lh == 1) break;
+        }
+        texels.resize(total);
+
+        size_t offset = 0;
+        std::vector<uint32_t> next;
+        while (true) {
+            int shift = log2Exact(std::min(w, h));
+            levelOffset[levelCount] = (int32_t)offset;
+            levelWidth[levelCount] = w;
+            levelHeight[levelCount] = h;
+            levelShift[levelCount] = shift;
+            levelCount++;
+
+            for (int y = 0; y < h; y++) {
+                for (int x = 0; x < w; x++) {
+                    texels[offset + mortonIndex((uint32_t)x, (uint32_t)y, shift)] = level[(size_t)y * w + x];
+                }
+            }
+            offset += (size_t)w * h;
+            if (w == 1 && h == 1) {
+                break;
+            }
+
+            int nw = std::max(1, w / 2), nh = std::max(1, h / 2);
+            next.assign((size_t)nw * nh, 0);
+            for (int y = 0; y < nh; y++) {
+                for (int x = 0; x < nw; x++) {
+                    uint32_t block[4];
+                    int count = 0;
+                    for (int dy = 0; dy < (h > 1 ? 2 : 1); dy++) {
+                        for (int dx = 0; dx < (w > 1 ? 2 : 1); dx++) {
+                            block[count++] = level[(size_t)(y * (h > 1 ? 2 : 1) + dy) * w + x * (w > 1 ? 2 : 1) + dx];
+                        }
+                    }
+                    next[(size_t)y * nw + x] = average(block, count);
+                }
+            }
+            level.swap(next);
+            w = nw;
+            h = nh;
+        }
+
+        for (int l = levelCount; l < MAX_LEVELS; l++) {
+            levelOffset[l] = levelOffset[levelCount - 1];
+            levelWidth[l] = levelWidth[levelCount - 1];
+            levelHeight[l] = levelHeight[levelCount - 1];
+            levelShift[l] = levelShift[levelCount - 1];
+        }
+        return true;
+    }
+
+    bool Texture::loadFromFile(const std::string& filename) {
+        std::vector<uint32_t> pixels;
+        int width, height;
+        return readPPM(filename, pixels, width, height) && create(pixels.data(), width, height);
+    }
+
+    void createCheckerTexture(Texture& texture, int size, int squares, uint32_t colorA, uint32_t colorB) {
+        std::vector<uint32_t> pixels((size_t)size * size);
+        int square = std::max(1, size / std::max(1, squares));
+        for (int y = 0; y < size; y++) {
+            for (int x = 0; x < size; x++) {
+                pixels[(size_t)y * size + x] = ((x / square + y / square) & 1) ? colorB : colorA;
+            }
+        }
+        texture.create(pixels.data(), size, size);
+    }
+}
@@ -0,0 +1,132 @@
+#include "../include/threadpool.h"
+#include <algorithm>
+
+namespace Engine3D {
+
+    ThreadPool::ThreadPool(unsigned threadCount)
+        : generation(0), stopping(false) {
+        if (threadCount == 0) {
+            threadCount = std::max(1u, std::thread::hardware_concurrency());
+        }
+
+        // Queue 0 belongs to the threads calling parallelFor
+        for (unsigned i = 0; i < threadCount; i++) {
+            queues.push_back(std::make_unique<WorkQueue>());
+        }
+        for (unsigned i = 1; i < threadCount; i++) {
+            workers.emplace_back(&ThreadPool::workerLoop, this, i);
+        }
+    }
+
+    ThreadPool::~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(stateMutex);
+            stopping = true;
+        }
+        wakeWorkers.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+    void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& task) {
+        if (count == 0) {
+            return;
+        }
+
+        // Not worth waking anyone for
+        if (workers.empty() || count == 1) {
+            for (size_t i = 0; i < count; i++) {
+                task(i);
+            }
+            return;
+        }
+
+        Job job;
+        job.task = &task;
+        job.remaining.store(count);
+
+        // Deal the indices out round-robin, stealing evens out the rest
+        for (size_t q = 0; q < queues.size(); q++) {
+            std::lock_guard<std::mutex> lock(queues[q]->mutex);
+            for (size_t i = q; i < count; i += queues.size()) {
+                queues[q]->items.push_back(WorkItem{ &job, i });
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(stateMutex);
+            generation++;
+        }
+        wakeWorkers.notify_all();
+
+        while (runOne(0, &job)) {}
+
+        std::unique_lock<std::mutex> lock(stateMutex);
+        jobDone.wait(lock, [&] { return job.remaining.load() == 0; });
+    }
+
+    void ThreadPool::workerLoop(unsigned queueIndex) {
+        unsigned long long seen = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(stateMutex);
+                wakeWorkers.wait(lock, [&] { return stopping || generation != seen; });
+                if (stopping) {
+                    return;
+                }
+                seen = generation;
+            }
+
+            while (runOne(queueIndex, nullptr)) {}
+        }
+    }
+
+    bool ThreadPool::runOne(unsigned queueIndex, const Job* only) {
+        WorkItem item = {};
+        bool found = false;
+
+        // Own queue first, oldest item first
+        {
+            WorkQueue& own = *queues[queueIndex];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            for (auto it = own.items.begin(); it != own.items.end(); ++it) {
+                if (!only || it->job == only) {
+                    item = *it;
+                    own.items.erase(it);
+                    found = true;
+                    break;
+                }
+            }
+        }
+
+        // Otherwise steal the newest item of another queue
+        for (size_t offset = 1; !found && offset < queues.size(); offset++) {
+            WorkQueue& victim = *queues[(queueIndex + offset) % queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            for (auto it = victim.items.rbegin(); it != victim.items.rend(); ++it) {
+                if (!only || it->job == only) {
+                    item = *it;
+                    victim.items.erase(std::next(it).base());
+                    found = true;
+                    break;
+                }
+            }
+        }
+
+        if (!found) {
+            return false;
+        }
+
+        // The job is set up before any of its items are queued, so popping an item
+        // guarantees the job is visible. It is not touched after its last item, when
+        // the thread waiting for it may return.
+        (*item.job->task)(item.index);
+
+        if (item.job->remaining.fetch_sub(1) == 1) {
+            std::lock_guard<std::mutex> lock(stateMutex);
+            jobDone.notify_all();
+        }
+        return true;
+    }
+}
@@ -0,0 +1,210 @@
+#include "../include/transform.h"
+#include <algorithm>
+
+// The AVX-512 kernels run where FMA is available, and GCC would fuse their
+// multiplies and adds into fused multiply-adds that round differently from the
+// scalar path. Clang only fuses within one source expression, which the
+// intrinsics never are.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define ENGINE_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+namespace Engine3D {
+
+    namespace {
+        // Every kernel evaluates x * m0 + y * m1 + z * m2 + m3 in this exact order with
+        // separate multiplies and adds, so all levels match multiplyVector bit for bit.
+        // SIMD kernels only process whole vectors and return how many points they did;
+        // the scalar kernel finishes the tail.
+
+        void transformScalar(const matrix4x4& m, const float* x, const float* y, const float* z,
+                             float* ox, float* oy, float* oz, float* ow, size_t begin, size_t count) {
+            for (size_t i = begin; i < count; i++) {
+                ox[i] = x[i] * m.m[0][0] + y[i] * m.m[1][0] + z[i] * m.m[2][0] + m.m[3][0];
+                oy[i] = x[i] * m.m[0][1] + y[i] * m.m[1][1] + z[i] * m.m[2][1] + m.m[3][1];
+                oz[i] = x[i] * m.m[0][2] + y[i] * m.m[1][2] + z[i] * m.m[2][2] + m.m[3][2];
+                ow[i] = x[i] * m.m[0][3] + y[i] * m.m[1][3] + z[i] * m.m[2][3] + m.m[3][3];
+            }
+        }
+
+        void projectScalar(const matrix4x4& m, const float* x, const float* y, const float* z,
+                           float* ox, float* oy, float* oz, size_t begin, size_t count) {
+            for (size_t i = begin; i < count; i++) {
+                vec3d o = m.multiplyVector(vec3d(x[i], y[i], z[i]));
+                ox[i] = o.x;
+                oy[i] = o.y;
+                oz[i] = o.z;
+            }
+        }
+
+#ifdef ENGINE_X86_SIMD
+
+        // Shared loop for one register width: loads a vector of points, transforms it
+        // into rx, ry, rz, rw and runs the trailing statements to store the result
+#define ENGINE_TRANSFORM_LOOP(V, WIDTH, SET1, LOADU, MUL, ADD, ...)                      \
+        const V c00 = SET1(m.m[0][0]), c10 = SET1(m.m[1][0]), c20 = SET1(m.m[2][0]), c30 = SET1(m.m[3][0]); \
+        const V c01 = SET1(m.m[0][1]), c11 = SET1(m.m[1][1]), c21 = SET1(m.m[2][1]), c31 = SET1(m.m[3][1]); \
+        const V c02 = SET1(m.m[0][2]), c12 = SET1(m.m[1][2]), c22 = SET1(m.m[2][2]), c32 = SET1(m.m[3][2]); \
+        const V c03 = SET1(m.m[0][3]), c13 = SET1(m.m[1][3]), c23 = SET1(m.m[2][3]), c33 = SET1(m.m[3][3]); \
+        size_t end = count - count % WIDTH;                                              \
+        for (size_t i = 0; i < end; i += WIDTH) {                                        \
+            V vx = LOADU(x + i), vy = LOADU(y + i), vz = LOADU(z + i);                   \
+            V rx = ADD(ADD(ADD(MUL(vx, c00), MUL(vy, c10)), MUL(vz, c20)), c30);         \
+            V ry = ADD(ADD(ADD(MUL(vx, c01), MUL(vy, c11)), MUL(vz, c21)), c31);         \
+            V rz = ADD(ADD(ADD(MUL(vx, c02), MUL(vy, c12)), MUL(vz, c22)), c32);         \
+            V rw = ADD(ADD(ADD(MUL(vx, c03), MUL(vy, c13)), MUL(vz, c23)), c33);         \
+            __VA_ARGS__                                                                  \
+        }                                                                                \
+        return end;
+
+        __attribute__((target("sse2")))
+        size_t transformSSE(const matrix4x4& m, const float* x, const float* y, const float* z,
+                            float* ox, float* oy, float* oz, float* ow, size_t count) {
+            ENGINE_TRANSFORM_LOOP(__m128, 4, _mm_set1_ps, _mm_loadu_ps, _mm_mul_ps, _mm_add_ps,
+                _mm_storeu_ps(ox + i, rx);
+                _mm_storeu_ps(oy + i, ry);
+                _mm_storeu_ps(oz + i, rz);
+                _mm_storeu_ps(ow + i, rw);
+            )
+        }
+
+        __attribute__((target("avx2")))
+        size_t transformAVX2(const matrix4x4& m, const float* x, const float* y, const float* z,
+                             float* ox, float* oy, float* oz, float* ow, size_t count) {
+            ENGINE_TRANSFORM_LOOP(__m256, 8, _mm256_set1_ps, _mm256_loadu_ps, _mm256_mul_ps, _mm256_add_ps,
+                _mm256_storeu_ps(ox + i, rx);
+                _mm256_storeu_ps(oy + i, ry);
+                _mm256_storeu_ps(oz + i, rz);
+                _mm256_storeu_ps(ow + i, rw);
+            )
+        }
+
+        __attribute__((target("avx512f")))
+        size_t transformAVX512(const matrix4x4& m, const float* x, const float* y, const float* z,
+                               float* ox, float* oy, float* oz, float* ow, size_t count) {
+            ENGINE_TRANSFORM_LOOP(__m512, 16, _mm512_set1_ps, _mm512_loadu_ps, _mm512_mul_ps, _mm512_add_ps,
+                _mm512_storeu_ps(ox + i, rx);
+                _mm512_storeu_ps(oy + i, ry);
+                _mm512_storeu_ps(oz + i, rz);
+                _mm512_storeu_ps(ow + i, rw);
+            )
+        }
+
+        // Projected variants divide by w wherever it is non-zero, like multiplyVector
+
+        __attribute__((target("sse2")))
+        size_t projectSSE(const matrix4x4& m, const float* x, const float* y, const float* z,
+                          float* ox, float* oy, float* oz, size_t count) {
+            ENGINE_TRANSFORM_LOOP(__m128, 4, _mm_set1_ps, _mm_loadu_ps, _mm_mul_ps, _mm_add_ps,
+                __m128 nonZero = _mm_cmpneq_ps(rw, _mm_setzero_ps());
+                _mm_storeu_ps(ox + i, _mm_or_ps(_mm_and_ps(nonZero, _mm_div_ps(rx, rw)), _mm_andnot_ps(nonZero, rx)));
+                _mm_storeu_ps(oy + i, _mm_or_ps(_mm_and_ps(nonZero, _mm_div_ps(ry, rw)), _mm_andnot_ps(nonZero, ry)));
+                _mm_storeu_ps(oz + i, _mm_or_ps(_mm_and_ps(nonZero, _mm_div_ps(rz, rw)), _mm_andnot_ps(nonZero, rz)));
+            )
+        }
+
+        __attribute__((target("avx2")))
+        size_t projectAVX2(const matrix4x4& m, const float* x, const float* y, const float* z,
+                           float* ox, float* oy, float* oz, size_t count) {
+            ENGINE_TRANSFORM_LOOP(__m256, 8, _mm256_set1_ps, _mm256_loadu_ps, _mm256_mul_ps, _mm256_add_ps,
+                __m256 nonZero = _mm256_cmp_ps(rw, _mm256_setzero_ps(), _CMP_NEQ_UQ);
+                _mm256_storeu_ps(ox + i, _mm256_blendv_ps(rx, _mm256_div_ps(rx, rw), nonZero));
+                _mm256_storeu_ps(oy + i, _mm256_blendv_ps(ry, _mm256_div_ps(ry, rw), nonZero));
+                _mm256_storeu_ps(oz + i, _mm256_blendv_ps(rz, _mm256_div_ps(rz, rw), nonZero));
+            )
+        }
+
+        __attribute__((target("avx512f")))
+        size_t projectAVX512(const matrix4x4& m, const float* x, const float* y, const float* z,
+                             float* ox, float* oy, float* oz, size_t count) {
+            ENGINE_TRANSFORM_LOOP(__m512, 16, _mm512_set1_ps, _mm512_loadu_ps, _mm512_mul_ps, _mm512_add_ps,
+                __mmask16 nonZero = _mm512_cmp_ps_mask(rw, _mm512_setzero_ps(), _CMP_NEQ_UQ);
+                _mm512_storeu_ps(ox + i, _mm512_mask_div_ps(rx, nonZero, rx, rw));
+                _mm512_storeu_ps(oy + i, _mm512_mask_div_ps(ry, nonZero, ry, rw));
+                _mm512_storeu_ps(oz + i, _mm512_mask_div_ps(rz, nonZero, rz, rw));
+            )
+        }
+
+#undef ENGINE_TRANSFORM_LOOP
+
+#endif
+
+        // AVX-512 is opt-in: transform_bench shows it no faster than AVX2 on these
+        // memory-bound loops, and wide vectors can lower the clock for everything else
+        SimdLevel& activeLevel() {
+            static SimdLevel level = std::min(detectSimdLevel(), SimdLevel::AVX2);
+            return level;
+        }
+    }
+
+    SimdLevel detectSimdLevel() {
+#ifdef ENGINE_X86_SIMD
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) return SimdLevel::AVX512;
+        if (__builtin_cpu_supports("avx2")) return SimdLevel::AVX2;
+        if (__builtin_cpu_supports("sse2")) return SimdLevel::SSE;
+#endif
+        return SimdLevel::Scalar;
+    }
+
+    const char* simdLevelName(SimdLevel level) {
+        switch (level) {
+            case SimdLevel::SSE: return "sse";
+            case SimdLevel::AVX2: return "avx2";
+            case SimdLevel::AVX512: return "avx512";
+            default: return "scalar";
+        }
+    }
+
+    void setSimdLevel(SimdLevel level) {
+        SimdLevel supported = detectSimdLevel();
+        activeLevel() = (int)level > (int)supported ? supported : level;
+    }
+
+    SimdLevel getSimdLevel() {
+        return activeLevel();
+    }
+
+    void transformPoints(const matrix4x4& m,
+                         const float* x, const float* y, const float* z,
+                         float* outX, float* outY, float* outZ, float* outW,
+                         size_t count) {
+        size_t done = 0;
+#ifdef ENGINE_X86_SIMD
+        switch (activeLevel()) {
+            case SimdLevel::AVX512: done = transformAVX512(m, x, y, z, outX, outY, outZ, outW, count); break;
+            case SimdLevel::AVX2: done = transformAVX2(m, x, y, z, outX, outY, outZ, outW, count); break;
+            case SimdLevel::SSE: done = transformSSE(m, x, y, z, outX, outY, outZ, outW, count); break;
+            default: break;
+        }
+#endif
+        transformScalar(m, x, y, z, outX, outY, outZ, outW, done, count);
+    }
+
+    void transformPointsProjected(const matrix4x4& m,
+                                  const float* x, const float* y, const float* z,
+                                  float* outX, float* outY, float* outZ,
+                                  size_t count) {
+        size_t done = 0;
+#ifdef ENGINE_X86_SIMD
+        switch (activeLevel()) {
+            case SimdLevel::AVX512: done = projectAVX512(m, x, y, z, outX, outY, outZ, count); break;
+            case SimdLevel::AVX2: done = projectAVX2(m, x, y, z, outX, outY, outZ, count); break;
+            case SimdLevel::SSE: done = projectSSE(m, x, y, z, outX, outY, outZ, count); break;
+            default: break;
+        }
+#endif
+        projectScalar(m, x, y, z, outX, outY, outZ, done, count);
+    }
+
+    void transformPointsProjected(const matrix4x4& m, const VertexStream& in, VertexStream& out) {
+        out.resize(in.size());
+        transformPointsProjected(m, in.x.data(), in.y.data(), in.z.data(),
+                                 out.x.data(), out.y.data(), out.z.data(), in.size());
+    }
+}
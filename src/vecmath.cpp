@@ -0,0 +1,59 @@
+#include "../include/vecmath.h"
+
+#ifdef ENGINE_VECMATH_SSE
+#include <xmmintrin.h>
+#endif
+
+namespace Engine3D {
+
+    void transformNormals(const mat4& m, vec4* normals, size_t count) {
+        size_t i = 0;
+#ifdef ENGINE_VECMATH_SSE
+        // Four normals at a time, transposed so each register holds one component
+        // of all four. Every lane runs the operations of normalize3(v * m) in the
+        // same order, so the results are bit-identical to the one at a time loop.
+        __m128 rows[4][4];
+        for (int r = 0; r < 4; r++) {
+            const vec4& row = m.rows[r];
+            rows[r][0] = _mm_set1_ps(row.x);
+            rows[r][1] = _mm_set1_ps(row.y);
+            rows[r][2] = _mm_set1_ps(row.z);
+            rows[r][3] = _mm_set1_ps(row.w);
+        }
+        for (; i + 4 <= count; i += 4) {
+            __m128 x = _mm_load_ps(&normals[i].x);
+            __m128 y = _mm_load_ps(&normals[i + 1].x);
+            __m128 z = _mm_load_ps(&normals[i + 2].x);
+            __m128 w = _mm_load_ps(&normals[i + 3].x);
+            _MM_TRANSPOSE4_PS(x, y, z, w);
+
+            __m128 out[4];
+            for (int c = 0; c < 4; c++) {
+                __m128 sum = _mm_mul_ps(x, rows[0][c]);
+                sum = _mm_add_ps(sum, _mm_mul_ps(y, rows[1][c]));
+                sum = _mm_add_ps(sum, _mm_mul_ps(z, rows[2][c]));
+                out[c] = _mm_add_ps(sum, _mm_mul_ps(w, rows[3][c]));
+            }
+
+            __m128 lengthSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(out[0], out[0]), _mm_mul_ps(out[1], out[1])),
+                                              _mm_mul_ps(out[2], out[2]));
+            __m128 estimate = _mm_rsqrt_ps(lengthSquared);
+            __m128 refined = _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(0.5f), estimate),
+                                        _mm_sub_ps(_mm_set1_ps(3.0f), _mm_mul_ps(lengthSquared, _mm_mul_ps(estimate, estimate))));
+            __m128 nonzero = _mm_cmpgt_ps(lengthSquared, _mm_setzero_ps());
+            for (int c = 0; c < 4; c++) {
+                out[c] = _mm_and_ps(_mm_mul_ps(out[c], refined), nonzero);
+            }
+
+            _MM_TRANSPOSE4_PS(out[0], out[1], out[2], out[3]);
+            _mm_store_ps(&normals[i].x, out[0]);
+            _mm_store_ps(&normals[i + 1].x, out[1]);
+            _mm_store_ps(&normals[i + 2].x, out[2]);
+            _mm_store_ps(&normals[i + 3].x, out[3]);
+        }
+#endif
+        for (; i < count; i++) {
+            normals[i] = normalize3(normals[i] * m);
+        }
+    }
+}